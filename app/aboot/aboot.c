@@ -35,8 +35,11 @@
 #include <arch/arm.h>
 #include <dev/udc.h>
 #include <string.h>
+#include <stdlib.h>
 #include <kernel/thread.h>
+#include <kernel/event.h>
 #include <arch/ops.h>
+#include <openssl/sha.h>
 
 #include <dev/flash.h>
 #include <lib/ptable.h>
@@ -48,13 +51,20 @@
 #include <partition_parser.h>
 #include <platform.h>
 #include <crypto_hash.h>
+#include <malloc.h>
+#include <lib/lz4.h>
 
 #include "image_verify.h"
 #include "recovery.h"
 #include "bootimg.h"
 #include "fastboot.h"
 #include "sparse_format.h"
+#include "bundle.h"
+#include "bootcache.h"
+#include "snapshot.h"
+#include "bootmenu.h"
 #include "mmc.h"
+#include "iostat.h"
 #include "devinfo.h"
 
 #include "scm.h"
@@ -87,6 +97,9 @@ static int auth_kernel_img = 0;
 
 static device_info device = {DEVICE_MAGIC, 0, 0};
 
+/* partition picked in the boot menu, NULL for "boot" */
+static const char *boot_menu_ptn;
+
 static struct udc_device surf_udc_device = {
 	.vendor_id	= 0x18d1,
 	.product_id	= 0xD00D,
@@ -125,6 +138,82 @@ static void ptentry_to_tag(unsigned **ptr, struct ptentry *ptn)
 	*ptr += sizeof(struct atag_ptbl_entry) / sizeof(unsigned);
 }
 
+/*
+ * Rather than writing back the whole data cache by set/way before the
+ * kernel is entered, clean only what the kernel reads from memory
+ * (kernel, ramdisk, tags) and what the loader itself still touches on
+ * the way out (its data, bss and stack), then turn the cache off
+ * discarding the rest - mostly stale scratch and download buffers.
+ * Past BOOT_HANDOFF_CLEAN_MAX bytes cleaning by address costs more
+ * than the set/way walk, so the full flush is used instead, as it is
+ * with BOOT_HANDOFF_FULL_FLUSH set for comparison.
+ */
+#ifndef BOOT_HANDOFF_CLEAN_MAX
+#define BOOT_HANDOFF_CLEAN_MAX	(32 * 1024 * 1024)
+#endif
+#ifndef BOOT_HANDOFF_FULL_FLUSH
+#define BOOT_HANDOFF_FULL_FLUSH	0
+#endif
+#define BOOT_HANDOFF_RANGES	4
+
+extern int _start;
+extern int __data_start;
+extern int _end;
+extern int _heap_end;
+
+static struct {
+	addr_t start;
+	size_t len;
+} handoff_range[BOOT_HANDOFF_RANGES];
+static unsigned handoff_count;
+static int handoff_full = BOOT_HANDOFF_FULL_FLUSH;
+
+/* memory written for the kernel that has to be in RAM when it starts */
+static void boot_handoff_add(void *start, size_t len)
+{
+	addr_t a = ROUNDDOWN((addr_t) start, CACHE_LINE);
+
+	if (len == 0)
+		return;
+	if (handoff_count == BOOT_HANDOFF_RANGES) {
+		handoff_full = 1;
+		return;
+	}
+	handoff_range[handoff_count].start = a;
+	handoff_range[handoff_count].len =
+		ROUNDUP((addr_t) start + len, CACHE_LINE) - a;
+	handoff_count++;
+}
+
+/* leaves caches off with everything boot_handoff_add()ed in RAM */
+static void boot_handoff(void)
+{
+	thread_t *t = current_thread;
+	uint32_t start = arch_cycle_count();
+	unsigned long long total = 0;
+	unsigned i;
+
+	for (i = 0; i < handoff_count; i++)
+		total += handoff_range[i].len;
+
+	if (handoff_full || !t->stack || total > BOOT_HANDOFF_CLEAN_MAX) {
+		arch_disable_cache(UCACHE);
+		dprintf(INFO, "handoff: full cache flush in %u cycles\n",
+			arch_cycle_count() - start);
+		return;
+	}
+
+	for (i = 0; i < handoff_count; i++)
+		arch_clean_cache_range(handoff_range[i].start,
+				       handoff_range[i].len);
+	arch_clean_cache_range((addr_t) &__data_start,
+			       (addr_t) &_end - (addr_t) &__data_start);
+	arch_disable_cache_discard(UCACHE,
+				   (addr_t) t->stack + t->stack_size);
+	dprintf(INFO, "handoff: cleaned %llu KB in %u cycles\n",
+		total / 1024, arch_cycle_count() - start);
+}
+
 void boot_linux(void *kernel, unsigned *tags,
 		const char *cmdline, unsigned machtype,
 		void *ramdisk, unsigned ramdisk_size)
@@ -287,10 +376,13 @@ void boot_linux(void *kernel, unsigned *tags,
 	if (cmdline)
 		dprintf(INFO, "cmdline: %s\n", cmdline);
 
+	boot_handoff_add(tags, (unsigned) ptr - (unsigned) tags);
+	boot_handoff_add(ramdisk, ramdisk_size);
+
 	enter_critical_section();
 	/* do any platform specific cleanup before kernel entry */
 	platform_uninit();
-	arch_disable_cache(UCACHE);
+	boot_handoff();
 	arch_disable_mmu();
 	entry(0, machtype, tags);
 }
@@ -302,6 +394,528 @@ unsigned page_mask = 0;
 
 static unsigned char buf[4096]; //Equal to max-supported pagesize
 
+/*
+ * Kernel and ramdisk sections may be stored lz4 compressed (frame or
+ * "lz4 -l" legacy format); they are then inflated straight to their
+ * load address as they are read, so fewer bytes come off storage and
+ * the kernel can be a plain Image that needs no self-decompression.
+ */
+#define BOOT_STREAM_CHUNK	(1024 * 1024)
+#define BOOT_LZ4_MAX		(64 * 1024 * 1024)
+
+/* where boot_load_section() reads from: an eMMC offset or a NAND ptn */
+struct boot_src {
+	unsigned long long base;
+	struct ptentry *ptn;
+	unsigned psize;		/* page size of the image */
+};
+
+static int boot_src_read(struct boot_src *src, unsigned offset,
+			 void *data, unsigned len)
+{
+	if (src->ptn)
+		return flash_read(src->ptn, offset, data, len);
+	return mmc_read(src->base + offset, data, len);
+}
+
+/* room for the kernel ends where the ramdisk starts, if above it */
+static unsigned boot_kernel_max(struct boot_img_hdr *hdr)
+{
+	if (hdr->ramdisk_addr > hdr->kernel_addr &&
+	    hdr->ramdisk_addr - hdr->kernel_addr < BOOT_LZ4_MAX)
+		return hdr->ramdisk_addr - hdr->kernel_addr;
+	return BOOT_LZ4_MAX;
+}
+
+/* inflate a whole lz4 section already in memory; returns size or -1 */
+static int boot_inflate(const char *what, void *data, unsigned size,
+			void *dest, unsigned dest_max)
+{
+	struct lz4_frame f;
+	unsigned used, consumed = 0;
+	time_t start = current_time();
+	int r;
+
+	lz4_frame_init(&f, dest, dest_max);
+	do {
+		r = lz4_frame_decode(&f, data + consumed, size - consumed,
+				     &used, true);
+		consumed += used;
+	} while (r == LZ4_FRAME_OK);
+
+	if (r != LZ4_FRAME_DONE) {
+		dprintf(CRITICAL, "ERROR: Cannot inflate %s (%d)\n", what, r);
+		return -1;
+	}
+	dprintf(INFO, "%s: lz4 %u -> %u bytes in %lu ms\n", what, size,
+		f.out_len, current_time() - start);
+	return f.out_len;
+}
+
+/* move a section out of a fully read image, inflating it if needed */
+static int boot_place_section(const char *what, void *data, unsigned size,
+			      void *dest, unsigned dest_max)
+{
+	if (lz4_is_compressed(data, size))
+		return boot_inflate(what, data, size, dest, dest_max);
+	memmove(dest, data, size);
+	return size;
+}
+
+/*
+ * Read a section of 'size' bytes at 'offset' in the boot image to dest.
+ * The first page is read to dest as usual; if it turns out to be lz4
+ * the section is instead read BOOT_STREAM_CHUNK at a time into scratch
+ * memory and each chunk is inflated to dest before the next is read.
+ * Returns the size of the section in memory or -1.
+ */
+static int boot_load_section(const char *what, struct boot_src *src,
+			     unsigned offset, unsigned size,
+			     void *dest, unsigned dest_max)
+{
+	unsigned char *stage = (unsigned char *) target_get_scratch_address();
+	unsigned n = ROUND_TO_PAGE(size, src->psize - 1);
+	unsigned have, consumed = 0, used, len;
+	time_t begin = current_time();
+	time_t start = begin;
+	time_t read_time, total;
+	struct lz4_frame f;
+	int r;
+
+	have = MIN(n, src->psize);
+	if (n == 0)
+		return 0;
+	if (boot_src_read(src, offset, dest, have))
+		return -1;
+
+	if (!lz4_is_compressed(dest, MIN(have, size))) {
+		if (n > have && boot_src_read(src, offset + have,
+					      dest + have, n - have))
+			return -1;
+		dprintf(INFO, "%s: %u bytes in %lu ms\n", what, size,
+			current_time() - begin);
+		return size;
+	}
+
+	memcpy(stage, dest, have);
+	lz4_frame_init(&f, dest, dest_max);
+	read_time = current_time() - start;
+
+	for (;;) {
+		/* padding after the stream is not fed to the decoder */
+		len = MIN(have, size);
+		do {
+			r = lz4_frame_decode(&f, stage + consumed,
+					     len - consumed, &used,
+					     len == size);
+			consumed += used;
+		} while (r == LZ4_FRAME_OK);
+
+		if (r != LZ4_FRAME_MORE || have == n)
+			break;
+
+		len = MIN(BOOT_STREAM_CHUNK, n - have);
+		start = current_time();
+		if (boot_src_read(src, offset + have, stage + have, len))
+			return -1;
+		read_time += current_time() - start;
+		have += len;
+	}
+
+	if (r != LZ4_FRAME_DONE) {
+		dprintf(CRITICAL, "ERROR: Cannot inflate %s (%d)\n", what, r);
+		return -1;
+	}
+	total = current_time() - begin;
+	dprintf(INFO, "%s: lz4 %u -> %u bytes in %lu ms (%lu ms reading)\n",
+		what, size, f.out_len, total, read_time);
+	return f.out_len;
+}
+
+/*
+ * Boot images are read in the background while aboot_init works out
+ * what to boot, so a normal boot finds kernel and ramdisk already in
+ * place.  At start the boot partition is loaded; the boot menu asks
+ * for whichever entry is highlighted.  Requests made while a load is
+ * running are served when it ends, only the latest one.  Only done for
+ * unsigned images on eMMC; if something else is booted the result is
+ * simply overwritten.
+ */
+#define PREFETCH_IDLE		0
+#define PREFETCH_BUSY		1
+#define PREFETCH_DONE		2
+#define PREFETCH_FAILED		3
+
+static int prefetch_state = PREFETCH_IDLE;
+static const char *prefetch_ptn;	/* what prefetch_buf and memory hold */
+static const char *prefetch_want;	/* next partition to load */
+static event_t prefetch_event;		/* set when no load is pending */
+static event_t prefetch_kick;
+static const char *prefetch_cur;	/* being loaded */
+static int prefetch_running;
+static unsigned char prefetch_buf[4096];
+
+/*
+ * mkbootimg puts a SHA1 of the sections and their sizes in id[]; check
+ * it when the sections were not inflated on the way in.
+ */
+static int boot_prefetch_verify(struct boot_img_hdr *hdr,
+				unsigned kernel_stored, unsigned ramdisk_stored)
+{
+	unsigned char digest[SHA_DIGEST_LENGTH];
+	unsigned zero = 0;
+	SHA_CTX ctx;
+
+	if (hdr->kernel_size != kernel_stored ||
+	    hdr->ramdisk_size != ramdisk_stored || hdr->second_size) {
+		dprintf(INFO, "boot prefetch: sections not verified\n");
+		return 0;
+	}
+
+	SHA1_Init(&ctx);
+	SHA1_Update(&ctx, (void *) hdr->kernel_addr, hdr->kernel_size);
+	SHA1_Update(&ctx, &hdr->kernel_size, sizeof(hdr->kernel_size));
+	SHA1_Update(&ctx, (void *) hdr->ramdisk_addr, hdr->ramdisk_size);
+	SHA1_Update(&ctx, &hdr->ramdisk_size, sizeof(hdr->ramdisk_size));
+	SHA1_Update(&ctx, &zero, sizeof(zero));
+	SHA1_Final(digest, &ctx);
+
+	if (memcmp(digest, hdr->id, sizeof(digest))) {
+		dprintf(CRITICAL, "boot prefetch: image id mismatch\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int boot_prefetch_load(const char *name)
+{
+	struct boot_img_hdr *hdr = (void *) prefetch_buf;
+	struct boot_src src = { 0, NULL, 0 };
+	unsigned kernel_actual, ramdisk_actual;
+	unsigned kernel_stored, ramdisk_stored;
+	time_t start = current_time();
+	unsigned psize = page_size;
+	int r;
+
+	/* the main thread owns page_size/page_mask; this runs alongside it */
+	src.base = partition_get_offset(partition_get_index(name));
+	if (src.base == 0)
+		return -1;
+	if (mmc_read(src.base, (unsigned int *) prefetch_buf, psize))
+		return -1;
+	if (memcmp(hdr->magic, BOOT_MAGIC, BOOT_MAGIC_SIZE))
+		return -1;
+
+	if (hdr->page_size)
+		psize = hdr->page_size;
+	src.psize = psize;
+	kernel_stored = hdr->kernel_size;
+	ramdisk_stored = hdr->ramdisk_size;
+	kernel_actual = ROUND_TO_PAGE(hdr->kernel_size, psize - 1);
+	ramdisk_actual = ROUND_TO_PAGE(hdr->ramdisk_size, psize - 1);
+
+	if (!boot_cache_restore(name, hdr, psize))
+		goto done;
+
+	r = boot_load_section("kernel", &src, psize, hdr->kernel_size,
+			      (void *)hdr->kernel_addr, boot_kernel_max(hdr));
+	if (r < 0)
+		return -1;
+	hdr->kernel_size = r;
+
+	r = boot_load_section("ramdisk", &src, psize + kernel_actual,
+			      hdr->ramdisk_size, (void *)hdr->ramdisk_addr,
+			      BOOT_LZ4_MAX);
+	if (r < 0)
+		return -1;
+	hdr->ramdisk_size = r;
+
+	if (boot_prefetch_verify(hdr, kernel_stored, ramdisk_stored))
+		return -1;
+	boot_cache_store(name, hdr);
+
+done:
+	dprintf(INFO, "boot prefetch: '%s' %u bytes in %lu ms\n", name,
+		psize + kernel_actual + ramdisk_actual,
+		current_time() - start);
+	return 0;
+}
+
+static int boot_prefetch_thread(void *arg)
+{
+	const char *name;
+	int r;
+
+	for (;;) {
+		event_wait(&prefetch_kick);
+
+		enter_critical_section();
+		while ((name = prefetch_want)) {
+			prefetch_want = NULL;
+			prefetch_ptn = NULL;
+			prefetch_cur = name;
+			exit_critical_section();
+
+			r = boot_prefetch_load(name);
+			if (r)
+				dprintf(INFO, "boot prefetch: no usable image "
+					"in '%s'\n", name);
+
+			enter_critical_section();
+			prefetch_cur = NULL;
+			prefetch_ptn = name;
+			prefetch_state = r ? PREFETCH_FAILED : PREFETCH_DONE;
+		}
+		event_signal(&prefetch_event, false);
+		exit_critical_section();
+	}
+	return 0;
+}
+
+/* ask for partition 'name' to be loaded next, unless it already is */
+static void boot_prefetch(const char *name)
+{
+	if (!prefetch_running)
+		return;
+
+	enter_critical_section();
+	if (!(prefetch_want && !strcmp(prefetch_want, name)) &&
+	    !(prefetch_cur && !strcmp(prefetch_cur, name)) &&
+	    !(!prefetch_want && prefetch_ptn && !strcmp(prefetch_ptn, name))) {
+		prefetch_want = name;
+		prefetch_state = PREFETCH_BUSY;
+		event_unsignal(&prefetch_event);
+		event_signal(&prefetch_kick, false);
+	}
+	exit_critical_section();
+}
+
+static void boot_prefetch_start(void)
+{
+	thread_t *thr;
+
+	if (!target_is_emmc_boot())
+		return;
+	if (target_use_signed_kernel() && !device.is_unlocked &&
+	    !device.is_tampered)
+		return;
+
+	event_init(&prefetch_event, true, 0);
+	event_init(&prefetch_kick, false, EVENT_FLAG_AUTOUNSIGNAL);
+	thr = thread_create("prefetch", boot_prefetch_thread, NULL,
+			    DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+	if (!thr)
+		return;
+	prefetch_running = 1;
+	thread_resume(thr);
+	boot_prefetch("boot");
+}
+
+/* wait for loads in flight; nothing else may touch their memory until then */
+static int boot_prefetch_wait(void)
+{
+	if (prefetch_running)
+		event_wait(&prefetch_event);
+	return prefetch_state;
+}
+
+/* whether partition 'name' is loaded and ready to boot */
+static int boot_prefetched(const char *name)
+{
+	return boot_prefetch_wait() == PREFETCH_DONE && prefetch_ptn &&
+		!strcmp(prefetch_ptn, name);
+}
+
+/* for when something else is put in the prefetched memory */
+static void boot_prefetch_discard(void)
+{
+	boot_prefetch_wait();
+	prefetch_ptn = NULL;
+	prefetch_state = PREFETCH_IDLE;
+}
+
+#if WITH_BOOT_MENU
+#ifndef BOOT_MENU_TIMEOUT
+#define BOOT_MENU_TIMEOUT	3000
+#endif
+
+/* entries whose partition does not exist are left out */
+static const struct boot_menu_entry boot_menu_entries[] = {
+	{ "Android", "boot" },
+	{ "Linux", "linux" },
+	{ "Recovery", "recovery" },
+	{ "Fastboot", NULL },
+};
+
+static void boot_menu_highlight(const struct boot_menu_entry *e)
+{
+	if (e->ptn)
+		boot_prefetch(e->ptn);
+}
+
+static int boot_menu_status(const struct boot_menu_entry *e)
+{
+	int status = BOOT_MENU_NONE;
+
+	if (!e->ptn || !prefetch_running)
+		return status;
+
+	enter_critical_section();
+	if (prefetch_want == e->ptn || prefetch_cur == e->ptn)
+		status = BOOT_MENU_LOADING;
+	else if (!prefetch_want && prefetch_ptn == e->ptn)
+		status = (prefetch_state == PREFETCH_DONE) ?
+			BOOT_MENU_READY : BOOT_MENU_FAILED;
+	exit_critical_section();
+	return status;
+}
+
+/* NULL if there is nothing to choose from */
+static const struct boot_menu_entry *boot_menu_pick(void)
+{
+	const struct boot_menu_entry *present[ARRAY_SIZE(boot_menu_entries)];
+	const struct boot_menu_entry *e;
+	struct boot_menu m;
+	unsigned i, n = 0, images = 0;
+
+	for (i = 0; i < ARRAY_SIZE(boot_menu_entries); i++) {
+		e = &boot_menu_entries[i];
+		if (e->ptn &&
+		    !partition_get_offset(partition_get_index(e->ptn)))
+			continue;
+		if (e->ptn)
+			images++;
+		present[n++] = e;
+	}
+	if (images < 2)
+		return NULL;
+
+	m.entry = present;
+	m.count = n;
+	m.timeout = BOOT_MENU_TIMEOUT;
+	m.highlight = boot_menu_highlight;
+	m.status = boot_menu_status;
+	return present[boot_menu_run(&m)];
+}
+#endif
+
+/*
+ * Whether untrusted data may be loaded to [start, start + len): the
+ * range must not wrap or touch LK itself, i.e. its image, the boot
+ * stack in bss and the heap the other thread stacks come from.  Boot
+ * image spans (any download with the boot magic is scattered, including
+ * one that is then flashed, so its header is not trusted) and snapshot
+ * runs are checked with it.
+ */
+static int boot_load_range_ok(addr_t start, unsigned len)
+{
+	addr_t lk_start = (addr_t) &_start;
+	addr_t lk_end = (addr_t) _heap_end;
+
+	if (start + len < start)
+		return 0;
+	return start + len <= lk_start || start >= lk_end;
+}
+
+/* snapshot runs and stage also keep off the scratch region */
+static int resume_range_ok(unsigned phys, unsigned size)
+{
+	addr_t scratch = (addr_t) target_get_scratch_address();
+
+	if (!boot_load_range_ok(phys, size))
+		return 0;
+	return phys + size <= scratch ||
+	       phys >= scratch + target_get_max_flash_size();
+}
+
+/*
+ * Instead of booting, restore a memory snapshot kept in the "snapshot"
+ * partition and enter the kernel's resume vector.  Only snapshots taken
+ * with the kernel now in the boot partition are used, and they must be
+ * signed where signed kernels are enforced.  Returns if there is none
+ * or it cannot be used, and the normal boot goes on.
+ */
+static int snapshot_read_mmc(void *arg, unsigned long long offset,
+			     void *data, unsigned len)
+{
+	return mmc_read(*(unsigned long long *) arg + offset, data, len);
+}
+
+static void snapshot_enter(unsigned addr, unsigned arg)
+{
+	void (*entry)(unsigned, unsigned, unsigned) = (void *) addr;
+
+	dprintf(INFO, "resuming @ 0x%08x\n", addr);
+
+	enter_critical_section();
+	platform_uninit();
+	arch_disable_cache(UCACHE);
+	arch_disable_mmu();
+	entry(0, board_machtype(), arg);
+}
+
+static int resume_from_mmc(void)
+{
+	struct boot_img_hdr *hdr = (void *) buf;
+	struct snapshot s;
+	unsigned long long ptn, boot;
+	unsigned mem[32], *p, *end;
+
+	ptn = partition_get_offset(partition_get_index("snapshot"));
+	boot = partition_get_offset(partition_get_index("boot"));
+	if (ptn == 0 || boot == 0)
+		return -1;
+
+	/*
+	 * runs may only restore to memory the kernel is given, and not
+	 * over LK or the scratch region
+	 */
+	s.window_count = 0;
+	s.range_ok = resume_range_ok;
+	end = target_atag_mem(mem);
+	for (p = mem; p < end && p[0]; p += p[0])
+		if (p[1] == 0x54410002)
+			snapshot_add_window(&s, p[3], p[2], (void *) p[3]);
+
+	if (snapshot_open(&s, snapshot_read_mmc, &ptn))
+		return -1;
+
+	if (mmc_read(boot, (unsigned int *) buf, page_size) ||
+	    memcmp(hdr->magic, BOOT_MAGIC, BOOT_MAGIC_SIZE) ||
+	    memcmp(hdr->id, s.hdr->kernel_id, SNAPSHOT_ID_SIZE)) {
+		dprintf(INFO, "snapshot: not taken with this kernel\n");
+		goto fail;
+	}
+
+	if (target_use_signed_kernel() && !device.is_unlocked &&
+	    !image_verify(s.table, s.table + s.signed_sz, s.signed_sz,
+			  CRYPTO_AUTH_ALG_SHA256)) {
+		dprintf(CRITICAL, "snapshot: signature check failed\n");
+		goto fail;
+	}
+
+	/* the restore overwrites whatever the prefetch thread loaded */
+	boot_prefetch_discard();
+
+	if (snapshot_restore(&s))
+		goto fail;
+
+	if (s.hdr->flags & SNAPSHOT_FLAG_ONESHOT) {
+		memset(buf, 0, SNAPSHOT_BLOCK);
+		if (mmc_write(ptn, SNAPSHOT_BLOCK, (unsigned int *) buf)) {
+			dprintf(CRITICAL, "snapshot: cannot invalidate\n");
+			goto fail;
+		}
+	}
+
+	snapshot_enter(s.hdr->resume_addr, s.hdr->resume_arg);
+	return 0;
+
+fail:
+	snapshot_close(&s);
+	return -1;
+}
+
 int boot_linux_from_mmc(void)
 {
 	struct boot_img_hdr *hdr = (void*) buf;
@@ -316,6 +930,10 @@ int boot_linux_from_mmc(void)
 	unsigned kernel_actual;
 	unsigned ramdisk_actual;
 	unsigned imagesize_actual;
+	const char *ptn_name = boot_into_recovery ? "recovery" :
+			       boot_menu_ptn ? boot_menu_ptn : "boot";
+	struct boot_src src = { 0, NULL, 0 };
+	int r;
 
 	uhdr = (struct boot_img_hdr *)EMMC_BOOT_IMG_HEADER_ADDR;
 	if (!memcmp(uhdr->magic, BOOT_MAGIC, BOOT_MAGIC_SIZE)) {
@@ -323,21 +941,20 @@ int boot_linux_from_mmc(void)
 		hdr = uhdr;
 		goto unified_boot;
 	}
-	if (!boot_into_recovery) {
-		index = partition_get_index("boot");
-		ptn = partition_get_offset(index);
-		if(ptn == 0) {
-			dprintf(CRITICAL, "ERROR: No boot partition found\n");
-                    return -1;
+	if (boot_prefetched(ptn_name)) {
+		hdr = (void *) prefetch_buf;
+		if (hdr->page_size && (hdr->page_size != page_size)) {
+			page_size = hdr->page_size;
+			page_mask = page_size - 1;
 		}
+		goto unified_boot;
 	}
-	else {
-		index = partition_get_index("recovery");
-		ptn = partition_get_offset(index);
-		if(ptn == 0) {
-			dprintf(CRITICAL, "ERROR: No recovery partition found\n");
-                    return -1;
-		}
+
+	index = partition_get_index(ptn_name);
+	ptn = partition_get_offset(index);
+	if(ptn == 0) {
+		dprintf(CRITICAL, "ERROR: No %s partition found\n", ptn_name);
+		return -1;
 	}
 
 	if (mmc_read(ptn + offset, (unsigned int *) buf, page_size)) {
@@ -396,8 +1013,19 @@ int boot_linux_from_mmc(void)
 		}
 
 		/* Move kernel and ramdisk to correct address */
-		memmove((void*) hdr->kernel_addr, (char *)(image_addr + page_size), hdr->kernel_size);
-		memmove((void*) hdr->ramdisk_addr, (char *)(image_addr + page_size + kernel_actual), hdr->ramdisk_size);
+		r = boot_place_section("kernel", image_addr + page_size,
+				       hdr->kernel_size, (void *) hdr->kernel_addr,
+				       boot_kernel_max(hdr));
+		if (r < 0)
+			return -1;
+		hdr->kernel_size = r;
+		r = boot_place_section("ramdisk",
+				       image_addr + page_size + kernel_actual,
+				       hdr->ramdisk_size, (void *) hdr->ramdisk_addr,
+				       BOOT_LZ4_MAX);
+		if (r < 0)
+			return -1;
+		hdr->ramdisk_size = r;
 
 		/* Make sure everything from scratch address is read before next step!*/
 		if(device.is_tampered)
@@ -408,26 +1036,32 @@ int boot_linux_from_mmc(void)
 		#endif
 		}
 	}
-	else
+	else if (boot_cache_restore(ptn_name, hdr, page_size))
 	{
 		offset += page_size;
+		src.base = ptn;
+		src.psize = page_size;
 
 		n = ROUND_TO_PAGE(hdr->kernel_size, page_mask);
-		if (mmc_read(ptn + offset, (void *)hdr->kernel_addr, n)) {
+		r = boot_load_section("kernel", &src, offset, hdr->kernel_size,
+				      (void *)hdr->kernel_addr, boot_kernel_max(hdr));
+		if (r < 0) {
 			dprintf(CRITICAL, "ERROR: Cannot read kernel image\n");
 					return -1;
 		}
+		hdr->kernel_size = r;
 		offset += n;
 
 		n = ROUND_TO_PAGE(hdr->ramdisk_size, page_mask);
-		if(n != 0)
-		{
-			if (mmc_read(ptn + offset, (void *)hdr->ramdisk_addr, n)) {
-				dprintf(CRITICAL, "ERROR: Cannot read ramdisk image\n");
-				return -1;
-			}
+		r = boot_load_section("ramdisk", &src, offset, hdr->ramdisk_size,
+				      (void *)hdr->ramdisk_addr, BOOT_LZ4_MAX);
+		if (r < 0) {
+			dprintf(CRITICAL, "ERROR: Cannot read ramdisk image\n");
+			return -1;
 		}
+		hdr->ramdisk_size = r;
 		offset += n;
+		boot_cache_store(ptn_name, hdr);
 	}
 
 unified_boot:
@@ -444,6 +1078,7 @@ unified_boot:
 	dprintf(INFO, "cmdline = '%s'\n", cmdline);
 
 	dprintf(INFO, "\nBooting Linux\n");
+	boot_handoff_add((void *)hdr->kernel_addr, hdr->kernel_size);
 	boot_linux((void *)hdr->kernel_addr, (unsigned *) hdr->tags_addr,
 		   (const char *)cmdline, board_machtype(),
 		   (void *)hdr->ramdisk_addr, hdr->ramdisk_size);
@@ -464,6 +1099,8 @@ int boot_linux_from_flash(void)
 	unsigned kernel_actual;
 	unsigned ramdisk_actual;
 	unsigned imagesize_actual;
+	struct boot_src src = { 0, NULL, 0 };
+	int r;
 
 	if (target_is_emmc_boot()) {
 		hdr = (struct boot_img_hdr *)EMMC_BOOT_IMG_HEADER_ADDR;
@@ -555,8 +1192,19 @@ int boot_linux_from_flash(void)
 		}
 
 		/* Move kernel and ramdisk to correct address */
-		memmove((void*) hdr->kernel_addr, (char *)(image_addr + page_size), hdr->kernel_size);
-		memmove((void*) hdr->ramdisk_addr, (char *)(image_addr + page_size + kernel_actual), hdr->ramdisk_size);
+		r = boot_place_section("kernel", image_addr + page_size,
+				       hdr->kernel_size, (void *) hdr->kernel_addr,
+				       boot_kernel_max(hdr));
+		if (r < 0)
+			return -1;
+		hdr->kernel_size = r;
+		r = boot_place_section("ramdisk",
+				       image_addr + page_size + kernel_actual,
+				       hdr->ramdisk_size, (void *) hdr->ramdisk_addr,
+				       BOOT_LZ4_MAX);
+		if (r < 0)
+			return -1;
+		hdr->ramdisk_size = r;
 
 		/* Make sure everything from scratch address is read before next step!*/
 		if(device.is_tampered)
@@ -564,23 +1212,32 @@ int boot_linux_from_flash(void)
 			write_device_info_flash(&device);
 		}
 	}
-	else
+	else if (boot_cache_restore(ptn->name, hdr, page_size))
 	{
 		offset = page_size;
+		src.ptn = ptn;
+		src.psize = page_size;
 
 		n = ROUND_TO_PAGE(hdr->kernel_size, page_mask);
-		if (flash_read(ptn, offset, (void *)hdr->kernel_addr, n)) {
+		r = boot_load_section("kernel", &src, offset, hdr->kernel_size,
+				      (void *)hdr->kernel_addr, boot_kernel_max(hdr));
+		if (r < 0) {
 			dprintf(CRITICAL, "ERROR: Cannot read kernel image\n");
 			return -1;
 		}
+		hdr->kernel_size = r;
 		offset += n;
 
 		n = ROUND_TO_PAGE(hdr->ramdisk_size, page_mask);
-		if (flash_read(ptn, offset, (void *)hdr->ramdisk_addr, n)) {
+		r = boot_load_section("ramdisk", &src, offset, hdr->ramdisk_size,
+				      (void *)hdr->ramdisk_addr, BOOT_LZ4_MAX);
+		if (r < 0) {
 			dprintf(CRITICAL, "ERROR: Cannot read ramdisk image\n");
 			return -1;
 		}
+		hdr->ramdisk_size = r;
 		offset += n;
+		boot_cache_store(ptn->name, hdr);
 	}
 continue_boot:
 	dprintf(INFO, "\nkernel  @ %x (%d bytes)\n", hdr->kernel_addr,
@@ -598,6 +1255,7 @@ continue_boot:
 	/* TODO: create/pass atags to kernel */
 
 	dprintf(INFO, "\nBooting Linux\n");
+	boot_handoff_add((void *)hdr->kernel_addr, hdr->kernel_size);
 	boot_linux((void *)hdr->kernel_addr, (void *)hdr->tags_addr,
 		   (const char *)cmdline, board_machtype(),
 		   (void *)hdr->ramdisk_addr, hdr->ramdisk_size);
@@ -768,12 +1426,60 @@ void set_device_root()
 	write_device_info(&device);
 }
 
+/*
+ * fastboot scatter hook: send the kernel and ramdisk of a boot image
+ * download straight to their load addresses so "boot" need not move
+ * them.  Anything that turns out to need the image in one piece (a
+ * flash: of it, or lz4 sections) gathers it back first.
+ */
+static int boot_download_scatter(const void *head, unsigned have,
+				 unsigned size, struct fastboot_scatter *spans)
+{
+	const struct boot_img_hdr *hdr = head;
+	unsigned psize, kernel_actual, ramdisk_actual;
+	unsigned kernel_addr, ramdisk_addr;
+
+	if (have < sizeof(*hdr) ||
+	    memcmp(hdr->magic, BOOT_MAGIC, BOOT_MAGIC_SIZE))
+		return 0;
+
+	psize = (target_is_emmc_boot() && hdr->page_size) ?
+		hdr->page_size : page_size;
+	if (psize < 512 || (psize & (psize - 1)))
+		return 0;
+
+	kernel_actual = ROUND_TO_PAGE(hdr->kernel_size, psize - 1);
+	ramdisk_actual = ROUND_TO_PAGE(hdr->ramdisk_size, psize - 1);
+	if (psize + kernel_actual + ramdisk_actual > size)
+		return 0;
+
+	kernel_addr = hdr->kernel_addr;
+	ramdisk_addr = hdr->ramdisk_addr;
+	if (ramdisk_actual && kernel_addr < ramdisk_addr + ramdisk_actual &&
+	    ramdisk_addr < kernel_addr + kernel_actual)
+		return 0;
+	if (!boot_load_range_ok(kernel_addr, kernel_actual) ||
+	    !boot_load_range_ok(ramdisk_addr, ramdisk_actual))
+		return 0;
+
+	spans[0].offset = psize;
+	spans[0].size = kernel_actual;
+	spans[0].dest = (void *) kernel_addr;
+	if (!ramdisk_actual)
+		return 1;
+	spans[1].offset = psize + kernel_actual;
+	spans[1].size = ramdisk_actual;
+	spans[1].dest = (void *) ramdisk_addr;
+	return 2;
+}
+
 void cmd_boot(const char *arg, void *data, unsigned sz)
 {
 	unsigned kernel_actual;
 	unsigned ramdisk_actual;
 	static struct boot_img_hdr hdr;
 	char *ptr = ((char*) data);
+	int r;
 
 	if (sz < sizeof(hdr)) {
 		fastboot_fail("invalid bootimage header");
@@ -799,12 +1505,36 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 		return;
 	}
 
-	memmove((void*) hdr.kernel_addr, ptr + page_size, hdr.kernel_size);
-	memmove((void*) hdr.ramdisk_addr, ptr + page_size + kernel_actual, hdr.ramdisk_size);
+	/* already at the load addresses unless they need inflating */
+	if (fastboot_download_scattered()) {
+		if (lz4_is_compressed((void *) hdr.kernel_addr, hdr.kernel_size) ||
+		    lz4_is_compressed((void *) hdr.ramdisk_addr, hdr.ramdisk_size))
+			fastboot_download_gather();
+		else
+			goto boot;
+	}
+
+	r = boot_place_section("kernel", ptr + page_size, hdr.kernel_size,
+			       (void *) hdr.kernel_addr, boot_kernel_max(&hdr));
+	if (r < 0) {
+		fastboot_fail("invalid lz4 kernel");
+		return;
+	}
+	hdr.kernel_size = r;
+	r = boot_place_section("ramdisk", ptr + page_size + kernel_actual,
+			       hdr.ramdisk_size, (void *) hdr.ramdisk_addr,
+			       BOOT_LZ4_MAX);
+	if (r < 0) {
+		fastboot_fail("invalid lz4 ramdisk");
+		return;
+	}
+	hdr.ramdisk_size = r;
 
+boot:
 	fastboot_okay("");
 	udc_stop();
 
+	boot_handoff_add((void *) hdr.kernel_addr, hdr.kernel_size);
 	boot_linux((void*) hdr.kernel_addr, (void*) hdr.tags_addr,
 		   (const char*) hdr.cmdline, board_machtype(),
 		   (void*) hdr.ramdisk_addr, hdr.ramdisk_size);
@@ -827,6 +1557,7 @@ void cmd_erase(const char *arg, void *data, unsigned sz)
 		return;
 	}
 
+	boot_cache_invalidate(ptn->name);
 	if (flash_erase(ptn)) {
 		fastboot_fail("failed to erase partition");
 		return;
@@ -848,6 +1579,7 @@ void cmd_erase_mmc(const char *arg, void *data, unsigned sz)
 		return;
 	}
 
+	boot_cache_invalidate(arg);
 	/* Simple inefficient version of erase. Just writing
 	   0 in first block */
 	if (mmc_write(ptn , 512, (unsigned int *)out)) {
@@ -858,7 +1590,105 @@ void cmd_erase_mmc(const char *arg, void *data, unsigned sz)
 }
 
 
-void cmd_flash_mmc_img(const char *arg, void *data, unsigned sz)
+/* read-back verification of flashed data, toggled with "oem verify" */
+#define VERIFY_CHUNK	(1024 * 1024)
+
+static int flash_verify = 0;
+static char flash_verify_var[4] = "off";
+static unsigned char *verify_buf;
+static unsigned long long verify_bad;
+static time_t verify_time;
+
+static int verify_alloc(void)
+{
+	if (!verify_buf)
+		verify_buf = memalign(32, VERIFY_CHUNK);
+	return verify_buf ? 0 : -1;
+}
+
+/* compare len bytes read back at verify_buf + at against src; returns
+ * the index of the first differing byte or -1 if they match
+ */
+static int verify_compare(const void *src, unsigned at, unsigned len)
+{
+	const unsigned char *a = verify_buf + at;
+	const unsigned char *b = src;
+	unsigned i;
+
+	if (!memcmp(a, b, len))
+		return -1;
+	for (i = 0; a[i] == b[i]; i++)
+		;
+	return i;
+}
+
+/*
+ * mmc_write() that, with verification enabled, writes the range in
+ * VERIFY_CHUNK pieces and reads each one back straight after it has been
+ * programmed, so a bad range is caught before the rest of the image goes
+ * out.  Returns 0 on success, -1 on write failure and 1 on a miscompare
+ * with verify_bad holding the byte address of the first bad byte.
+ */
+static int mmc_write_verify(unsigned long long addr, unsigned len, void *data)
+{
+	unsigned char *src = data;
+	unsigned n;
+	time_t start;
+	int bad;
+
+	if (!flash_verify)
+		return mmc_write(addr, len, (unsigned int *) data) ? -1 : 0;
+
+	if (verify_alloc())
+		return -1;
+
+	while (len) {
+		n = MIN(len, VERIFY_CHUNK);
+		if (mmc_write(addr, n, (unsigned int *) src))
+			return -1;
+
+		start = current_time();
+		if (mmc_read(addr, (unsigned int *) verify_buf,
+			     ROUND_TO_PAGE(n, 511))) {
+			verify_bad = addr;
+			return 1;
+		}
+		bad = verify_compare(src, 0, n);
+		verify_time += current_time() - start;
+		if (bad >= 0) {
+			verify_bad = addr + bad;
+			return 1;
+		}
+
+		addr += n;
+		src += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static void verify_fail(unsigned long long ptn_base)
+{
+	char response[64];
+
+	dprintf(CRITICAL, "verify failed at offset 0x%llx\n",
+		verify_bad - ptn_base);
+	snprintf(response, 64, "verify failed at offset 0x%llx",
+		 verify_bad - ptn_base);
+	fastboot_fail(response);
+}
+
+static void verify_report(void)
+{
+	char response[64];
+
+	if (!flash_verify)
+		return;
+	snprintf(response, 64, "verified (%lu ms readback)", verify_time);
+	fastboot_info(response);
+}
+
+static int flash_mmc_img(const char *arg, void *data, unsigned sz)
 {
 	unsigned long long ptn = 0;
 	unsigned long long size = 0;
@@ -869,7 +1699,7 @@ void cmd_flash_mmc_img(const char *arg, void *data, unsigned sz)
 		dprintf(INFO, "Attempt to write partition image.\n");
 		if (mmc_write_partition(sz, (unsigned char *) data)) {
 			fastboot_fail("failed to write partition");
-			return;
+			return -1;
 		}
 	}
 	else
@@ -878,31 +1708,39 @@ void cmd_flash_mmc_img(const char *arg, void *data, unsigned sz)
 		ptn = partition_get_offset(index);
 		if(ptn == 0) {
 			fastboot_fail("partition table doesn't exist");
-			return;
+			return -1;
 		}
 
 		if (!strcmp(arg, "boot") || !strcmp(arg, "recovery")) {
 			if (memcmp((void *)data, BOOT_MAGIC, BOOT_MAGIC_SIZE)) {
 				fastboot_fail("image is not a boot image");
-				return;
+				return -1;
 			}
 		}
 
 		size = partition_get_size(index);
 		if (ROUND_TO_PAGE(sz,511) > size) {
 			fastboot_fail("size too large");
-			return;
+			return -1;
 		}
-		else if (mmc_write(ptn , sz, (unsigned int *)data)) {
+
+		verify_time = 0;
+		switch (mmc_write_verify(ptn, sz, data)) {
+		case 0:
+			break;
+		case 1:
+			verify_fail(ptn);
+			return -1;
+		default:
 			fastboot_fail("flash write failure");
-			return;
+			return -1;
 		}
+		verify_report();
 	}
-	fastboot_okay("");
-	return;
+	return 0;
 }
 
-void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
+static int flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 {
 	unsigned int chunk;
 	unsigned int chunk_data_sz;
@@ -911,12 +1749,13 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 	uint32_t total_blocks = 0;
 	unsigned long long ptn = 0;
 	int index = INVALID_PTN;
+	int ret;
 
 	index = partition_get_index(arg);
 	ptn = partition_get_offset(index);
 	if(ptn == 0) {
 		fastboot_fail("partition table doesn't exist");
-		return;
+		return -1;
 	}
 
 	/* Read and skip over sparse image header */
@@ -940,6 +1779,8 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 	dprintf (SPEW, "total_blks: %d\n", sparse_header->total_blks);
 	dprintf (SPEW, "total_chunks: %d\n", sparse_header->total_chunks);
 
+	verify_time = 0;
+
 	/* Start processing chunks */
 	for (chunk=0; chunk<sparse_header->total_chunks; chunk++)
 	{
@@ -968,15 +1809,21 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 											chunk_data_sz))
 			{
 				fastboot_fail("Bogus chunk size for chunk type Raw");
-				return;
+				return -1;
 			}
 
-			if(mmc_write(ptn + ((uint64_t)total_blocks*sparse_header->blk_sz),
-						chunk_data_sz,
-						(unsigned int*)data))
+			ret = mmc_write_verify(ptn +
+					((uint64_t)total_blocks*sparse_header->blk_sz),
+					chunk_data_sz, data);
+			if (ret == 1)
+			{
+				verify_fail(ptn);
+				return -1;
+			}
+			else if (ret)
 			{
 				fastboot_fail("flash write failure");
-				return;
+				return -1;
 			}
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
@@ -990,7 +1837,7 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 			if(chunk_header->total_sz != sparse_header->chunk_hdr_sz)
 			{
 				fastboot_fail("Bogus chunk size for chunk type Dont Care");
-				return;
+				return -1;
 			}
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
@@ -998,7 +1845,7 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 
 			default:
 			fastboot_fail("Unknown chunk type");
-			return;
+			return -1;
 		}
 	}
 
@@ -1008,13 +1855,14 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 	if(total_blocks != sparse_header->total_blks)
 	{
 		fastboot_fail("sparse image write failure");
+		return -1;
 	}
 
-	fastboot_okay("");
-	return;
+	verify_report();
+	return 0;
 }
 
-void cmd_flash_mmc(const char *arg, void *data, unsigned sz)
+static int flash_mmc(const char *arg, void *data, unsigned sz)
 {
 	sparse_header_t *sparse_header;
 	/* 8 Byte Magic + 2048 Byte xml + Encrypted Data */
@@ -1029,18 +1877,63 @@ void cmd_flash_mmc(const char *arg, void *data, unsigned sz)
 #endif
 		if (ret != 0) {
 			dprintf(CRITICAL, "ERROR: Invalid secure image\n");
-			return;
+			fastboot_fail("invalid secure image");
+			return -1;
 		}
 	}
+	/* a new partition table may move any partition */
+	boot_cache_invalidate(strcmp(arg, "partition") ? arg : NULL);
+
 	sparse_header = (sparse_header_t *) data;
 	if (sparse_header->magic != SPARSE_HEADER_MAGIC)
-		cmd_flash_mmc_img(arg, data, sz);
+		return flash_mmc_img(arg, data, sz);
 	else
-		cmd_flash_mmc_sparse_img(arg, data, sz);
-	return;
+		return flash_mmc_sparse_img(arg, data, sz);
 }
 
-void cmd_flash(const char *arg, void *data, unsigned sz)
+/*
+ * Read a just written NAND partition back in VERIFY_CHUNK pieces.  The
+ * spare bytes of yaffs images are not compared since the controller
+ * adds its own ECC bytes to them.
+ */
+static int flash_verify_nand(struct ptentry *ptn, unsigned extra,
+			     void *data, unsigned sz)
+{
+	unsigned char *src = data;
+	unsigned stride = page_size + extra;
+	unsigned pages = VERIFY_CHUNK / stride;
+	unsigned offset = 0;
+	unsigned n, i;
+	time_t start;
+	int bad;
+
+	if (verify_alloc())
+		return -1;
+
+	verify_time = 0;
+	while (sz) {
+		n = MIN(sz, pages * stride);
+		start = current_time();
+		if (flash_read_ext(ptn, extra, offset, verify_buf, n)) {
+			verify_bad = offset;
+			return -1;
+		}
+		for (i = 0; i < n; i += stride) {
+			bad = verify_compare(src + i, i, MIN(page_size, n - i));
+			if (bad >= 0) {
+				verify_bad = offset + i / stride * page_size + bad;
+				return -1;
+			}
+		}
+		verify_time += current_time() - start;
+		offset += (n / stride) * page_size;
+		src += n;
+		sz -= n;
+	}
+	return 0;
+}
+
+static int flash_nand(const char *arg, void *data, unsigned sz)
 {
 	struct ptentry *ptn;
 	struct ptable *ptable;
@@ -1049,19 +1942,19 @@ void cmd_flash(const char *arg, void *data, unsigned sz)
 	ptable = flash_get_ptable();
 	if (ptable == NULL) {
 		fastboot_fail("partition table doesn't exist");
-		return;
+		return -1;
 	}
 
 	ptn = ptable_find(ptable, arg);
 	if (ptn == NULL) {
 		fastboot_fail("unknown partition name");
-		return;
+		return -1;
 	}
 
 	if (!strcmp(ptn->name, "boot") || !strcmp(ptn->name, "recovery")) {
 		if (memcmp((void *)data, BOOT_MAGIC, BOOT_MAGIC_SIZE)) {
 			fastboot_fail("image is not a boot image");
-			return;
+			return -1;
 		}
 	}
 
@@ -1076,14 +1969,408 @@ void cmd_flash(const char *arg, void *data, unsigned sz)
 		sz = ROUND_TO_PAGE(sz, page_mask);
 
 	dprintf(INFO, "writing %d bytes to '%s'\n", sz, ptn->name);
+	boot_cache_invalidate(ptn->name);
 	if (flash_write(ptn, extra, data, sz)) {
 		fastboot_fail("flash write failure");
-		return;
+		return -1;
 	}
 	dprintf(INFO, "partition '%s' updated\n", ptn->name);
+
+	if (flash_verify) {
+		if (flash_verify_nand(ptn, extra, data, sz)) {
+			verify_fail(0);
+			return -1;
+		}
+		verify_report();
+	}
+	return 0;
+}
+
+static int flash_partition(const char *arg, void *data, unsigned sz)
+{
+	if (target_is_emmc_boot())
+		return flash_mmc(arg, data, sz);
+	return flash_nand(arg, data, sz);
+}
+
+static int bundle_partition_exists(const char *name)
+{
+	struct ptable *ptable;
+
+	if (target_is_emmc_boot()) {
+		if (!strcmp(name, "partition"))
+			return 1;
+		return partition_get_offset(partition_get_index(name)) != 0;
+	}
+
+	ptable = flash_get_ptable();
+	return ptable && ptable_find(ptable, name);
+}
+
+/*
+ * Check every entry before touching flash so that a truncated or
+ * mistyped bundle is rejected without leaving half a device written.
+ */
+static int bundle_check(bundle_header_t *hdr, unsigned sz)
+{
+	bundle_entry_t *e;
+	char response[64];
+	unsigned i;
+
+	if (sz < sizeof(*hdr) || hdr->version != BUNDLE_VERSION ||
+	    hdr->entry_sz < sizeof(*e) || hdr->header_sz < sizeof(*hdr) ||
+	    hdr->total_sz > sz) {
+		fastboot_fail("bad bundle header");
+		return -1;
+	}
+	if (hdr->header_sz + hdr->entry_count * hdr->entry_sz > hdr->total_sz) {
+		fastboot_fail("bundle truncated");
+		return -1;
+	}
+
+	for (i = 0; i < hdr->entry_count; i++) {
+		e = (void *) hdr + hdr->header_sz + i * hdr->entry_sz;
+		if (e->name[BUNDLE_NAME_SIZE - 1] != 0 ||
+		    e->offset % BUNDLE_ALIGN ||
+		    e->offset > hdr->total_sz ||
+		    e->size > hdr->total_sz - e->offset) {
+			fastboot_fail("bad bundle entry");
+			return -1;
+		}
+		if (!bundle_partition_exists(e->name)) {
+			snprintf(response, sizeof(response),
+				 "unknown partition '%.24s'", e->name);
+			fastboot_fail(response);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* inflate an lz4 payload into the scratch space behind the bundle */
+static int bundle_inflate(bundle_entry_t *e, void *payload,
+			  void *out, unsigned out_max)
+{
+	struct lz4_frame f;
+	unsigned used, in = 0;
+	int ret;
+
+	lz4_frame_init(&f, out, out_max);
+	do {
+		ret = lz4_frame_decode(&f, payload + in, e->size - in, &used, true);
+		in += used;
+	} while (ret == LZ4_FRAME_OK);
+
+	if (ret == LZ4_FRAME_NOSPACE) {
+		fastboot_fail("bundle entry too large");
+		return -1;
+	}
+	if (ret != LZ4_FRAME_DONE) {
+		fastboot_fail("bad lz4 payload");
+		return -1;
+	}
+	return f.out_len;
+}
+
+static void flash_bundle(void *data, unsigned sz)
+{
+	bundle_header_t *hdr = data;
+	bundle_entry_t *e;
+	char response[64];
+	unsigned char *out;
+	unsigned out_max, max, i, len;
+	unsigned long long total = 0;
+	time_t start, t;
+	void *payload;
+	int ret;
+
+	if (bundle_check(hdr, sz))
+		return;
+
+	/* lz4 payloads are inflated into whatever scratch space is left */
+	len = ROUNDUP(hdr->total_sz, BUNDLE_ALIGN);
+	max = target_get_max_flash_size();
+	out = data + len;
+	out_max = (max > len) ? max - len : 0;
+
+	start = current_time();
+	for (i = 0; i < hdr->entry_count; i++) {
+		e = data + hdr->header_sz + i * hdr->entry_sz;
+		payload = data + e->offset;
+		len = e->size;
+
+		t = current_time();
+		if (e->flags & BUNDLE_FLAG_LZ4) {
+			ret = bundle_inflate(e, payload, out, out_max);
+			if (ret < 0)
+				return;
+			payload = out;
+			len = ret;
+		}
+
+		dprintf(INFO, "bundle: writing %u bytes to '%s'\n", len, e->name);
+		if (flash_partition(e->name, payload, len))
+			return;
+
+		t = current_time() - t;
+		snprintf(response, sizeof(response), "%.20s: %u KB in %lu ms",
+			 e->name, len / 1024, t);
+		fastboot_info(response);
+		total += len;
+	}
+
+	t = current_time() - start;
+	snprintf(response, sizeof(response), "bundle: %u images, %llu KB in %lu ms",
+		 hdr->entry_count, total / 1024, t);
+	fastboot_info(response);
 	fastboot_okay("");
 }
 
+void cmd_flash_mmc(const char *arg, void *data, unsigned sz)
+{
+	bundle_header_t *hdr = data;
+
+	if (sz >= sizeof(*hdr) && hdr->magic == BUNDLE_MAGIC) {
+		flash_bundle(data, sz);
+		return;
+	}
+	if (!flash_mmc(arg, data, sz))
+		fastboot_okay("");
+}
+
+void cmd_flash(const char *arg, void *data, unsigned sz)
+{
+	bundle_header_t *hdr = data;
+
+	if (sz >= sizeof(*hdr) && hdr->magic == BUNDLE_MAGIC) {
+		flash_bundle(data, sz);
+		return;
+	}
+	if (!flash_nand(arg, data, sz))
+		fastboot_okay("");
+}
+
+/* source of a fetch: an eMMC byte range or a window into a NAND partition */
+struct fetch_src {
+	unsigned long long base;
+	struct ptentry *ptn;
+	unsigned end;		/* NAND: reads stop here */
+	unsigned char *window;
+	unsigned window_size;
+	unsigned window_offset;
+	int window_valid;
+};
+
+/* NAND reads are staged through this many bytes at a time */
+#define FETCH_NAND_WINDOW	(1024 * 1024)
+
+static int fetch_fill_mmc(void *buf, unsigned offset, unsigned len, void *arg)
+{
+	struct fetch_src *src = arg;
+
+	if (mmc_read(src->base + offset, (unsigned int *) buf,
+		     ROUND_TO_PAGE(len, 511)))
+		return -1;
+	return 0;
+}
+
+static int fetch_fill_nand(void *buf, unsigned offset, unsigned len, void *arg)
+{
+	struct fetch_src *src = arg;
+	unsigned char *dst = buf;
+	unsigned pos = src->base + offset;
+	unsigned start, n;
+
+	/* flash_read_ext rescans bad blocks from the partition start on
+	 * every call, so read whole windows and serve chunks out of them.
+	 * The last window stops at the end of the fetch: past the good
+	 * pages of the partition the read fails.
+	 */
+	while (len) {
+		start = ROUNDDOWN(pos, src->window_size);
+		if (!src->window_valid || src->window_offset != start) {
+			src->window_valid = 0;
+			if (flash_read(src->ptn, start, src->window,
+				       MIN(src->window_size,
+					   src->end - start)))
+				return -1;
+			src->window_offset = start;
+			src->window_valid = 1;
+		}
+		n = MIN(len, start + src->window_size - pos);
+		memcpy(dst, src->window + (pos - start), n);
+		dst += n;
+		pos += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* parse "<partition>[:offset:size]"; size defaults to the rest */
+static int fetch_parse_arg(const char *arg, char *name, unsigned name_len,
+			   unsigned long long *offset, unsigned long long *size)
+{
+	const char *sep = strchr(arg, ':');
+	unsigned len = sep ? (unsigned) (sep - arg) : strlen(arg);
+
+	if (len == 0 || len >= name_len)
+		return -1;
+	memcpy(name, arg, len);
+	name[len] = 0;
+
+	*offset = 0;
+	*size = ~0ULL;
+	if (sep) {
+		*offset = atoull(sep + 1);
+		sep = strchr(sep + 1, ':');
+		if (!sep)
+			return -1;
+		*size = atoull(sep + 1);
+	}
+	return 0;
+}
+
+static int fetch_check_range(unsigned long long ptn_size,
+			     unsigned long long offset, unsigned long long *size)
+{
+	if (offset > ptn_size) {
+		fastboot_fail("offset out of range");
+		return -1;
+	}
+	if (*size == ~0ULL)
+		*size = ptn_size - offset;
+	else if (*size > ptn_size - offset) {
+		fastboot_fail("size out of range");
+		return -1;
+	}
+	if (*size > 0xffffffffULL) {
+		fastboot_fail("size too large, fetch in pieces");
+		return -1;
+	}
+	return 0;
+}
+
+static void fetch_info_sha256(const unsigned char *digest)
+{
+	char response[64];
+	char hex[2 * SHA256_DIGEST_LENGTH + 1];
+	int i;
+
+	for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+		snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+
+	snprintf(response, 64, "sha256 %.32s", hex);
+	fastboot_info(response);
+	snprintf(response, 64, "       %.32s", hex + 32);
+	fastboot_info(response);
+}
+
+static void do_fetch_mmc(const char *arg, int hash)
+{
+	struct fetch_src src;
+	char name[MAX_GPT_NAME_SIZE];
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	unsigned long long ptn, offset, size;
+	int index;
+
+	if (fetch_parse_arg(arg, name, sizeof(name), &offset, &size)) {
+		fastboot_fail("usage: fetch:<partition>[:offset:size]");
+		return;
+	}
+
+	index = partition_get_index(name);
+	ptn = partition_get_offset(index);
+	if(ptn == 0) {
+		fastboot_fail("partition table doesn't exist");
+		return;
+	}
+
+	if (fetch_check_range(partition_get_size(index), offset, &size))
+		return;
+	if (offset & 511) {
+		fastboot_fail("offset must be 512 byte aligned");
+		return;
+	}
+
+	memset(&src, 0, sizeof(src));
+	src.base = ptn + offset;
+
+	if (fastboot_upload(size, fetch_fill_mmc, &src, hash ? digest : NULL))
+		return;
+	if (hash)
+		fetch_info_sha256(digest);
+	fastboot_okay("");
+}
+
+static void do_fetch(const char *arg, int hash)
+{
+	struct fetch_src src;
+	struct ptable *ptable;
+	struct flash_info *flash_info = flash_get_info();
+	char name[MAX_PTENTRY_NAME];
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	unsigned long long offset, size;
+
+	if (fetch_parse_arg(arg, name, sizeof(name), &offset, &size)) {
+		fastboot_fail("usage: fetch:<partition>[:offset:size]");
+		return;
+	}
+
+	ptable = flash_get_ptable();
+	if (ptable == NULL) {
+		fastboot_fail("partition table doesn't exist");
+		return;
+	}
+
+	memset(&src, 0, sizeof(src));
+	src.ptn = ptable_find(ptable, name);
+	if (src.ptn == NULL) {
+		fastboot_fail("unknown partition name");
+		return;
+	}
+
+	if (fetch_check_range((unsigned long long) src.ptn->length *
+			      flash_info->block_size, offset, &size))
+		return;
+
+	src.base = offset;
+	src.end = ROUNDUP(offset + size, flash_info->page_size);
+	src.window_size = ROUNDUP(FETCH_NAND_WINDOW, flash_info->block_size);
+	src.window = memalign(32, src.window_size);
+	if (src.window == NULL) {
+		fastboot_fail("out of memory");
+		return;
+	}
+
+	if (!fastboot_upload(size, fetch_fill_nand, &src,
+			     hash ? digest : NULL)) {
+		if (hash)
+			fetch_info_sha256(digest);
+		fastboot_okay("");
+	}
+	free(src.window);
+}
+
+void cmd_fetch_mmc(const char *arg, void *data, unsigned sz)
+{
+	do_fetch_mmc(arg, 0);
+}
+
+void cmd_fetch_mmc_sha256(const char *arg, void *data, unsigned sz)
+{
+	do_fetch_mmc(arg, 1);
+}
+
+void cmd_fetch(const char *arg, void *data, unsigned sz)
+{
+	do_fetch(arg, 0);
+}
+
+void cmd_fetch_sha256(const char *arg, void *data, unsigned sz)
+{
+	do_fetch(arg, 1);
+}
+
 void cmd_continue(const char *arg, void *data, unsigned sz)
 {
 	fastboot_okay("");
@@ -1132,6 +2419,57 @@ void cmd_oem_devinfo(const char *arg, void *data, unsigned sz)
 	fastboot_okay("");
 }
 
+void cmd_oem_verify(const char *arg, void *data, unsigned sz)
+{
+	while (*arg == ' ')
+		arg++;
+
+	if (!strcmp(arg, "on"))
+		flash_verify = 1;
+	else if (!strcmp(arg, "off"))
+		flash_verify = 0;
+	else if (*arg) {
+		fastboot_fail("usage: oem verify [on|off]");
+		return;
+	}
+
+	strcpy(flash_verify_var, flash_verify ? "on" : "off");
+	fastboot_okay(flash_verify_var);
+}
+
+/* storage statistics for getvar, see iostat.h */
+static void var_mmc_read_lat(char *buf, unsigned size)
+{
+	iostat_hist_format(&mmc_get_stats()->read_lat, buf, size);
+}
+
+static void var_mmc_write_lat(char *buf, unsigned size)
+{
+	iostat_hist_format(&mmc_get_stats()->write_lat, buf, size);
+}
+
+static void var_nand_read_lat(char *buf, unsigned size)
+{
+	iostat_hist_format(&nand_get_stats()->read_lat, buf, size);
+}
+
+static void var_nand_write_lat(char *buf, unsigned size)
+{
+	iostat_hist_format(&nand_get_stats()->write_lat, buf, size);
+}
+
+void cmd_oem_iostat(const char *arg, void *data, unsigned sz)
+{
+	while (*arg == ' ')
+		arg++;
+
+	if (!strcmp(arg, "reset"))
+		iostat_reset();
+	else
+		iostat_dump();
+	fastboot_okay("");
+}
+
 void splash_screen ()
 {
 	struct ptentry *ptn;
@@ -1186,6 +2524,8 @@ void aboot_init(const struct app_descriptor *app)
 
 	}
 
+	boot_prefetch_start();
+
 	target_serialno((unsigned char *) sn_buf);
 	dprintf(SPEW,"serial number: %s\n",sn_buf);
 	surf_udc_device.serialno = sn_buf;
@@ -1219,6 +2559,19 @@ void aboot_init(const struct app_descriptor *app)
 		goto fastboot;
 	}
 
+#if WITH_BOOT_MENU
+	if (!boot_into_recovery && target_is_emmc_boot()) {
+		const struct boot_menu_entry *e = boot_menu_pick();
+
+		if (e && !e->ptn)
+			goto fastboot;
+		if (e && !strcmp(e->ptn, "recovery"))
+			boot_into_recovery = 1;
+		else if (e && strcmp(e->ptn, "boot"))
+			boot_menu_ptn = e->ptn;
+	}
+#endif
+
 	if (target_is_emmc_boot())
 	{
 		if(emmc_recovery_init())
@@ -1232,6 +2585,8 @@ void aboot_init(const struct app_descriptor *app)
 			#endif
 			}
 		}
+		if (!boot_into_recovery && !boot_menu_ptn)
+			resume_from_mmc();
 		boot_linux_from_mmc();
 	}
 	else
@@ -1244,22 +2599,28 @@ void aboot_init(const struct app_descriptor *app)
 
 fastboot:
 
+	boot_prefetch_wait();
 	target_fastboot_init();
 
 	if(!usb_init)
 		udc_init(&surf_udc_device);
 
-	fastboot_register("boot", cmd_boot);
+	fastboot_register_scattered("boot", cmd_boot);
+	fastboot_set_scatter(boot_download_scatter);
 
 	if (target_is_emmc_boot())
 	{
 		fastboot_register("flash:", cmd_flash_mmc);
 		fastboot_register("erase:", cmd_erase_mmc);
+		fastboot_register("fetch:", cmd_fetch_mmc);
+		fastboot_register("fetch-sha256:", cmd_fetch_mmc_sha256);
 	}
 	else
 	{
 		fastboot_register("flash:", cmd_flash);
 		fastboot_register("erase:", cmd_erase);
+		fastboot_register("fetch:", cmd_fetch);
+		fastboot_register("fetch-sha256:", cmd_fetch_sha256);
 	}
 
 	fastboot_register("continue", cmd_continue);
@@ -1267,6 +2628,18 @@ fastboot:
 	fastboot_register("reboot-bootloader", cmd_reboot_bootloader);
 	fastboot_register("oem unlock", cmd_oem_unlock);
 	fastboot_register("oem device-info", cmd_oem_devinfo);
+	fastboot_register("oem verify", cmd_oem_verify);
+	fastboot_register("oem iostat", cmd_oem_iostat);
+	fastboot_publish("verify", flash_verify_var);
+	if (target_is_emmc_boot()) {
+		fastboot_publish_fn("mmc-io", iostat_mmc_format);
+		fastboot_publish_fn("mmc-read-us", var_mmc_read_lat);
+		fastboot_publish_fn("mmc-write-us", var_mmc_write_lat);
+	} else {
+		fastboot_publish_fn("nand-io", iostat_nand_format);
+		fastboot_publish_fn("nand-read-us", var_nand_read_lat);
+		fastboot_publish_fn("nand-write-us", var_nand_write_lat);
+	}
 	fastboot_publish("product", TARGET(BOARD));
 	fastboot_publish("kernel", "lk");
 	partition_dump();
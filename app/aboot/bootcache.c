@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor
+ *       the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <string.h>
+#include <stdlib.h>
+#include <target.h>
+#include <platform.h>
+#include <arch/ops.h>
+
+#include "bootcache.h"
+
+/*
+ * Region layout: a control block, then the kernel and the ramdisk,
+ * each starting on a 4K boundary.  The control block is covered by its
+ * own crc so random contents after a cold boot never look valid; the
+ * data crc catches anything that scribbled on the region since.
+ *
+ * 'generation' counts writes and erases of the cached partition made
+ * through fastboot; 'cached' is its value when the image was stored.
+ * The header page is compared with the one just read from storage, so
+ * images rewritten by other means (the id[] hash mkbootimg puts in the
+ * header changes with the contents) are not reused either.
+ */
+#define BOOT_CACHE_MAGIC	0x43544f42	/* "BOTC" */
+#define BOOT_CACHE_PTN_SIZE	32
+#define BOOT_CACHE_PAGE_MAX	4096
+#define BOOT_CACHE_ALIGN	4096
+
+struct boot_cache {
+	uint32_t magic;
+	uint32_t generation;
+	uint32_t cached;
+	char ptn[BOOT_CACHE_PTN_SIZE];
+	uint32_t page_size;
+	uint32_t kernel_size;
+	uint32_t ramdisk_size;
+	uint32_t data_crc;
+	unsigned char page[BOOT_CACHE_PAGE_MAX];
+	uint32_t crc;		/* over everything above */
+};
+
+#define BOOT_CACHE_CRC_LEN	(sizeof(struct boot_cache) - sizeof(uint32_t))
+#define BOOT_CACHE_DATA	ROUNDUP(sizeof(struct boot_cache), BOOT_CACHE_ALIGN)
+
+static uint32_t crc_table[256];
+
+/* header page of the last miss, as read from storage */
+static unsigned char miss_page[BOOT_CACHE_PAGE_MAX];
+static unsigned miss_page_size;
+static char miss_ptn[BOOT_CACHE_PTN_SIZE];
+
+static uint32_t crc32(uint32_t crc, const void *buf, unsigned len)
+{
+	const unsigned char *p = buf;
+	unsigned i, j;
+	uint32_t c;
+
+	if (!crc_table[1]) {
+		for (i = 0; i < 256; i++) {
+			c = i;
+			for (j = 0; j < 8; j++)
+				c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			crc_table[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	while (len--)
+		crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static struct boot_cache *boot_cache_get(unsigned *size)
+{
+	struct boot_cache *bc = target_get_boot_cache(size);
+
+	if (!bc || *size <= BOOT_CACHE_DATA)
+		return NULL;
+	return bc;
+}
+
+static int boot_cache_valid(struct boot_cache *bc)
+{
+	return bc->magic == BOOT_CACHE_MAGIC &&
+		bc->crc == crc32(0, bc, BOOT_CACHE_CRC_LEN);
+}
+
+/* reseal the control block and push it out to RAM past a warm reset */
+static void boot_cache_seal(struct boot_cache *bc)
+{
+	bc->crc = crc32(0, bc, BOOT_CACHE_CRC_LEN);
+	arch_clean_cache_range((addr_t) bc, sizeof(*bc));
+}
+
+int boot_cache_restore(const char *ptn, struct boot_img_hdr *hdr,
+		       unsigned page_size)
+{
+	struct boot_cache *bc;
+	unsigned char *data;
+	unsigned size;
+	time_t start = current_time();
+
+	miss_page_size = 0;
+	bc = boot_cache_get(&size);
+	if (!bc || page_size > BOOT_CACHE_PAGE_MAX)
+		return -1;
+
+	if (!boot_cache_valid(bc) || bc->cached != bc->generation ||
+	    strncmp(bc->ptn, ptn, BOOT_CACHE_PTN_SIZE) ||
+	    bc->page_size != page_size || memcmp(bc->page, hdr, page_size))
+		goto miss;
+
+	data = (unsigned char *) bc + BOOT_CACHE_DATA;
+	if (crc32(0, data, ROUNDUP(bc->kernel_size, BOOT_CACHE_ALIGN) +
+		  bc->ramdisk_size) != bc->data_crc) {
+		dprintf(INFO, "boot cache: data corrupted\n");
+		goto miss;
+	}
+
+	memcpy((void *) hdr->kernel_addr, data, bc->kernel_size);
+	memcpy((void *) hdr->ramdisk_addr,
+	       data + ROUNDUP(bc->kernel_size, BOOT_CACHE_ALIGN),
+	       bc->ramdisk_size);
+	hdr->kernel_size = bc->kernel_size;
+	hdr->ramdisk_size = bc->ramdisk_size;
+
+	dprintf(INFO, "boot cache: '%s' restored (%u bytes) in %lu ms\n",
+		ptn, bc->kernel_size + bc->ramdisk_size,
+		current_time() - start);
+	return 0;
+
+miss:
+	memcpy(miss_page, hdr, page_size);
+	miss_page_size = page_size;
+	strncpy(miss_ptn, ptn, BOOT_CACHE_PTN_SIZE - 1);
+	return -1;
+}
+
+void boot_cache_store(const char *ptn, const struct boot_img_hdr *hdr)
+{
+	struct boot_cache *bc;
+	unsigned char *data;
+	unsigned size, kernel_actual;
+	uint32_t generation = 0;
+
+	bc = boot_cache_get(&size);
+	if (!bc || !miss_page_size ||
+	    strncmp(miss_ptn, ptn, BOOT_CACHE_PTN_SIZE))
+		return;
+
+	kernel_actual = ROUNDUP(hdr->kernel_size, BOOT_CACHE_ALIGN);
+	if (kernel_actual + hdr->ramdisk_size > size - BOOT_CACHE_DATA) {
+		dprintf(INFO, "boot cache: image too large\n");
+		return;
+	}
+
+	if (boot_cache_valid(bc))
+		generation = bc->generation;
+
+	data = (unsigned char *) bc + BOOT_CACHE_DATA;
+	memcpy(data, (void *) hdr->kernel_addr, hdr->kernel_size);
+	memset(data + hdr->kernel_size, 0, kernel_actual - hdr->kernel_size);
+	memcpy(data + kernel_actual, (void *) hdr->ramdisk_addr,
+	       hdr->ramdisk_size);
+	arch_clean_cache_range((addr_t) data, kernel_actual + hdr->ramdisk_size);
+
+	memset(bc, 0, sizeof(*bc));
+	bc->magic = BOOT_CACHE_MAGIC;
+	bc->generation = generation;
+	bc->cached = generation;
+	strncpy(bc->ptn, ptn, BOOT_CACHE_PTN_SIZE - 1);
+	bc->page_size = miss_page_size;
+	bc->kernel_size = hdr->kernel_size;
+	bc->ramdisk_size = hdr->ramdisk_size;
+	bc->data_crc = crc32(0, data, kernel_actual + hdr->ramdisk_size);
+	memcpy(bc->page, miss_page, miss_page_size);
+	boot_cache_seal(bc);
+	miss_page_size = 0;
+}
+
+void boot_cache_invalidate(const char *ptn)
+{
+	struct boot_cache *bc;
+	unsigned size;
+
+	bc = boot_cache_get(&size);
+	if (!bc || !boot_cache_valid(bc))
+		return;
+	if (ptn && strncmp(bc->ptn, ptn, BOOT_CACHE_PTN_SIZE))
+		return;
+
+	bc->generation++;
+	boot_cache_seal(bc);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor
+ *       the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BOOTCACHE_H_
+#define _BOOTCACHE_H_
+
+#include "bootimg.h"
+
+/*
+ * Copy of the last booted kernel and ramdisk kept in RAM the kernel is
+ * not given (target_get_boot_cache()), so a warm reset can boot again
+ * without reading them from storage.
+ */
+
+/* restore kernel and ramdisk of partition 'ptn' to their load addresses
+ * if the cache holds the image whose header page 'hdr' was just read
+ * from storage; on a hit hdr->kernel_size and hdr->ramdisk_size are set
+ * to the sizes in memory and 0 is returned
+ */
+int boot_cache_restore(const char *ptn, struct boot_img_hdr *hdr,
+		       unsigned page_size);
+
+/* remember the image loaded after a boot_cache_restore() miss for 'ptn';
+ * sizes in 'hdr' are as in memory
+ */
+void boot_cache_store(const char *ptn, const struct boot_img_hdr *hdr);
+
+/* called when 'ptn' is written or erased, NULL for all partitions */
+void boot_cache_invalidate(const char *ptn);
+
+#endif
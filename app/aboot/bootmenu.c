@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor
+ *       the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Text boot menu on the framebuffer console, driven by the volume keys
+ * (move) and home (pick).  Entry 0 is picked when the timeout runs out
+ * before any key is pressed.  Loading is left to the caller through the
+ * highlight hook, so the entry under the cursor can be read while the
+ * user is still choosing.
+ */
+
+#include <debug.h>
+#include <string.h>
+#include <platform.h>
+#include <kernel/thread.h>
+#include <dev/keys.h>
+#include <dev/fbcon.h>
+
+#include "bootmenu.h"
+
+#define BOOT_MENU_POLL		20	/* ms, as the keypad scan */
+
+/*
+ * Targets with no key but the volume keys: volume down moves, wrapping
+ * round to the top, and volume up picks.
+ */
+#if BOOT_MENU_VOLUME_KEYS_ONLY
+#define BOOT_MENU_KEY_UP	0
+#define BOOT_MENU_KEY_PICK	KEY_VOLUMEUP
+#define BOOT_MENU_HELP		"volume down to move, volume up to boot"
+#else
+#define BOOT_MENU_KEY_UP	KEY_VOLUMEUP
+#define BOOT_MENU_KEY_PICK	KEY_HOME
+#define BOOT_MENU_HELP		"volume keys to move, home to boot"
+#endif
+
+static const char *boot_menu_state[] = {
+	[BOOT_MENU_NONE]	= "",
+	[BOOT_MENU_LOADING]	= "loading",
+	[BOOT_MENU_READY]	= "ready",
+	[BOOT_MENU_FAILED]	= "bad image",
+};
+
+static void boot_menu_draw(struct boot_menu *m, unsigned sel, int *status,
+			   time_t left)
+{
+	unsigned i;
+
+	if (fbcon_display()) {
+		fbcon_clear();
+		fbcon_set_cursor(0, 0);
+	}
+
+	dprintf(ALWAYS, "Boot menu: " BOOT_MENU_HELP "\n\n");
+	for (i = 0; i < m->count; i++)
+		dprintf(ALWAYS, "%c %-16s %s\n", (i == sel) ? '>' : ' ',
+			m->entry[i]->label, boot_menu_state[status[i]]);
+	if (left)
+		dprintf(ALWAYS, "\n%s in %lu s\n", m->entry[0]->label,
+			(left + 999) / 1000);
+}
+
+/* a key that went down since the last poll */
+static int boot_menu_pressed(uint16_t code, int *was)
+{
+	int now = keys_get_state(code) != 0;
+	int pressed = now && !*was;
+
+	*was = now;
+	return pressed;
+}
+
+unsigned boot_menu_run(struct boot_menu *m)
+{
+	int status[m->count];
+	int up = 1, down = 1, pick = 1;
+	time_t deadline = current_time() + m->timeout;
+	time_t left, shown = ~0UL;
+	unsigned sel = 0, i;
+	int redraw = 1, s;
+
+	memset(status, 0, sizeof(status));
+	if (m->highlight)
+		m->highlight(m->entry[sel]);
+
+	for (;;) {
+		left = 0;
+		if (deadline) {
+			if (current_time() >= deadline)
+				break;
+			left = deadline - current_time();
+			if ((left + 999) / 1000 != (shown + 999) / 1000)
+				redraw = 1;
+		}
+
+		for (i = 0; i < m->count; i++) {
+			s = m->status ? m->status(m->entry[i]) : BOOT_MENU_NONE;
+			if (s != status[i]) {
+				status[i] = s;
+				redraw = 1;
+			}
+		}
+		if (redraw) {
+			boot_menu_draw(m, sel, status, left);
+			shown = left;
+			redraw = 0;
+		}
+
+		thread_sleep(BOOT_MENU_POLL);
+
+		/* keys held since before the menu came up do not count */
+		if (BOOT_MENU_KEY_UP &&
+		    boot_menu_pressed(BOOT_MENU_KEY_UP, &up) && sel > 0)
+			sel--;
+		else if (boot_menu_pressed(KEY_VOLUMEDOWN, &down) &&
+			 (sel + 1 < m->count || !BOOT_MENU_KEY_UP))
+			sel = (sel + 1) % m->count;
+		else if (boot_menu_pressed(BOOT_MENU_KEY_PICK, &pick))
+			break;
+		else
+			continue;
+
+		deadline = 0;
+		redraw = 1;
+		if (m->highlight)
+			m->highlight(m->entry[sel]);
+	}
+
+	dprintf(INFO, "boot menu: %s\n", m->entry[sel]->label);
+	return sel;
+}
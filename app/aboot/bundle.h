@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor
+ *       the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BUNDLE_H_
+#define _BUNDLE_H_
+
+/*
+ * A bundle packs several partition images into one download so that
+ * "fastboot flash bundle <file>" provisions them all in one command.
+ * Entries are written in the order they appear.  Each payload is a raw
+ * or sparse image, optionally lz4 compressed.  All fields are little
+ * endian; scripts/mkbundle builds them.
+ */
+
+#define BUNDLE_MAGIC		0x444e4246	/* "FBND" */
+#define BUNDLE_VERSION		1
+#define BUNDLE_NAME_SIZE	32
+#define BUNDLE_ALIGN		64
+
+#define BUNDLE_FLAG_LZ4		0x1	/* payload is an lz4 stream */
+
+typedef struct bundle_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_sz;	/* bytes from start of bundle to first entry */
+	uint16_t entry_sz;	/* size of one bundle_entry_t */
+	uint16_t entry_count;
+	uint32_t total_sz;	/* whole bundle, header and payloads */
+} bundle_header_t;
+
+typedef struct bundle_entry {
+	char name[BUNDLE_NAME_SIZE];	/* partition, NUL terminated */
+	uint32_t offset;	/* payload offset, multiple of BUNDLE_ALIGN */
+	uint32_t size;		/* payload bytes as stored */
+	uint32_t flags;
+	uint32_t reserved;
+} bundle_entry_t;
+
+#endif
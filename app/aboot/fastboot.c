@@ -32,6 +32,17 @@
 #include <kernel/thread.h>
 #include <kernel/event.h>
 #include <dev/udc.h>
+#include <platform.h>
+#include <lib/lz4.h>
+#include <openssl/sha.h>
+#if WITH_LIB_PROFILE
+#include <lib/profile.h>
+#endif
+#if WITH_LIB_TRACE
+#include <lib/trace.h>
+#endif
+
+#include "fastboot.h"
 
 #define MAX_RSP_SIZE 64
 
@@ -69,6 +80,7 @@ struct fastboot_cmd {
 	struct fastboot_cmd *next;
 	const char *prefix;
 	unsigned prefix_len;
+	unsigned scattered;
 	void (*handle)(const char *arg, void *data, unsigned sz);
 };
 
@@ -76,24 +88,39 @@ struct fastboot_var {
 	struct fastboot_var *next;
 	const char *name;
 	const char *value;
+	fastboot_var_fn fn;
 };
 	
 static struct fastboot_cmd *cmdlist;
 
-void fastboot_register(const char *prefix,
-		       void (*handle)(const char *arg, void *data, unsigned sz))
+static void fastboot_register_cmd(const char *prefix,
+		       void (*handle)(const char *arg, void *data, unsigned sz),
+		       unsigned scattered)
 {
 	struct fastboot_cmd *cmd;
 	cmd = malloc(sizeof(*cmd));
 	if (cmd) {
 		cmd->prefix = prefix;
 		cmd->prefix_len = strlen(prefix);
+		cmd->scattered = scattered;
 		cmd->handle = handle;
 		cmd->next = cmdlist;
 		cmdlist = cmd;
 	}
 }
 
+void fastboot_register(const char *prefix,
+		       void (*handle)(const char *arg, void *data, unsigned sz))
+{
+	fastboot_register_cmd(prefix, handle, 0);
+}
+
+void fastboot_register_scattered(const char *prefix,
+		       void (*handle)(const char *arg, void *data, unsigned sz))
+{
+	fastboot_register_cmd(prefix, handle, 1);
+}
+
 static struct fastboot_var *varlist;
 
 void fastboot_publish(const char *name, const char *value)
@@ -103,6 +130,20 @@ void fastboot_publish(const char *name, const char *value)
 	if (var) {
 		var->name = name;
 		var->value = value;
+		var->fn = NULL;
+		var->next = varlist;
+		varlist = var;
+	}
+}
+
+void fastboot_publish_fn(const char *name, fastboot_var_fn fn)
+{
+	struct fastboot_var *var;
+	var = malloc(sizeof(*var));
+	if (var) {
+		var->name = name;
+		var->value = NULL;
+		var->fn = fn;
 		var->next = varlist;
 		varlist = var;
 	}
@@ -122,6 +163,10 @@ static void *download_base;
 static unsigned download_max;
 static unsigned download_size;
 
+static fastboot_scatter_t scatter_fn;
+static struct fastboot_scatter scatter[FASTBOOT_MAX_SCATTER];
+static int scatter_count;
+
 #define STATE_OFFLINE	0
 #define STATE_COMMAND	1
 #define STATE_COMPLETE	2
@@ -136,6 +181,38 @@ static void req_complete(struct udc_request *req, unsigned actual, int status)
 	event_signal(&txn_done, 0);
 }
 
+/* queue a single OUT transfer; it completes in usb_read_wait() */
+static int usb_read_start(void *buf, unsigned len)
+{
+	int r;
+
+	if (fastboot_state == STATE_ERROR)
+		return -1;
+
+	req->buf = buf;
+	req->length = len;
+	req->complete = req_complete;
+	r = udc_request_queue(out, req);
+	if (r < 0) {
+		dprintf(INFO, "usb_read() queue failed\n");
+		fastboot_state = STATE_ERROR;
+		return -1;
+	}
+	return 0;
+}
+
+static int usb_read_wait(void)
+{
+	event_wait(&txn_done);
+
+	if (txn_status < 0) {
+		dprintf(INFO, "usb_read() transaction failed\n");
+		fastboot_state = STATE_ERROR;
+		return -1;
+	}
+	return req->length;
+}
+
 static int usb_read(void *_buf, unsigned len)
 {
 	int r;
@@ -148,27 +225,18 @@ static int usb_read(void *_buf, unsigned len)
 
 	while (len > 0) {
 		xfer = (len > 4096) ? 4096 : len;
-		req->buf = buf;
-		req->length = xfer;
-		req->complete = req_complete;
-		r = udc_request_queue(out, req);
-		if (r < 0) {
-			dprintf(INFO, "usb_read() queue failed\n");
+		if (usb_read_start(buf, xfer))
 			goto oops;
-		}
-		event_wait(&txn_done);
-
-		if (txn_status < 0) {
-			dprintf(INFO, "usb_read() transaction failed\n");
+		r = usb_read_wait();
+		if (r < 0)
 			goto oops;
-		}
 
-		count += req->length;
-		buf += req->length;
-		len -= req->length;
+		count += r;
+		buf += r;
+		len -= r;
 
 		/* short transfer? */
-		if (req->length != xfer) break;
+		if ((unsigned) r != xfer) break;
 	}
 
 	return count;
@@ -178,12 +246,13 @@ oops:
 	return -1;
 }
 
-static int usb_write(void *buf, unsigned len)
+/* queue a single IN transfer; it completes in usb_write_wait() */
+static int usb_write_start(void *buf, unsigned len)
 {
 	int r;
 
 	if (fastboot_state == STATE_ERROR)
-		goto oops;
+		return -1;
 
 	req->buf = buf;
 	req->length = len;
@@ -191,18 +260,28 @@ static int usb_write(void *buf, unsigned len)
 	r = udc_request_queue(in, req);
 	if (r < 0) {
 		dprintf(INFO, "usb_write() queue failed\n");
-		goto oops;
+		fastboot_state = STATE_ERROR;
+		return -1;
 	}
+	return 0;
+}
+
+static int usb_write_wait(void)
+{
 	event_wait(&txn_done);
 	if (txn_status < 0) {
 		dprintf(INFO, "usb_write() transaction failed\n");
-		goto oops;
+		fastboot_state = STATE_ERROR;
+		return -1;
 	}
 	return req->length;
+}
 
-oops:
-	fastboot_state = STATE_ERROR;
-	return -1;
+static int usb_write(void *buf, unsigned len)
+{
+	if (usb_write_start(buf, len))
+		return -1;
+	return usb_write_wait();
 }
 
 void fastboot_ack(const char *code, const char *reason)
@@ -250,23 +329,196 @@ void fastboot_okay(const char *info)
 static void cmd_getvar(const char *arg, void *data, unsigned sz)
 {
 	struct fastboot_var *var;
+	char value[MAX_RSP_SIZE - 4];
 
 	for (var = varlist; var; var = var->next) {
 		if (!strcmp(var->name, arg)) {
-			fastboot_okay(var->value);
+			if (var->fn) {
+				var->fn(value, sizeof(value));
+				fastboot_okay(value);
+			} else
+				fastboot_okay(var->value);
 			return;
 		}
 	}
 	fastboot_okay("");
 }
 
+/*
+ * Receive the rest of an lz4 compressed download whose first 'have'
+ * bytes already sit at download_base.  The compressed stream is staged
+ * at the top of the download buffer and inflated in place towards the
+ * bottom while the next USB transfer is in flight, so only compressed
+ * bytes cross the cable and no extra buffers are needed.  Returns the
+ * inflated size, 0 if the stream was bad (the transfer is still drained)
+ * or -1 on USB failure.
+ */
+static int download_lz4(unsigned len, unsigned have)
+{
+	unsigned char *base = download_base;
+	unsigned char *in = base + ((download_max - len) & ~63);
+	struct lz4_frame frame;
+	unsigned received = have;
+	unsigned consumed = 0;
+	unsigned used, xfer = 0;
+	time_t start = current_time();
+	time_t elapsed;
+	char info[MAX_RSP_SIZE];
+	int r = LZ4_FRAME_OK;
+	int n, bad = 0;
+
+	memmove(in, base, have);
+	lz4_frame_init(&frame, base, in - base);
+
+	for (;;) {
+		if (received < len) {
+			xfer = len - received;
+			if (xfer > 4096)
+				xfer = 4096;
+			if (usb_read_start(in + received, xfer))
+				return -1;
+		}
+
+		/* inflate every unit that has fully arrived */
+		while (!bad) {
+			frame.out_max = (in + consumed) - base;
+			r = lz4_frame_decode(&frame, in + consumed,
+					     received - consumed, &used,
+					     received == len);
+			consumed += used;
+			if (frame.content_size > download_max)
+				bad = 1;
+			if (r != LZ4_FRAME_OK)
+				break;
+		}
+		if (r < LZ4_FRAME_MORE)
+			bad = 1;
+
+		if (received == len)
+			break;
+
+		n = usb_read_wait();
+		if (n < 0)
+			return -1;
+		if ((unsigned) n != xfer) {
+			dprintf(CRITICAL, "download: short transfer\n");
+			fastboot_state = STATE_ERROR;
+			return -1;
+		}
+		received += n;
+	}
+
+	if (bad || r != LZ4_FRAME_DONE) {
+		dprintf(CRITICAL, "download: bad lz4 stream (%d)\n", r);
+		return 0;
+	}
+
+	elapsed = current_time() - start;
+	dprintf(INFO, "download: %u -> %u bytes in %lu ms\n",
+		len, frame.out_len, elapsed);
+	snprintf(info, MAX_RSP_SIZE, "lz4 %u -> %u bytes, %lu KB/s effective",
+		 len, frame.out_len,
+		 elapsed ? (unsigned long) (frame.out_len / elapsed) : 0);
+	fastboot_info(info);
+
+	return frame.out_len;
+}
+
+void fastboot_set_scatter(fastboot_scatter_t fn)
+{
+	scatter_fn = fn;
+}
+
+int fastboot_download_scattered(void)
+{
+	return scatter_count;
+}
+
+void fastboot_download_gather(void)
+{
+	int i;
+
+	for (i = 0; i < scatter_count; i++)
+		memmove(download_base + scatter[i].offset, scatter[i].dest,
+			scatter[i].size);
+	scatter_count = 0;
+}
+
+/*
+ * Ask the scatter hook where the rest of a 'len' byte download should
+ * go, given its first 'have' bytes.  Spans must be in order, must not
+ * overlap each other or the download buffer, and must start and end on
+ * 512 byte boundaries so no USB packet straddles two destinations.
+ */
+static int download_scatter(unsigned len, unsigned have)
+{
+	unsigned char *base = download_base;
+	unsigned end = 0;
+	unsigned char *dest;
+	int i, n;
+
+	if (!scatter_fn)
+		return 0;
+	n = scatter_fn(download_base, have, len, scatter);
+	if (n <= 0 || n > FASTBOOT_MAX_SCATTER)
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		dest = scatter[i].dest;
+		if ((scatter[i].offset & 511) || (scatter[i].size & 511) ||
+		    scatter[i].offset < end ||
+		    scatter[i].offset + scatter[i].size > len ||
+		    (dest < base + len && dest + scatter[i].size > base))
+			return 0;
+		end = scatter[i].offset + scatter[i].size;
+	}
+	return n;
+}
+
+/* receive bytes [have, len) of a download, steering spans to their dest */
+static int download_read(unsigned len, unsigned have)
+{
+	unsigned char *base = download_base;
+	unsigned pos = have;
+	unsigned skip, n;
+	int i, r;
+
+	for (i = 0; i < scatter_count; i++) {
+		if (scatter[i].offset > pos) {
+			n = scatter[i].offset - pos;
+			r = usb_read(base + pos, n);
+			if ((r < 0) || ((unsigned) r != n))
+				return -1;
+			pos += n;
+		}
+
+		/* part of the span may have come in with the first transfer */
+		skip = MIN(pos - scatter[i].offset, scatter[i].size);
+		memcpy(scatter[i].dest, base + scatter[i].offset, skip);
+
+		n = scatter[i].size - skip;
+		r = usb_read(scatter[i].dest + skip, n);
+		if ((r < 0) || ((unsigned) r != n))
+			return -1;
+		pos = MAX(pos, scatter[i].offset + scatter[i].size);
+	}
+
+	n = len - pos;
+	r = usb_read(base + pos, n);
+	if ((r < 0) || ((unsigned) r != n))
+		return -1;
+	return 0;
+}
+
 static void cmd_download(const char *arg, void *data, unsigned sz)
 {
 	char response[MAX_RSP_SIZE];
 	unsigned len = hex2unsigned(arg);
+	unsigned first;
 	int r;
 
 	download_size = 0;
+	scatter_count = 0;
 	if (len > download_max) {
 		fastboot_fail("data too large");
 		return;
@@ -276,8 +528,30 @@ static void cmd_download(const char *arg, void *data, unsigned sz)
 	if (usb_write(response, strlen(response)) < 0)
 		return;
 
-	r = usb_read(download_base, len);
-	if ((r < 0) || ((unsigned) r != len)) {
+	/* peek at the first transfer to spot compressed payloads */
+	first = (len > 4096) ? 4096 : len;
+	r = usb_read(download_base, first);
+	if ((r < 0) || ((unsigned) r != first)) {
+		fastboot_state = STATE_ERROR;
+		return;
+	}
+
+	if (lz4_is_compressed(download_base, first)) {
+		r = download_lz4(len, first);
+		if (r < 0)
+			return;
+		if (r == 0) {
+			fastboot_fail("invalid lz4 image");
+			return;
+		}
+		download_size = r;
+		fastboot_okay("");
+		return;
+	}
+
+	scatter_count = download_scatter(len, first);
+	if (download_read(len, first)) {
+		scatter_count = 0;
 		fastboot_state = STATE_ERROR;
 		return;
 	}
@@ -285,6 +559,157 @@ static void cmd_download(const char *arg, void *data, unsigned sz)
 	fastboot_okay("");
 }
 
+#define UPLOAD_CHUNK	UDC_MAX_REQUEST_SIZE
+
+static unsigned char upload_buf[2][UPLOAD_CHUNK] __ALIGNED(32);
+
+int fastboot_upload(unsigned size, fastboot_fill_t fill, void *arg,
+		    void *digest)
+{
+	char response[MAX_RSP_SIZE];
+	unsigned char *cur = upload_buf[0];
+	unsigned char *next = upload_buf[1];
+	unsigned char *tmp;
+	unsigned offset = 0;
+	unsigned len, next_len;
+	unsigned bad_offset = 0;
+	int failed = 0;
+	SHA256_CTX ctx;
+
+	len = (size > UPLOAD_CHUNK) ? UPLOAD_CHUNK : size;
+
+	/* fail before the data phase if the source is unreadable */
+	if (len && fill(cur, 0, len, arg)) {
+		fastboot_fail("read failure");
+		return -1;
+	}
+
+	snprintf(response, MAX_RSP_SIZE, "DATA%08x", size);
+	if (usb_write(response, strlen(response)) < 0)
+		return -1;
+
+	if (digest)
+		SHA256_Init(&ctx);
+
+	while (len) {
+		if (usb_write_start(cur, len))
+			return -1;
+
+		/* hash and refill while the controller drains 'cur' */
+		if (digest)
+			SHA256_Update(&ctx, cur, len);
+
+		next_len = size - offset - len;
+		if (next_len > UPLOAD_CHUNK)
+			next_len = UPLOAD_CHUNK;
+		if (next_len && fill(next, offset + len, next_len, arg)) {
+			/* the host expects 'size' bytes; pad and fail at the end */
+			if (!failed)
+				bad_offset = offset + len;
+			failed = 1;
+			memset(next, 0, next_len);
+		}
+
+		if (usb_write_wait() < 0)
+			return -1;
+
+		offset += len;
+		len = next_len;
+		tmp = cur;
+		cur = next;
+		next = tmp;
+	}
+
+	if (digest)
+		SHA256_Final(digest, &ctx);
+
+	if (failed) {
+		snprintf(response, MAX_RSP_SIZE, "read failure at 0x%x",
+			 bad_offset);
+		fastboot_fail(response);
+		return -1;
+	}
+	return 0;
+}
+
+#if WITH_LIB_PROFILE
+static int profile_fill(void *buf, unsigned offset, unsigned len, void *arg)
+{
+	profile_dump_read(buf, offset, len);
+	return 0;
+}
+
+/* oem profile [start [ms] | stop]; no argument uploads the last run */
+static void cmd_oem_profile(const char *arg, void *data, unsigned sz)
+{
+	char response[MAX_RSP_SIZE];
+	unsigned size;
+
+	while (*arg == ' ')
+		arg++;
+
+	if (!strncmp(arg, "start", 5)) {
+		arg += 5;
+		if (profile_start(*arg ? atoi(arg) : 1)) {
+			fastboot_fail("cannot start profiler");
+			return;
+		}
+		fastboot_okay("");
+		return;
+	}
+
+	profile_stop();
+	size = profile_dump_size();
+	if (!strcmp(arg, "stop")) {
+		snprintf(response, MAX_RSP_SIZE, "%u bytes", size);
+		fastboot_okay(response);
+		return;
+	}
+
+	if (!size) {
+		fastboot_fail("no profile");
+		return;
+	}
+	if (fastboot_upload(size, profile_fill, NULL, NULL))
+		return;
+	fastboot_okay("");
+}
+#endif
+
+#if WITH_LIB_TRACE
+static int trace_fill(void *buf, unsigned offset, unsigned len, void *arg)
+{
+	trace_dump_read(buf, offset, len);
+	return 0;
+}
+
+/* oem trace [start [wrap] | stop]; no argument uploads the ring */
+static void cmd_oem_trace(const char *arg, void *data, unsigned sz)
+{
+	char response[MAX_RSP_SIZE];
+
+	while (*arg == ' ')
+		arg++;
+
+	if (!strncmp(arg, "start", 5)) {
+		trace_start(strstr(arg, "wrap") != NULL);
+		fastboot_okay("");
+		return;
+	}
+
+	trace_stop();
+	if (!strcmp(arg, "stop")) {
+		snprintf(response, MAX_RSP_SIZE, "%u bytes", trace_dump_size());
+		fastboot_okay(response);
+		return;
+	}
+
+	if (fastboot_upload(trace_dump_size(), trace_fill, NULL, NULL))
+		return;
+	fastboot_okay("");
+}
+#endif
+
 static void fastboot_command_loop(void)
 {
 	struct fastboot_cmd *cmd;
@@ -354,6 +779,8 @@ again:
 			for (cmd = cmdlist; cmd; cmd = cmd->next) {
 				if (memcmp(cmdbuffer, cmd->prefix, cmd->prefix_len))
 					continue;
+				if (scatter_count && !cmd->scattered)
+					fastboot_download_gather();
 				fastboot_state = STATE_COMMAND;
 				cmd->handle((const char*) cmdbuffer + cmd->prefix_len,
 						(void*) download_base, download_size);
@@ -431,7 +858,14 @@ int fastboot_init(void *base, unsigned size)
 
 	fastboot_register("getvar:", cmd_getvar);
 	fastboot_register("download:", cmd_download);
+#if WITH_LIB_PROFILE
+	fastboot_register("oem profile", cmd_oem_profile);
+#endif
+#if WITH_LIB_TRACE
+	fastboot_register("oem trace", cmd_oem_trace);
+#endif
 	fastboot_publish("version", "0.5");
+	fastboot_publish("download-lz4", "yes");
 
 	thr = thread_create("fastboot", fastboot_handler, 0, DEFAULT_PRIORITY, 4096);
 	thread_resume(thr);
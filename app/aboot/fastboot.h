@@ -39,13 +39,63 @@ int fastboot_init(void *xfer_buffer, unsigned max);
 void fastboot_register(const char *prefix,
 		       void (*handle)(const char *arg, void *data, unsigned size));
 
+/* like fastboot_register(), but the handler copes with a download whose
+ * spans were left at their scatter destinations (see below); for any
+ * other handler the download is gathered back into the buffer first
+ */
+void fastboot_register_scattered(const char *prefix,
+		       void (*handle)(const char *arg, void *data, unsigned size));
+
 /* publish a variable readable by the built-in getvar command */
 void fastboot_publish(const char *name, const char *value);
 
+/* a variable whose value is produced by fn when it is read */
+typedef void (*fastboot_var_fn)(char *buf, unsigned size);
+void fastboot_publish_fn(const char *name, fastboot_var_fn fn);
+
+/* source for fastboot_upload(); fills buf with len bytes at offset */
+typedef int (*fastboot_fill_t)(void *buf, unsigned offset, unsigned len,
+			       void *arg);
+
+/* a span of a download received straight into memory outside the
+ * download buffer
+ */
+struct fastboot_scatter {
+	unsigned offset;	/* in the download, multiple of 512 */
+	unsigned size;		/* multiple of 512 */
+	void *dest;
+};
+
+#define FASTBOOT_MAX_SCATTER	4
+
+/* called with the first bytes of each uncompressed download; fills in
+ * up to FASTBOOT_MAX_SCATTER spans in download order and returns how
+ * many, or 0 to receive the download into the buffer as usual
+ */
+typedef int (*fastboot_scatter_t)(const void *head, unsigned have,
+				  unsigned size,
+				  struct fastboot_scatter *spans);
+
+void fastboot_set_scatter(fastboot_scatter_t fn);
+
+/* number of spans of the last download still at their destinations */
+int fastboot_download_scattered(void);
+
+/* copy scattered spans back so the buffer holds the whole download */
+void fastboot_download_gather(void);
+
 /* only callable from within a command handler */
 void fastboot_okay(const char *result);
 void fastboot_fail(const char *reason);
 void fastboot_info(const char *reason);
 
+/* stream size bytes produced by fill() to the host, reading the next
+ * chunk while the previous one is on the wire.  When digest is non-null
+ * it receives the SHA-256 of the data sent.  On failure the response
+ * has already been sent; on success the caller must send it.
+ */
+int fastboot_upload(unsigned size, fastboot_fill_t fill, void *arg,
+		    void *digest);
+
 
 #endif
@@ -2,8 +2,17 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 
 INCLUDES += -I$(LK_TOP_DIR)/platform/msm_shared/include
 
+MODULES += \
+	lib/lz4
+
 OBJS += \
 	$(LOCAL_DIR)/aboot.o \
+	$(LOCAL_DIR)/bootcache.o \
 	$(LOCAL_DIR)/fastboot.o \
-	$(LOCAL_DIR)/recovery.o
+	$(LOCAL_DIR)/recovery.o \
+	$(LOCAL_DIR)/snapshot.o
 
+ifeq ($(WITH_BOOT_MENU),1)
+DEFINES += WITH_BOOT_MENU=1
+OBJS += $(LOCAL_DIR)/bootmenu.o
+endif
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor
+ *       the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <platform.h>
+#include <lib/lz4.h>
+#include <openssl/sha.h>
+
+#include "snapshot.h"
+
+static snapshot_run_t *snapshot_run(struct snapshot *s, unsigned i)
+{
+	return (snapshot_run_t *) (s->table + s->hdr->header_sz +
+				   i * s->hdr->run_sz);
+}
+
+/* where physical range [phys, phys + size) is mapped, or NULL */
+static unsigned char *snapshot_map(struct snapshot *s, unsigned phys,
+				   unsigned size)
+{
+	struct snapshot_window *w;
+	unsigned i;
+
+	for (i = 0; i < s->window_count; i++) {
+		w = &s->window[i];
+		if (phys >= w->phys && size <= w->size &&
+		    phys - w->phys <= w->size - size)
+			return w->base + (phys - w->phys);
+	}
+	return NULL;
+}
+
+/* whether the caller lets runs or the stage use [phys, phys + size) */
+static int snapshot_allowed(struct snapshot *s, unsigned phys, unsigned size)
+{
+	return !s->range_ok || s->range_ok(phys, size);
+}
+
+static int snapshot_overlap(unsigned a, unsigned alen, unsigned b,
+			    unsigned blen)
+{
+	return (unsigned long long) a < (unsigned long long) b + blen &&
+	       (unsigned long long) b < (unsigned long long) a + alen;
+}
+
+void snapshot_add_window(struct snapshot *s, unsigned phys, unsigned size,
+			 void *base)
+{
+	if (s->window_count == SNAPSHOT_MAX_WINDOWS)
+		return;
+	s->window[s->window_count].phys = phys;
+	s->window[s->window_count].size = size;
+	s->window[s->window_count].base = base;
+	s->window_count++;
+}
+
+static int snapshot_check_runs(struct snapshot *s)
+{
+	snapshot_header_t *hdr = s->hdr;
+	snapshot_run_t *run;
+	unsigned expect = hdr->data_offset;
+	unsigned i;
+
+	if (hdr->stage_sz && !snapshot_map(s, hdr->stage_addr, hdr->stage_sz)) {
+		dprintf(CRITICAL, "snapshot: stage outside memory\n");
+		return -1;
+	}
+	if (hdr->stage_sz && !snapshot_allowed(s, hdr->stage_addr, hdr->stage_sz)) {
+		dprintf(CRITICAL, "snapshot: stage in reserved memory\n");
+		return -1;
+	}
+
+	for (i = 0; i < hdr->run_count; i++) {
+		run = snapshot_run(s, i);
+		if ((run->phys | run->size) & (SNAPSHOT_PAGE - 1) ||
+		    run->size == 0 || !snapshot_map(s, run->phys, run->size)) {
+			dprintf(CRITICAL, "snapshot: run %u outside memory\n", i);
+			return -1;
+		}
+		if (!snapshot_allowed(s, run->phys, run->size)) {
+			dprintf(CRITICAL, "snapshot: run %u in reserved memory\n", i);
+			return -1;
+		}
+		if (snapshot_overlap(run->phys, run->size,
+				     hdr->stage_addr, hdr->stage_sz)) {
+			dprintf(CRITICAL, "snapshot: run %u overlaps stage\n", i);
+			return -1;
+		}
+		if (run->offset != expect || run->stored > hdr->total_sz ||
+		    run->offset > hdr->total_sz - run->stored) {
+			dprintf(CRITICAL, "snapshot: run %u payload misplaced\n", i);
+			return -1;
+		}
+
+		switch (run->type) {
+		case SNAPSHOT_RUN_ZERO:
+			if (run->stored)
+				goto bad_size;
+			break;
+		case SNAPSHOT_RUN_RAW:
+			if (run->stored != run->size)
+				goto bad_size;
+			break;
+		case SNAPSHOT_RUN_LZ4:
+			if (!run->stored ||
+			    ROUNDUP(run->stored, SNAPSHOT_BLOCK) > hdr->stage_sz)
+				goto bad_size;
+			break;
+		default:
+			dprintf(CRITICAL, "snapshot: run %u unknown type %u\n",
+				i, run->type);
+			return -1;
+		}
+		expect = ROUNDUP(run->offset + run->stored, SNAPSHOT_BLOCK);
+	}
+
+	if (expect != hdr->total_sz) {
+		dprintf(CRITICAL, "snapshot: size mismatch\n");
+		return -1;
+	}
+	return 0;
+
+bad_size:
+	dprintf(CRITICAL, "snapshot: run %u bad payload size\n", i);
+	return -1;
+}
+
+int snapshot_open(struct snapshot *s, snapshot_read_t read, void *arg)
+{
+	snapshot_header_t *hdr;
+	unsigned char *block;
+	unsigned table_sz;
+
+	s->read = read;
+	s->arg = arg;
+	s->table = NULL;
+	s->hdr = NULL;
+
+	block = memalign(CACHE_LINE, SNAPSHOT_BLOCK);
+	if (!block)
+		return -1;
+	if (read(arg, 0, block, SNAPSHOT_BLOCK)) {
+		free(block);
+		return -1;
+	}
+
+	/* no snapshot is the common case, so keep quiet about it */
+	hdr = (snapshot_header_t *) block;
+	if (hdr->magic != SNAPSHOT_MAGIC) {
+		free(block);
+		return -1;
+	}
+
+	if (hdr->version != SNAPSHOT_VERSION ||
+	    hdr->header_sz < sizeof(snapshot_header_t) ||
+	    hdr->header_sz > SNAPSHOT_BLOCK ||
+	    hdr->run_sz < sizeof(snapshot_run_t) ||
+	    hdr->run_sz > SNAPSHOT_BLOCK ||
+	    hdr->run_count == 0 || hdr->run_count > SNAPSHOT_MAX_RUNS) {
+		dprintf(CRITICAL, "snapshot: bad header\n");
+		free(block);
+		return -1;
+	}
+
+	s->signed_sz = hdr->header_sz + hdr->run_sz * hdr->run_count;
+	table_sz = ROUNDUP(s->signed_sz + SNAPSHOT_SIG_SIZE, SNAPSHOT_BLOCK);
+	if (hdr->data_offset & (SNAPSHOT_PAGE - 1) ||
+	    hdr->data_offset < table_sz || hdr->total_sz < hdr->data_offset) {
+		dprintf(CRITICAL, "snapshot: bad header\n");
+		free(block);
+		return -1;
+	}
+	free(block);
+
+	s->table = memalign(CACHE_LINE, table_sz);
+	if (!s->table) {
+		dprintf(CRITICAL, "snapshot: no memory for run table\n");
+		return -1;
+	}
+	if (read(arg, 0, s->table, table_sz)) {
+		dprintf(CRITICAL, "snapshot: cannot read run table\n");
+		goto fail;
+	}
+	s->hdr = (snapshot_header_t *) s->table;
+
+	/* the header may have changed under us; the table read is what counts */
+	if (s->hdr->magic != SNAPSHOT_MAGIC ||
+	    s->signed_sz != s->hdr->header_sz +
+	    s->hdr->run_sz * s->hdr->run_count)
+		goto fail;
+	if (snapshot_check_runs(s))
+		goto fail;
+	return 0;
+
+fail:
+	snapshot_close(s);
+	return -1;
+}
+
+/*
+ * Raw runs are read straight into their pages.  Compressed runs are
+ * read whole into the stage area and inflated from there; everything
+ * read is hashed on the way so nothing is read twice.
+ */
+int snapshot_restore(struct snapshot *s)
+{
+	snapshot_header_t *hdr = s->hdr;
+	snapshot_run_t *run;
+	unsigned char *stage, *dest;
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	struct lz4_frame f;
+	unsigned i, len, used, consumed;
+	unsigned long long restored = 0;
+	time_t start = current_time();
+	time_t read_time = 0, t;
+	SHA256_CTX ctx;
+	int r;
+
+	stage = snapshot_map(s, hdr->stage_addr, hdr->stage_sz);
+	SHA256_Init(&ctx);
+
+	for (i = 0; i < hdr->run_count; i++) {
+		run = snapshot_run(s, i);
+		dest = snapshot_map(s, run->phys, run->size);
+
+		switch (run->type) {
+		case SNAPSHOT_RUN_ZERO:
+			memset(dest, 0, run->size);
+			break;
+
+		case SNAPSHOT_RUN_RAW:
+			t = current_time();
+			if (s->read(s->arg, run->offset, dest, run->size))
+				goto read_fail;
+			read_time += current_time() - t;
+			SHA256_Update(&ctx, dest, run->size);
+			break;
+
+		case SNAPSHOT_RUN_LZ4:
+			len = ROUNDUP(run->stored, SNAPSHOT_BLOCK);
+			t = current_time();
+			if (s->read(s->arg, run->offset, stage, len))
+				goto read_fail;
+			read_time += current_time() - t;
+			SHA256_Update(&ctx, stage, len);
+
+			lz4_frame_init(&f, dest, run->size);
+			consumed = 0;
+			do {
+				r = lz4_frame_decode(&f, stage + consumed,
+						     run->stored - consumed,
+						     &used, true);
+				consumed += used;
+			} while (r == LZ4_FRAME_OK);
+			if (r != LZ4_FRAME_DONE || f.out_len != run->size) {
+				dprintf(CRITICAL, "snapshot: run %u does not "
+					"inflate (%d)\n", i, r);
+				return -1;
+			}
+			break;
+		}
+		restored += run->size;
+	}
+
+	SHA256_Final(digest, &ctx);
+	if (memcmp(digest, hdr->data_sha256, sizeof(digest))) {
+		dprintf(CRITICAL, "snapshot: data digest mismatch\n");
+		return -1;
+	}
+
+	dprintf(INFO, "snapshot: %u runs, %llu KB from %u KB in %lu ms "
+		"(%lu ms reading)\n", hdr->run_count, restored / 1024,
+		(hdr->total_sz - hdr->data_offset) / 1024,
+		current_time() - start, read_time);
+	return 0;
+
+read_fail:
+	dprintf(CRITICAL, "snapshot: cannot read run %u\n", i);
+	return -1;
+}
+
+void snapshot_close(struct snapshot *s)
+{
+	free(s->table);
+	s->table = NULL;
+	s->hdr = NULL;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor
+ *       the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+/*
+ * A snapshot is a saved image of the kernel's memory that is restored
+ * page run by page run and entered at the kernel's resume vector
+ * instead of booting.  Layout, all fields little endian:
+ *
+ *   snapshot_header_t
+ *   snapshot_run_t[run_count]
+ *   signature (SNAPSHOT_SIG_SIZE bytes) over everything above
+ *   run payloads from data_offset, each starting on a SNAPSHOT_BLOCK
+ *   boundary right after the previous one
+ *
+ * data_sha256 covers the payload area [data_offset, total_sz), so the
+ * signature over the table vouches for the whole image while payloads
+ * are streamed straight to their pages.  The stage area is RAM that no
+ * run restores to, used to hold compressed payloads while they are
+ * inflated.  scripts/mksnapshot builds them.
+ */
+
+#define SNAPSHOT_MAGIC		0x50414e53	/* "SNAP" */
+#define SNAPSHOT_VERSION	1
+#define SNAPSHOT_ID_SIZE	32	/* boot_img_hdr id[] */
+#define SNAPSHOT_SIG_SIZE	256
+#define SNAPSHOT_BLOCK		512
+#define SNAPSHOT_PAGE		4096
+#define SNAPSHOT_MAX_RUNS	4096
+#define SNAPSHOT_MAX_WINDOWS	4
+
+#define SNAPSHOT_RUN_RAW	0
+#define SNAPSHOT_RUN_LZ4	1	/* payload is an lz4 frame */
+#define SNAPSHOT_RUN_ZERO	2	/* no payload, pages are cleared */
+
+#define SNAPSHOT_FLAG_ONESHOT	0x1	/* invalidate once resumed */
+
+typedef struct snapshot_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_sz;
+	uint32_t run_sz;	/* size of one snapshot_run_t */
+	uint32_t run_count;
+	uint32_t data_offset;	/* multiple of SNAPSHOT_PAGE */
+	uint32_t total_sz;
+	uint32_t flags;
+	uint32_t resume_addr;	/* physical, entered with MMU and caches off */
+	uint32_t resume_arg;	/* passed in r2 */
+	uint32_t stage_addr;
+	uint32_t stage_sz;
+	uint32_t reserved;
+	uint8_t kernel_id[SNAPSHOT_ID_SIZE];	/* id[] of the matching boot image */
+	uint8_t data_sha256[32];
+} snapshot_header_t;
+
+typedef struct snapshot_run {
+	uint32_t phys;		/* multiple of SNAPSHOT_PAGE */
+	uint32_t size;		/* bytes in memory, multiple of SNAPSHOT_PAGE */
+	uint32_t offset;	/* payload offset in the image */
+	uint32_t stored;	/* payload bytes in the image */
+	uint32_t type;
+	uint32_t reserved;
+} snapshot_run_t;
+
+/* reads 'len' bytes at 'offset' of the image; both block aligned */
+typedef int (*snapshot_read_t)(void *arg, unsigned long long offset,
+			       void *buf, unsigned len);
+
+/* physical RAM that runs may restore to, and where it is mapped */
+struct snapshot_window {
+	unsigned phys;
+	unsigned size;
+	unsigned char *base;
+};
+
+struct snapshot {
+	snapshot_read_t read;
+	void *arg;
+
+	/* header, run table and signature as read, malloc()ed */
+	unsigned char *table;
+	snapshot_header_t *hdr;
+	unsigned signed_sz;	/* the signature follows at table + signed_sz */
+
+	unsigned window_count;
+	struct snapshot_window window[SNAPSHOT_MAX_WINDOWS];
+
+	/* vetoes windowed memory the caller itself uses, may be NULL */
+	int (*range_ok)(unsigned phys, unsigned size);
+};
+
+void snapshot_add_window(struct snapshot *s, unsigned phys, unsigned size,
+			 void *base);
+
+/* read and check header and run table; 0 if the image is usable */
+int snapshot_open(struct snapshot *s, snapshot_read_t read, void *arg);
+
+/* stream every run into its pages and check data_sha256 */
+int snapshot_restore(struct snapshot *s);
+
+void snapshot_close(struct snapshot *s);
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor
+ *       the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Runs the aboot fastboot protocol on the emulator, on top of the
+ * loopback UDC, so download, flash and boot can be timed without a
+ * board.  "flash:<dev>" writes raw or sparse images to a block device
+ * (block0 is backed by a file on the host); "boot" checks the image
+ * and stages kernel and ramdisk but does not jump to them.
+ * "snapshot:<dev>" restores a memory snapshot (scripts/mksnapshot)
+ * from a block device into a heap window standing in for the kernel's
+ * RAM and reports a digest of the result instead of resuming.
+ */
+
+#include <app.h>
+#include <debug.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <platform.h>
+#include <dev/udc.h>
+#include <lib/bio.h>
+#include <lib/partition.h>
+#include <openssl/sha.h>
+
+#include "bootimg.h"
+#include "fastboot.h"
+#include "sparse_format.h"
+#include "snapshot.h"
+
+#ifndef FBLOOP_DOWNLOAD_SIZE
+#define FBLOOP_DOWNLOAD_SIZE	(2 * 1024 * 1024)
+#endif
+
+/* physical range a snapshot may restore to, see scripts/mksnapshot */
+#ifndef FBLOOP_SNAPSHOT_PHYS
+#define FBLOOP_SNAPSHOT_PHYS	0x80200000
+#endif
+#ifndef FBLOOP_SNAPSHOT_SIZE
+#define FBLOOP_SNAPSHOT_SIZE	(1024 * 1024)
+#endif
+
+static struct udc_device loop_udc_device = {
+	.vendor_id	= 0x18d1,
+	.product_id	= 0xD00D,
+	.version_id	= 0x0100,
+	.manufacturer	= "Google",
+	.product	= "Android",
+};
+
+static void fbloop_report(const char *what, unsigned len, time_t start)
+{
+	char response[64];
+	time_t t = current_time() - start;
+
+	snprintf(response, sizeof(response), "%s %u KB in %lu ms, %lu KB/s",
+		 what, len / 1024, t, t ? (unsigned long) (len / t) : 0);
+	fastboot_info(response);
+}
+
+static int fbloop_write_sparse(bdev_t *dev, void *data, unsigned sz)
+{
+	sparse_header_t *sparse_header = data;
+	chunk_header_t *chunk_header;
+	unsigned chunk, chunk_data_sz;
+	off_t offset = 0;
+
+	data += sparse_header->file_hdr_sz;
+	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
+		chunk_header = data;
+		data += sparse_header->chunk_hdr_sz;
+		chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
+
+		switch (chunk_header->chunk_type) {
+		case CHUNK_TYPE_RAW:
+			if (bio_write(dev, data, offset, chunk_data_sz)
+			    != (ssize_t) chunk_data_sz)
+				return -1;
+			data += chunk_data_sz;
+			break;
+		case CHUNK_TYPE_DONT_CARE:
+			break;
+		case CHUNK_TYPE_CRC:
+			data += chunk_header->total_sz - sparse_header->chunk_hdr_sz;
+			break;
+		default:
+			return -1;
+		}
+		offset += chunk_data_sz;
+	}
+	return 0;
+}
+
+static void cmd_flash_bio(const char *arg, void *data, unsigned sz)
+{
+	sparse_header_t *sparse_header = data;
+	time_t start = current_time();
+	bdev_t *dev;
+	int r;
+
+	dev = bio_open(arg);
+	if (!dev) {
+		fastboot_fail("unknown partition name");
+		return;
+	}
+
+	if (sparse_header->magic == SPARSE_HEADER_MAGIC)
+		r = fbloop_write_sparse(dev, data, sz);
+	else
+		r = (bio_write(dev, data, 0, sz) == (ssize_t) sz) ? 0 : -1;
+	bio_close(dev);
+
+	if (r) {
+		fastboot_fail("flash write failure");
+		return;
+	}
+	fbloop_report("flash", sz, start);
+	fastboot_okay("");
+}
+
+static void cmd_boot_staged(const char *arg, void *data, unsigned sz)
+{
+	struct boot_img_hdr *hdr = data;
+	time_t start = current_time();
+	unsigned page_mask, kernel_actual, ramdisk_actual;
+	void *kernel, *ramdisk;
+
+	if (sz < sizeof(*hdr) || memcmp(hdr->magic, BOOT_MAGIC, BOOT_MAGIC_SIZE)) {
+		fastboot_fail("invalid boot image header");
+		return;
+	}
+	if (hdr->page_size == 0 || (hdr->page_size & (hdr->page_size - 1))) {
+		fastboot_fail("invalid page size");
+		return;
+	}
+
+	page_mask = hdr->page_size - 1;
+	kernel_actual = (hdr->kernel_size + page_mask) & ~page_mask;
+	ramdisk_actual = (hdr->ramdisk_size + page_mask) & ~page_mask;
+	if (hdr->page_size + kernel_actual + ramdisk_actual > sz) {
+		fastboot_fail("incomplete boot image");
+		return;
+	}
+
+	/*
+	 * The emulator has no room at the real load addresses, so copy to
+	 * the heap to account for the cost of staging the image.
+	 */
+	kernel = malloc(hdr->kernel_size);
+	ramdisk = malloc(hdr->ramdisk_size);
+	if (!kernel || !ramdisk) {
+		free(kernel);
+		free(ramdisk);
+		fastboot_fail("boot image too large");
+		return;
+	}
+	memcpy(kernel, data + hdr->page_size, hdr->kernel_size);
+	memcpy(ramdisk, data + hdr->page_size + kernel_actual,
+	       hdr->ramdisk_size);
+	free(kernel);
+	free(ramdisk);
+
+	dprintf(INFO, "boot: kernel %u bytes @ 0x%08x, ramdisk %u bytes @ 0x%08x\n",
+		hdr->kernel_size, hdr->kernel_addr,
+		hdr->ramdisk_size, hdr->ramdisk_addr);
+	fbloop_report("boot", hdr->kernel_size + hdr->ramdisk_size, start);
+	fastboot_okay("");
+}
+
+static int fbloop_snapshot_read(void *arg, unsigned long long offset,
+				void *buf, unsigned len)
+{
+	return (bio_read(arg, buf, offset, len) == (ssize_t) len) ? 0 : -1;
+}
+
+static void cmd_snapshot(const char *arg, void *data, unsigned sz)
+{
+	struct snapshot s;
+	unsigned char *window;
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	char response[64];
+	time_t start;
+	bdev_t *dev;
+	unsigned i, half;
+	int r;
+
+	dev = bio_open(arg);
+	if (!dev) {
+		fastboot_fail("unknown partition name");
+		return;
+	}
+	window = memalign(SNAPSHOT_PAGE, FBLOOP_SNAPSHOT_SIZE);
+	if (!window) {
+		bio_close(dev);
+		fastboot_fail("no memory for snapshot window");
+		return;
+	}
+	memset(window, 0, FBLOOP_SNAPSHOT_SIZE);
+
+	s.window_count = 0;
+	s.range_ok = NULL;
+	snapshot_add_window(&s, FBLOOP_SNAPSHOT_PHYS, FBLOOP_SNAPSHOT_SIZE,
+			    window);
+	start = current_time();
+	r = snapshot_open(&s, fbloop_snapshot_read, dev);
+	if (!r) {
+		r = snapshot_restore(&s);
+		if (!r) {
+			fbloop_report("snapshot",
+				      s.hdr->total_sz - s.hdr->data_offset,
+				      start);
+			/* the stage is scratch, leave only restored pages */
+			if (s.hdr->stage_sz)
+				memset(window + (s.hdr->stage_addr -
+						 FBLOOP_SNAPSHOT_PHYS),
+				       0, s.hdr->stage_sz);
+		}
+		snapshot_close(&s);
+	}
+	bio_close(dev);
+
+	if (r) {
+		free(window);
+		fastboot_fail("snapshot not usable");
+		return;
+	}
+
+	SHA256(window, FBLOOP_SNAPSHOT_SIZE, digest);
+	free(window);
+	for (half = 0; half < 2; half++) {
+		r = snprintf(response, sizeof(response), "sha256 %u: ", half);
+		for (i = 0; i < sizeof(digest) / 2; i++)
+			r += snprintf(response + r, sizeof(response) - r, "%02x",
+				      digest[half * sizeof(digest) / 2 + i]);
+		fastboot_info(response);
+	}
+	fastboot_okay("");
+}
+
+static void cmd_reboot_loop(const char *arg, void *data, unsigned sz)
+{
+	fastboot_okay("");
+}
+
+void fbloop_init(const struct app_descriptor *app)
+{
+	void *base;
+
+	partition_publish("block0", 0);
+
+	base = memalign(64, FBLOOP_DOWNLOAD_SIZE);
+	if (!base) {
+		dprintf(CRITICAL, "fbloop: no memory for download buffer\n");
+		return;
+	}
+
+	if (udc_init(&loop_udc_device))
+		return;
+
+	fastboot_register("flash:", cmd_flash_bio);
+	fastboot_register("boot", cmd_boot_staged);
+	fastboot_register("snapshot:", cmd_snapshot);
+	fastboot_register("reboot", cmd_reboot_loop);
+	fastboot_publish("product", "armemu");
+	fastboot_publish("kernel", "lk");
+	fastboot_init(base, FBLOOP_DOWNLOAD_SIZE);
+	udc_start();
+}
+
+APP_START(fbloop)
+	.init = fbloop_init,
+APP_END
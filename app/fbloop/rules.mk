@@ -0,0 +1,14 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+# the fastboot protocol is shared with aboot
+INCLUDES += -I$(LK_TOP_DIR)/app/aboot
+
+MODULES += \
+	lib/bio \
+	lib/partition \
+	lib/lz4
+
+OBJS += \
+	$(LOCAL_DIR)/fbloop.o \
+	app/aboot/fastboot.o \
+	app/aboot/snapshot.o
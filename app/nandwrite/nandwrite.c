@@ -37,6 +37,7 @@
 #include <kernel/thread.h>
 #include <smem.h>
 #include <platform.h>
+#include <lib/lz4.h>
 #include "bootimg.h"
 
 #define FLASH_PAGE_SIZE 2048
@@ -59,34 +60,54 @@ int startswith(const char *str, const char *prefix)
     return 1;
 }
 
-/* XXX */
-void verify_flash(struct ptentry *p, void *addr, unsigned len, int extra)
+#define VERIFY_PAGES 64
+
+/* read the partition back VERIFY_PAGES at a time; flash_read_ext rescans
+ * bad blocks on every call so page-sized reads get slower as we go */
+int verify_flash(struct ptentry *p, unsigned offset, void *addr, unsigned len,
+                 int extra)
 {
-    uint32_t offset = 0;
-    void *buf = malloc(FLASH_PAGE_SIZE + extra);
+    unsigned stride = FLASH_PAGE_SIZE + extra;
+    unsigned char *buf = malloc(VERIFY_PAGES * stride);
+    unsigned n, i, cmp;
     int verify_extra = extra;
     if(verify_extra > 4)
         verify_extra = 16;
+    if(buf == 0) {
+        jtag_fail("verify: out of memory");
+        return -1;
+    }
     while(len > 0) {
-        flash_read_ext(p, extra, offset, buf, FLASH_PAGE_SIZE);
-        if(memcmp(addr, buf, FLASH_PAGE_SIZE + verify_extra)) {
-            dprintf(CRITICAL, "verify failed at 0x%08x\n", offset);
+        n = (len > VERIFY_PAGES * stride) ? VERIFY_PAGES * stride : len;
+        if(flash_read_ext(p, extra, offset, buf, n)) {
+            dprintf(CRITICAL, "verify read failed at 0x%08x\n", offset);
             jtag_fail("verify failed");
-            return;
+            free(buf);
+            return -1;
         }
-        offset += FLASH_PAGE_SIZE;
-        addr += FLASH_PAGE_SIZE;
-        len -= FLASH_PAGE_SIZE;
-        if(extra) {
-            addr += extra;
-            len -= extra;
+        for(i = 0; i < n; i += stride) {
+            /* the last page of the image may be partial */
+            cmp = FLASH_PAGE_SIZE + verify_extra;
+            if(cmp > n - i)
+                cmp = n - i;
+            if(memcmp(addr + i, buf + i, cmp)) {
+                dprintf(CRITICAL, "verify failed at 0x%08x\n",
+                        offset + (i / stride) * FLASH_PAGE_SIZE);
+                jtag_fail("verify failed");
+                free(buf);
+                return -1;
+            }
         }
+        offset += (n / stride) * FLASH_PAGE_SIZE;
+        addr += n;
+        len -= n;
     }
+    free(buf);
     dprintf(INFO, "verify done %d extra bytes\n", verify_extra);
-    jtag_okay("verify done");
+    return 0;
 }
 
-void handle_flash(const char *name, unsigned addr, unsigned sz)
+void handle_flash(const char *name, unsigned addr, unsigned sz, unsigned verify)
 {
 	struct ptentry *ptn;
 	struct ptable *ptable;
@@ -125,6 +146,8 @@ void handle_flash(const char *name, unsigned addr, unsigned sz)
 		return;
 	}
 	dprintf(INFO, "partition '%s' updated\n", ptn->name);
+	if (verify && verify_flash(ptn, 0, data, sz, extra))
+		return;
         jtag_okay("Done");
         enter_critical_section();
         platform_uninit_timer();
@@ -132,6 +155,113 @@ void handle_flash(const char *name, unsigned addr, unsigned sz)
         arch_disable_mmu();
 }
 
+/* Ring buffers for flashring:, in erase blocks each */
+#define RING_BUFS	4
+#define RING_BLOCKS	8
+
+/*
+ * Flash an image the debugger streams through the JTAG ring, so it can
+ * upload the next buffer while this one is programmed.  Every buffer
+ * but the last has to hold whole erase blocks once inflated.
+ */
+void handle_flash_ring(const char *name, unsigned verify)
+{
+	struct ptentry *ptn;
+	struct ptable *ptable;
+	struct flash_write_state w;
+	struct lz4_frame f;
+	unsigned char *scratch, *stage, *buf, *data;
+	unsigned extra = 0, bufsz, blksz, len, flags, used, consumed;
+	unsigned offset = 0, total = 0, nbufs = 0;
+	time_t start = current_time();
+	int r;
+
+	ptable = flash_get_ptable();
+	if (ptable == NULL) {
+		jtag_fail("partition table doesn't exist");
+		return;
+	}
+
+	ptn = ptable_find(ptable, name);
+	if (ptn == NULL) {
+		jtag_fail("unknown partition name");
+		return;
+	}
+
+	if (!strcmp(ptn->name, "system") || !strcmp(ptn->name, "userdata") || !strcmp(ptn->name, "persist"))
+		extra = ((page_size >> 9) * 16);
+
+	blksz = (flash_get_info()->block_size / page_size) * (page_size + extra);
+	bufsz = RING_BLOCKS * blksz;
+	scratch = (unsigned char *)target_get_scratch_address();
+	stage = scratch + RING_BUFS * bufsz;
+
+	if (flash_write_begin(&w, ptn, extra)) {
+		jtag_fail("flash write failure");
+		return;
+	}
+
+	dprintf(INFO, "writing '%s' from %d buffers of %d bytes\n", ptn->name,
+		RING_BUFS, bufsz);
+	jtag_ring_init(scratch, RING_BUFS, bufsz);
+
+	do {
+		buf = jtag_ring_get(&len, &flags);
+		data = buf;
+
+		if (flags & JTAG_BUF_LZ4) {
+			lz4_frame_init(&f, stage, bufsz);
+			consumed = 0;
+			do {
+				r = lz4_frame_decode(&f, buf + consumed,
+						     len - consumed, &used, true);
+				consumed += used;
+			} while (r == LZ4_FRAME_OK);
+			if (r != LZ4_FRAME_DONE) {
+				jtag_ring_close();
+				jtag_fail("corrupt lz4 buffer");
+				return;
+			}
+			data = stage;
+			len = f.out_len;
+		}
+
+		if (!extra)
+			len = ROUND_TO_PAGE(len, page_mask);
+		if (len > bufsz || (!(flags & JTAG_BUF_LAST) && len % blksz)) {
+			jtag_ring_close();
+			jtag_fail("buffer is not whole erase blocks");
+			return;
+		}
+		if (flash_write_next(&w, data, len)) {
+			jtag_ring_close();
+			jtag_fail("flash write failure");
+			return;
+		}
+		if (verify && verify_flash(ptn, offset, data, len, extra)) {
+			jtag_ring_close();
+			return;
+		}
+
+		/* the buffer is free as soon as its data is on flash */
+		jtag_ring_put();
+		offset += (len / (page_size + extra)) * page_size;
+		total += len;
+		nbufs++;
+	} while (!(flags & JTAG_BUF_LAST));
+
+	jtag_ring_close();
+	flash_write_end(&w);
+	dprintf(INFO, "partition '%s' updated, %d bytes from %d buffers in %lu ms\n",
+		ptn->name, total, nbufs, current_time() - start);
+
+	jtag_okay("Done");
+	enter_critical_section();
+	platform_uninit_timer();
+	arch_disable_cache(UCACHE);
+	arch_disable_mmu();
+}
+
 static unsigned char *tmpbuf = 0;
 
 
@@ -193,7 +323,12 @@ void handle_query_load_address(unsigned addr)
 void handle_command(const char *cmd, unsigned a0, unsigned a1, unsigned a2)
 {
     if(startswith(cmd,"flash:")){
-        handle_flash(cmd + 6, a0, a1);
+        handle_flash(cmd + 6, a0, a1, a2);
+        return;
+    }
+
+    if(startswith(cmd,"flashring:")){
+        handle_flash_ring(cmd + 10, a0);
         return;
     }
 
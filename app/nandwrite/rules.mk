@@ -1,5 +1,8 @@
 LOCAL_DIR := $(GET_LOCAL_DIR)
 
+MODULES += \
+	lib/lz4
+
 OBJS += \
 	$(LOCAL_DIR)/nandwrite.o \
 
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * mmc.c and nand.c against the register models.  Each test builds an
+ * image in memory and attaches it, writes a pattern through the driver
+ * and checks it both read back through the driver and in the image,
+ * then times a read on the virtual clock: a run may not come in under
+ * the device time the latencies add up to.
+ *
+ * acpuclock.c against the Krait clock model: boosting has to land on
+ * the boot rates and restoring on the registers as found, both without
+ * a switch the model flags, starting from the HFPLLs off and again from
+ * them left running by a previous stage.
+ */
+
+#include <debug.h>
+#include <reg.h>
+#include <string.h>
+#include <malloc.h>
+#include <app.h>
+#include <platform.h>
+#include <lib/bio.h>
+#include <lib/regmodel.h>
+#include <dev/flash.h>
+#include <platform/iomap.h>
+#include <platform/clock.h>
+#include <platform/timer.h>
+#include <mmc.h>
+
+#define EMMC_SECTORS	1024		/* 512k image */
+#define EMMC_TEST_LBA	64
+#define EMMC_TEST_LEN	(64 * 1024)
+
+#define NAND_RAW_PAGE	(4 * 528)	/* as lib/regmodel/nandc.c */
+#define NAND_CW_DATA	516
+#define NAND_BLOCK	64		/* pages */
+#define NAND_BLOCKS	4
+#define NAND_TEST_PAGES	8
+
+static uint8_t *emmc_image;
+static uint8_t *nand_image;
+
+static void fillbuf(void *ptr, size_t len, uint32_t seed)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		((char *)ptr)[i] = seed;
+		seed *= 0x1234567;
+	}
+}
+
+static void report(const char *what, unsigned len, uint64_t ns,
+		   uint64_t min_ns)
+{
+	printf("%s: %u bytes in %llu us virtual, %llu KB/s\n", what, len,
+		ns / 1000, ns ? (uint64_t) len * 1000000 / ns : 0);
+	if (ns < min_ns)
+		printf("error! %s took %llu ns, the device needs %llu\n",
+			what, ns, min_ns);
+}
+
+/* a one partition MBR, so mmc_boot_main() finds a table */
+static void emmc_format(uint8_t *image)
+{
+	uint8_t *e = image + 446;
+	unsigned first = 8, size = EMMC_SECTORS - 8;
+
+	memset(image, 0, EMMC_SECTORS * 512);
+	e[4] = 0x83;
+	memcpy(e + 8, &first, 4);
+	memcpy(e + 12, &size, 4);
+	image[510] = 0x55;
+	image[511] = 0xAA;
+}
+
+static int emmc_test(uint8_t *wbuf, uint8_t *rbuf)
+{
+	unsigned long long addr = EMMC_TEST_LBA * 512;
+	uint64_t start, min_ns;
+
+	if (!emmc_image) {
+		emmc_image = malloc(EMMC_SECTORS * 512);
+		if (!emmc_image)
+			return -1;
+		emmc_format(emmc_image);
+		create_membdev("emmc", emmc_image, EMMC_SECTORS * 512);
+		if (reg_model_msm_attach("emmc", NULL) < 0 ||
+		    mmc_boot_main(1, MSM_SDC1_BASE) != MMC_BOOT_E_SUCCESS) {
+			printf("error! eMMC did not come up\n");
+			return -1;
+		}
+	}
+
+	fillbuf(wbuf, EMMC_TEST_LEN, current_time());
+	if (mmc_write(addr, EMMC_TEST_LEN, (unsigned int *) wbuf)) {
+		printf("error! mmc_write failed\n");
+		return -1;
+	}
+	if (memcmp(emmc_image + addr, wbuf, EMMC_TEST_LEN)) {
+		printf("error! mmc_write did not reach the image\n");
+		return -1;
+	}
+
+	memset(rbuf, 0, EMMC_TEST_LEN);
+	start = reg_model_now();
+	if (mmc_read(addr, (unsigned int *) rbuf, EMMC_TEST_LEN)) {
+		printf("error! mmc_read failed\n");
+		return -1;
+	}
+	min_ns = reg_model_lat.mmc_access_ns +
+		 (uint64_t) EMMC_TEST_LEN * reg_model_lat.mmc_byte_ns;
+	report("mmc_read", EMMC_TEST_LEN, reg_model_now() - start, min_ns);
+	if (memcmp(rbuf, wbuf, EMMC_TEST_LEN)) {
+		printf("error! mmc_read returned other data\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int nand_test(uint8_t *wbuf, uint8_t *rbuf)
+{
+	struct ptentry ptn;
+	struct flash_info *info;
+	unsigned len, size = NAND_BLOCKS * NAND_BLOCK * NAND_RAW_PAGE;
+	uint64_t start, min_ns;
+
+	if (!nand_image) {
+		nand_image = malloc(size);
+		if (!nand_image)
+			return -1;
+		memset(nand_image, 0xFF, size);
+		create_membdev("nand", nand_image, size);
+		if (reg_model_msm_attach(NULL, "nand") < 0) {
+			printf("error! NAND did not attach\n");
+			return -1;
+		}
+		flash_init();
+	}
+
+	info = flash_get_info();
+	if (info->page_size != 2048 || info->num_blocks != NAND_BLOCKS) {
+		printf("error! NAND probed as %u blocks of %u byte pages\n",
+			info->num_blocks, info->page_size);
+		return -1;
+	}
+
+	memset(&ptn, 0, sizeof(ptn));
+	strcpy(ptn.name, "regmodel");
+	ptn.start = 1;
+	ptn.length = 2;
+	ptn.type = TYPE_APPS_PARTITION;
+	len = NAND_TEST_PAGES * info->page_size;
+
+	fillbuf(wbuf, len, current_time());
+	if (flash_erase(&ptn) || flash_write(&ptn, 0, wbuf, len)) {
+		printf("error! flash_write failed\n");
+		return -1;
+	}
+	/* the first codeword of the partition holds the first data bytes */
+	if (memcmp(nand_image + NAND_BLOCK * NAND_RAW_PAGE, wbuf,
+		   NAND_CW_DATA)) {
+		printf("error! flash_write did not reach the image\n");
+		return -1;
+	}
+
+	memset(rbuf, 0, len);
+	start = reg_model_now();
+	if (flash_read(&ptn, 0, rbuf, len)) {
+		printf("error! flash_read failed\n");
+		return -1;
+	}
+	min_ns = NAND_TEST_PAGES * (reg_model_lat.nand_read_ns +
+		 (uint64_t) info->page_size * reg_model_lat.nand_byte_ns);
+	report("flash_read", len, reg_model_now() - start, min_ns);
+	if (memcmp(rbuf, wbuf, len)) {
+		printf("error! flash_read returned other data\n");
+		return -1;
+	}
+	return 0;
+}
+
+/* what acpu_clock_restore() has to put back, per clock */
+struct krait_state {
+	uint32_t pll[6];	/* MODE, CONFIG_CTL, L, M, N, DROOP_CTL */
+	uint32_t aux;
+	uint32_t cpmr;
+};
+
+static const struct {
+	const char *name;
+	addr_t hfpll;
+	addr_t aux;
+	uint32_t cpmr;
+	uint32_t boot_l;
+} krait_clks[] = {
+	{ "L2", HFPLL_L2_BASE, APCS_L2_AUX_CLK_SEL, 0x0500, L2_BOOT_L_VAL },
+	{ "CPU0", HFPLL_CPU0_BASE, APCS_CPU0_AUX_CLK_SEL, 0x4501,
+	  ACPU_BOOT_L_VAL },
+};
+
+static void krait_save(struct krait_state *s)
+{
+	unsigned i, r;
+
+	for (i = 0; i < ARRAY_SIZE(krait_clks); i++) {
+		for (r = 0; r < 6; r++)
+			s[i].pll[r] = readl(krait_clks[i].hfpll + r * 4);
+		s[i].aux = readl(krait_clks[i].aux);
+		s[i].cpmr = reg_model_l2_read(krait_clks[i].cpmr);
+	}
+}
+
+/* what a previous stage may leave: both clocks on running HFPLLs */
+static void krait_preset(void)
+{
+	unsigned i;
+	addr_t b;
+
+	for (i = 0; i < ARRAY_SIZE(krait_clks); i++) {
+		b = krait_clks[i].hfpll;
+		/* secondary mux on aux, primary off the HFPLL */
+		reg_model_l2_write(krait_clks[i].cpmr, 2 << 2);
+		writel(0, HFPLL_MODE(b));
+		writel(0x12345678, HFPLL_CONFIG_CTL(b));
+		writel(0x00ABC000, HFPLL_DROOP_CTL(b));
+		writel(0x10 + i, HFPLL_L_VAL(b));
+		writel(1, HFPLL_M_VAL(b));
+		writel(3, HFPLL_N_VAL(b));
+		writel(2, HFPLL_MODE(b));		/* bypass off */
+		udelay(10);
+		writel(6, HFPLL_MODE(b));		/* out of reset */
+		udelay(60);
+		writel(7, HFPLL_MODE(b));		/* output on */
+
+		/* and the primary mux onto it */
+		reg_model_l2_write(krait_clks[i].cpmr, (2 << 2) | 1);
+	}
+}
+
+static int krait_run(const char *what)
+{
+	struct krait_state before[ARRAY_SIZE(krait_clks)];
+	struct krait_state after[ARRAY_SIZE(krait_clks)];
+	unsigned violations = reg_model_krait_violations();
+	unsigned i;
+	int err = 0;
+
+	krait_save(before);
+	acpu_clock_init();
+	krait_save(after);
+	for (i = 0; i < ARRAY_SIZE(krait_clks); i++) {
+		if ((after[i].cpmr & 3) != 1 || after[i].pll[0] != 7 ||
+		    after[i].pll[2] != krait_clks[i].boot_l) {
+			printf("error! %s: %s not on its HFPLL at L %u\n",
+				what, krait_clks[i].name, krait_clks[i].boot_l);
+			err = -1;
+		}
+	}
+
+	acpu_clock_restore();
+	krait_save(after);
+	for (i = 0; i < ARRAY_SIZE(krait_clks); i++) {
+		if (memcmp(&before[i], &after[i], sizeof(before[i]))) {
+			printf("error! %s: %s not restored as found\n",
+				what, krait_clks[i].name);
+			err = -1;
+		}
+	}
+
+	if (reg_model_krait_violations() != violations) {
+		printf("error! %s: %u bad clock switches\n", what,
+			reg_model_krait_violations() - violations);
+		err = -1;
+	}
+	return err;
+}
+
+static int krait_test(void)
+{
+	static int attached;
+	int err;
+
+	if (!attached) {
+		if (reg_model_krait_attach(CLK_CTL_BASE, APCS_CPU0_AUX_CLK_SEL,
+					   APCS_L2_AUX_CLK_SEL) < 0) {
+			printf("error! Krait clocks did not attach\n");
+			return -1;
+		}
+		attached = 1;
+	}
+
+	err = krait_run("as found");
+	krait_preset();
+	err |= krait_run("HFPLLs running");
+	return err;
+}
+
+#if defined(WITH_LIB_CONSOLE)
+#include <lib/console.h>
+
+static int regmodel_tests(int argc, const cmd_args *argv)
+{
+	uint8_t *wbuf, *rbuf;
+	int err = 0;
+
+	wbuf = memalign(32, EMMC_TEST_LEN);
+	rbuf = memalign(32, EMMC_TEST_LEN);
+	if (!wbuf || !rbuf) {
+		printf("error! no memory for the buffers\n");
+		goto out;
+	}
+
+	if (argc < 2 || !strcmp(argv[1].str, "mmc"))
+		err |= emmc_test(wbuf, rbuf);
+	if (argc < 2 || !strcmp(argv[1].str, "nand"))
+		err |= nand_test(wbuf, rbuf);
+	if (argc < 2 || !strcmp(argv[1].str, "krait"))
+		err |= krait_test();
+	printf("regmodel tests %s\n", err ? "FAILED" : "passed");
+
+out:
+	free(wbuf);
+	free(rbuf);
+	return err;
+}
+
+STATIC_COMMAND_START
+{ "regmodel_tests", "drivers on the register models", &regmodel_tests },
+STATIC_COMMAND_END(regmodeltests);
+
+#endif
+
+APP_START(regmodeltests)
+APP_END
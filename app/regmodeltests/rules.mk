@@ -0,0 +1,7 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULES += \
+	lib/regmodel/msm
+
+OBJS += \
+	$(LOCAL_DIR)/regmodel_tests.o
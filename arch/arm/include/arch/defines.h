@@ -28,6 +28,8 @@
 
 #if defined(ARM_CPU_ARM1136)
  #define CACHE_LINE 32
+#elif defined(ARM_CPU_ARM926)
+ #define CACHE_LINE 32
 #elif defined(ARM_CPU_CORE_A5)
  #define CACHE_LINE 32
 #elif defined(ARM_CPU_CORE_SCORPION)
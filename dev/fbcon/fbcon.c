@@ -198,6 +198,18 @@ void fbcon_clear(void)
 #endif
 }
 
+/* move the cursor to a character cell, for redrawing in place */
+void fbcon_set_cursor(unsigned col, unsigned row)
+{
+#if DISPLAY_TYPE_TOUCHPAD
+	cur_pos.x = col * (FONT_WIDTH + 1);
+	cur_pos.y = row * FONT_HEIGHT;
+#else
+	cur_pos.x = col;
+	cur_pos.y = row;
+#endif
+}
+
 #if DISPLAY_TYPE_TOUCHPAD
 static void fbcon_set_colors(
 		unsigned char bg_r,
@@ -39,7 +39,6 @@
 #include <dev/gpio.h>
 #include <dev/gpio_keypad.h>
 #include <dev/ssbi.h>
-#include <kernel/event.h>
 #include <kernel/timer.h>
 #include <reg.h>
 #include <platform/iomap.h>
@@ -48,20 +47,26 @@
 
 #define LINUX_MACHTYPE_8660_QT      3298
 
+/* current_output while every output is driven to look for any key */
+#define KP_ALL_OUTPUTS	-1
+
 struct gpio_kp {
 	struct gpio_keypad_info *keypad_info;
 	struct timer timer;
-	event_t full_scan;
 	int current_output;
+	/* the last full scan found nothing down and nothing to debounce */
+	int idle;
 	unsigned int some_keys_pressed:2;
+	/* raw state of the last scan, follows keys_pressed */
+	unsigned long *keys_seen;
 	unsigned long keys_pressed[0];
 };
 
 struct gpio_qwerty_kp {
 	struct qwerty_keypad_info *keypad_info;
 	struct timer timer;
-	event_t full_scan;
 	unsigned int some_keys_pressed:2;
+	/* columns last posted as down, one word per row */
 	unsigned long keys_pressed[0];
 };
 
@@ -69,37 +74,73 @@ static struct gpio_qwerty_kp *qwerty_keypad;
 /* TODO: Support multiple keypads? */
 static struct gpio_kp *keypad;
 
+/* keys aboot decides the boot mode on */
+static int boot_key(uint16_t code)
+{
+	return code == KEY_HOME || code == KEY_BACK ||
+	       code == KEY_VOLUMEUP || code == KEY_VOLUMEDOWN;
+}
+
+static void drive_output(struct gpio_keypad_info *kpinfo, int out,
+			 int polarity, int active)
+{
+	int gpio = kpinfo->output_gpios[out];
+
+	if (kpinfo->flags & GPIOKPF_DRIVE_INACTIVE)
+		gpio_set(gpio, active ? polarity : !polarity);
+	else if (active)
+		gpio_config(gpio, polarity ? GPIO_OUTPUT : 0);
+	else
+		gpio_config(gpio, GPIO_INPUT);
+}
+
+static int input_active(struct gpio_keypad_info *kpinfo, int in, int polarity)
+{
+	return gpio_get(kpinfo->input_gpios[in]) ^ !polarity;
+}
+
 static void check_output(struct gpio_kp *kp, int out, int polarity)
 {
 	struct gpio_keypad_info *kpinfo = kp->keypad_info;
 	int key_index;
 	int in;
-	int gpio;
+	int raw;
 	int changed = 0;
 
 	key_index = out * kpinfo->ninputs;
 	for (in = 0; in < kpinfo->ninputs; in++, key_index++) {
-		gpio = kpinfo->input_gpios[in];
-		changed = 0;
-		if (gpio_get(gpio) ^ !polarity) {
-			if (kp->some_keys_pressed < 3)
-				kp->some_keys_pressed++;
+		raw = !!input_active(kpinfo, in, polarity);
+		if (raw && kp->some_keys_pressed < 3)
+			kp->some_keys_pressed++;
+
+		/* a change counts once two scans in a row agree on it */
+		if (raw != !!bitmap_test(kp->keys_seen, key_index)) {
+			if (raw)
+				bitmap_set(kp->keys_seen, key_index);
+			else
+				bitmap_clear(kp->keys_seen, key_index);
+			continue;
+		}
+
+		if (raw)
 			changed = !bitmap_set(kp->keys_pressed, key_index);
-		} else {
+		else
 			changed = bitmap_clear(kp->keys_pressed, key_index);
-		}
-		if (changed) {
-			int state = bitmap_test(kp->keys_pressed, key_index);
-			keys_post_event(kpinfo->keymap[key_index], state);
-		}
+		if (changed)
+			keys_post_event(kpinfo->keymap[key_index], raw);
 	}
 
 	/* sets up the right state for the next poll cycle */
-	gpio = kpinfo->output_gpios[out];
-	if (kpinfo->flags & GPIOKPF_DRIVE_INACTIVE)
-		gpio_set(gpio, !polarity);
-	else
-		gpio_config(gpio, GPIO_INPUT);
+	drive_output(kpinfo, out, polarity, 0);
+}
+
+/* whether the last scan left a change waiting for its second look */
+static int debounce_pending(struct gpio_kp *kp)
+{
+	int key_count = kp->keypad_info->ninputs * kp->keypad_info->noutputs;
+
+	return memcmp(kp->keys_seen, kp->keys_pressed, sizeof(unsigned long) *
+		      BITMAP_NUM_WORDS(key_count)) != 0;
 }
 
 static enum handler_return
@@ -108,11 +149,39 @@ gpio_keypad_timer_func(struct timer *timer, time_t now, void *arg)
 	struct gpio_kp *kp = keypad;
 	struct gpio_keypad_info *kpinfo = kp->keypad_info;
 	int polarity = !!(kpinfo->flags & GPIOKPF_ACTIVE_HIGH);
+	int pressed = 0;
 	int out;
-	int gpio;
+	int in;
 
 	out = kp->current_output;
-	if (out == kpinfo->noutputs) {
+	if (out == KP_ALL_OUTPUTS) {
+		/*
+		 * Idle: every output was driven at once, so one read of
+		 * the inputs tells whether any key is down at all.  Only
+		 * then is the matrix scanned output by output.
+		 */
+		for (in = 0; in < kpinfo->ninputs; in++)
+			pressed |= input_active(kpinfo, in, polarity);
+		for (out = 0; out < kpinfo->noutputs; out++)
+			drive_output(kpinfo, out, polarity, 0);
+		if (!pressed) {
+			kp->current_output = kpinfo->noutputs;
+			timer_set_oneshot(timer, kpinfo->poll_time,
+					  gpio_keypad_timer_func, NULL);
+			goto done;
+		}
+		kp->idle = 0;
+		out = 0;
+		kp->some_keys_pressed = 0;
+	} else if (out == kpinfo->noutputs) {
+		if (kp->idle) {
+			for (out = 0; out < kpinfo->noutputs; out++)
+				drive_output(kpinfo, out, polarity, 1);
+			kp->current_output = KP_ALL_OUTPUTS;
+			timer_set_oneshot(timer, kpinfo->settle_time,
+					  gpio_keypad_timer_func, NULL);
+			goto done;
+		}
 		out = 0;
 		kp->some_keys_pressed = 0;
 	} else {
@@ -122,27 +191,81 @@ gpio_keypad_timer_func(struct timer *timer, time_t now, void *arg)
 
 	kp->current_output = out;
 	if (out < kpinfo->noutputs) {
-		gpio = kpinfo->output_gpios[out];
-		if (kpinfo->flags & GPIOKPF_DRIVE_INACTIVE)
-			gpio_set(gpio, polarity);
-		else
-			gpio_config(gpio, polarity ? GPIO_OUTPUT : 0);
+		drive_output(kpinfo, out, polarity, 1);
 		timer_set_oneshot(timer, kpinfo->settle_time,
 				  gpio_keypad_timer_func, NULL);
 		goto done;
 	}
 
-	if (/*!kp->use_irq*/ 1 || kp->some_keys_pressed) {
-		event_signal(&kp->full_scan, false);
-		timer_set_oneshot(timer, kpinfo->poll_time,
-				  gpio_keypad_timer_func, NULL);
-		goto done;
-	}
+	kp->idle = !kp->some_keys_pressed && !debounce_pending(kp);
+	timer_set_oneshot(timer, kpinfo->poll_time,
+			  gpio_keypad_timer_func, NULL);
 
 done:
 	return INT_RESCHEDULE;
 }
 
+/*
+ * Read just the boot keys before the scan timer starts, so aboot can
+ * look at them without waiting for a full scan.  Every output carrying
+ * one is driven at once: a single settle time tells whether any of them
+ * is down, and only then is each output driven on its own to tell which.
+ * Returns whether any was down.
+ */
+static int gpio_keypad_sample(struct gpio_kp *kp)
+{
+	struct gpio_keypad_info *kpinfo = kp->keypad_info;
+	int polarity = !!(kpinfo->flags & GPIOKPF_ACTIVE_HIGH);
+	int outputs[kpinfo->noutputs];
+	int inputs[kpinfo->ninputs];
+	int key_index;
+	int out, in;
+	int pressed = 0, any = 0;
+
+	memset(outputs, 0, sizeof(outputs));
+	memset(inputs, 0, sizeof(inputs));
+	for (out = 0; out < kpinfo->noutputs; out++) {
+		for (in = 0; in < kpinfo->ninputs; in++) {
+			key_index = out * kpinfo->ninputs + in;
+			if (boot_key(kpinfo->keymap[key_index]))
+				outputs[out] = inputs[in] = any = 1;
+		}
+	}
+	if (!any)
+		return 0;
+
+	for (out = 0; out < kpinfo->noutputs; out++)
+		if (outputs[out])
+			drive_output(kpinfo, out, polarity, 1);
+	mdelay(kpinfo->settle_time);
+	for (in = 0; in < kpinfo->ninputs; in++)
+		if (inputs[in])
+			pressed |= input_active(kpinfo, in, polarity);
+	for (out = 0; out < kpinfo->noutputs; out++)
+		if (outputs[out])
+			drive_output(kpinfo, out, polarity, 0);
+	if (!pressed)
+		return 0;
+
+	for (out = 0; out < kpinfo->noutputs; out++) {
+		if (!outputs[out])
+			continue;
+		drive_output(kpinfo, out, polarity, 1);
+		mdelay(kpinfo->settle_time);
+		key_index = out * kpinfo->ninputs;
+		for (in = 0; in < kpinfo->ninputs; in++, key_index++) {
+			if (!boot_key(kpinfo->keymap[key_index]) ||
+			    !input_active(kpinfo, in, polarity))
+				continue;
+			bitmap_set(kp->keys_seen, key_index);
+			bitmap_set(kp->keys_pressed, key_index);
+			keys_post_event(kpinfo->keymap[key_index], 1);
+		}
+		drive_output(kpinfo, out, polarity, 0);
+	}
+	return 1;
+}
+
 void gpio_keypad_init(struct gpio_keypad_info *kpinfo)
 {
 	int key_count;
@@ -154,13 +277,15 @@ void gpio_keypad_init(struct gpio_keypad_info *kpinfo)
 	ASSERT(kpinfo->keymap && kpinfo->input_gpios && kpinfo->output_gpios);
 	key_count = kpinfo->ninputs * kpinfo->noutputs;
 
+	/* keys_pressed, then keys_seen */
 	len = sizeof(struct gpio_kp) + (sizeof(unsigned long) *
-					BITMAP_NUM_WORDS(key_count));
+					BITMAP_NUM_WORDS(key_count) * 2);
 	keypad = malloc(len);
 	ASSERT(keypad);
 
 	memset(keypad, 0, len);
 	keypad->keypad_info = kpinfo;
+	keypad->keys_seen = keypad->keys_pressed + BITMAP_NUM_WORDS(key_count);
 
 	output_val = (!!(kpinfo->flags & GPIOKPF_ACTIVE_HIGH)) ^
 		     (!!(kpinfo->flags & GPIOKPF_DRIVE_INACTIVE));
@@ -172,14 +297,12 @@ void gpio_keypad_init(struct gpio_keypad_info *kpinfo)
 	for (i = 0; i < kpinfo->ninputs; i++)
 		gpio_config(kpinfo->input_gpios[i], GPIO_INPUT);
 
+	/* the timer picks up everything else, from an idle check if it can */
+	keypad->idle = !gpio_keypad_sample(keypad);
 	keypad->current_output = kpinfo->noutputs;
-
-	event_init(&keypad->full_scan, false, EVENT_FLAG_AUTOUNSIGNAL);
 	timer_initialize(&keypad->timer);
-	timer_set_oneshot(&keypad->timer, 0, gpio_keypad_timer_func, NULL);
-
-	/* wait for the keypad to complete one full scan */
-	event_wait(&keypad->full_scan);
+	timer_set_oneshot(&keypad->timer, kpinfo->poll_time,
+			  gpio_keypad_timer_func, NULL);
 }
 
 int pm8058_gpio_config(int gpio, struct pm8058_gpio *param)
@@ -314,47 +437,39 @@ static void ssbi_gpio_init(unsigned int mach_id)
 static enum handler_return
 scan_qwerty_keypad(struct timer *timer, time_t now, void *arg)
 {
-    unsigned int rows = (qwerty_keypad->keypad_info)->rows;
-    unsigned int columns = (qwerty_keypad->keypad_info)->columns;
-    unsigned int num_of_ssbi_reads = (qwerty_keypad->keypad_info)->num_of_reads;
-    read_func rd_function = (qwerty_keypad->keypad_info)->rd_func;
-    unsigned char column_new_keys = 0x00;
-    unsigned char column_old_keys = 0x00;
-    int shift = 0;
-    static int key_detected = -1;
-
-    if ((*rd_function)((qwerty_keypad->keypad_info)->rec_keys, num_of_ssbi_reads,
-                                                 SSBI_REG_KYPD_REC_DATA_ADDR))
-      dprintf (CRITICAL, "Error in initializing SSBI_REG_KYPD_CNTL register\n");
-
-    if ((*rd_function)((qwerty_keypad->keypad_info)->old_keys, num_of_ssbi_reads,
-                                                 SSBI_REG_KYPD_OLD_DATA_ADDR))
-      dprintf (CRITICAL, "Error in initializing SSBI_REG_KYPD_CNTL register\n");
-
-    while (rows--) {
-         columns = qwerty_keypad->keypad_info->columns;
-         if (((qwerty_keypad->keypad_info)->rec_keys[rows]
-	      != (qwerty_keypad->keypad_info)->old_keys[rows])
-	      && ((qwerty_keypad->keypad_info)->rec_keys[rows] != 0x00)
-	     && ((qwerty_keypad->keypad_info)->old_keys[rows] != 0x00)) {
-	    while (columns--) {
-	        column_new_keys = ((qwerty_keypad->keypad_info)->rec_keys[rows]);
-	        column_old_keys = ((qwerty_keypad->keypad_info)->old_keys[rows]);
-	        if (((0x01 << columns) & (~column_new_keys))
-		    && !((0x01 << columns) & (~column_old_keys))) {
-	            shift = (rows * 8) + columns;
-	            if ((qwerty_keypad->keypad_info)->keymap[shift]) {
-		      if (shift != key_detected) {
-			    key_detected = shift;
-			    keys_post_event((qwerty_keypad->keypad_info)->keymap[shift], 1);
-		        }
-	            }
-		}
-	    }
-	}
+    struct qwerty_keypad_info *kpinfo = qwerty_keypad->keypad_info;
+    unsigned int rows = kpinfo->rows;
+    unsigned int columns;
+    unsigned long pressed, changed;
+    int shift;
+
+    /*
+     * The PMIC scans and debounces the matrix on its own; a key is down
+     * while its bit in the recent data is clear.  Post what changed since
+     * the last poll, presses and releases alike.
+     */
+    if ((*kpinfo->rd_func)(kpinfo->rec_keys, kpinfo->num_of_reads,
+                           SSBI_REG_KYPD_REC_DATA_ADDR))
+        dprintf (CRITICAL, "Error in reading SSBI_REG_KYPD_REC_DATA register\n");
+    else while (rows--) {
+        /* all zeroes is not a scan result, leave the row as it was */
+        if (kpinfo->rec_keys[rows] == 0x00)
+            continue;
+
+        columns = kpinfo->columns;
+        pressed = ~kpinfo->rec_keys[rows] & ((1UL << columns) - 1);
+        changed = pressed ^ qwerty_keypad->keys_pressed[rows];
+        qwerty_keypad->keys_pressed[rows] = pressed;
+
+        while (columns--) {
+            shift = (rows * 8) + columns;
+            if ((changed & (1UL << columns)) && kpinfo->keymap[shift])
+                keys_post_event(kpinfo->keymap[shift],
+                                (pressed >> columns) & 1);
+        }
     }
 
-    event_signal(&qwerty_keypad->full_scan, false);
+    timer_set_oneshot(timer, kpinfo->poll_time, scan_qwerty_keypad, NULL);
     return INT_RESCHEDULE;
 }
 
@@ -399,7 +514,6 @@ scan_qt_keypad(struct timer *timer, time_t now, void *arg)
             }
         }
     }
-    event_signal(&qwerty_keypad->full_scan, false);
     return INT_RESCHEDULE;
 }
 
@@ -408,14 +522,14 @@ void ssbi_keypad_init(struct qwerty_keypad_info  *qwerty_kp)
     unsigned int mach_id;
     int len;
 
-    len = sizeof(struct gpio_qwerty_kp);
+    len = sizeof(struct gpio_qwerty_kp) +
+          qwerty_kp->rows * sizeof(qwerty_keypad->keys_pressed[0]);
     qwerty_keypad = malloc(len);
     ASSERT(qwerty_keypad);
 
     memset(qwerty_keypad, 0, len);
     qwerty_keypad->keypad_info = qwerty_kp;
 
-    event_init(&qwerty_keypad->full_scan, false, EVENT_FLAG_AUTOUNSIGNAL);
     timer_initialize(&qwerty_keypad->timer);
 
 #ifdef QT_8660_KEYPAD_HW_BUG
@@ -423,18 +537,20 @@ void ssbi_keypad_init(struct qwerty_keypad_info  *qwerty_kp)
 #endif
     ssbi_gpio_init(mach_id);
 
+    /*
+     * The PMIC scans and debounces the matrix itself and latches the
+     * result, so the first read is done here instead of waiting for a
+     * timer scan; scan_qwerty_keypad() then keeps polling it.
+     */
     if(mach_id == LINUX_MACHTYPE_8660_QT)
     {
         mdelay((qwerty_keypad->keypad_info)->settle_time);
 #ifdef QT_8660_KEYPAD_HW_BUG
-        timer_set_oneshot(&qwerty_keypad->timer, 0, scan_qt_keypad, NULL);
+        scan_qt_keypad(&qwerty_keypad->timer, current_time(), NULL);
 #endif
     }
     else
-        timer_set_oneshot(&qwerty_keypad->timer, 0, scan_qwerty_keypad, NULL);
-
-    /* wait for the keypad to complete one full scan */
-    event_wait(&qwerty_keypad->full_scan);
+        scan_qwerty_keypad(&qwerty_keypad->timer, current_time(), NULL);
 }
 
 void pmic_write(unsigned address, unsigned data)
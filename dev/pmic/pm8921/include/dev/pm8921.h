@@ -85,6 +85,16 @@ typedef struct
 } pm8921_dev_t;
 
 
+/* SSBI accesses made, and the ones the shadow and batching saved */
+struct pm8921_stats {
+	uint32_t reads;
+	uint32_t writes;
+	uint32_t flushes;
+	uint32_t reads_cached;
+	uint32_t writes_elided;
+	uint32_t writes_merged;
+};
+
 struct pm8921_gpio {
 	int direction;
 	int output_buffer;
@@ -102,5 +112,9 @@ int  pm8921_gpio_config(int gpio, struct pm8921_gpio *param);
 void pm8921_boot_done(void);
 int  pm8921_ldo_set_voltage(uint32_t ldo_id, uint32_t voltage);
 int  pm8921_config_reset_pwr_off(unsigned reset);
+void pm8921_batch_begin(void);
+int  pm8921_batch_end(void);
+struct pm8921_stats *pm8921_get_stats(void);
+void pm8921_stats_dump(void);
 
 #endif
@@ -27,13 +27,53 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <assert.h>
+#include <bits.h>
+#include <debug.h>
+#include <string.h>
 #include <sys/types.h>
 #include <dev/pm8921.h>
 #include "pm8921_hw.h"
 
+/* control registers below this are shadowed; all pm8921.c touches are */
+#define PM8921_SHADOW_REGS	0x200
+#define PM8921_BANKED_REGS	16
+#define PM8921_BATCH_OPS	16
+
+/* GPIO and LDO test registers select a bank in bits 6:4 of each write */
+#define PM8921_BANK(val)	(((val) >> 4) & 0x7)
 
 static pm8921_dev_t *dev;
 
+/*
+ * Last value read from or written to each control register.  Nothing
+ * else writes the PMIC while the bootloader runs, so a register that
+ * has been seen once need not be read again, and a write of the value
+ * it already holds need not be issued.  Registers the hardware updates
+ * itself must be read with dev->read, not through pm8921_read_reg().
+ */
+static uint8_t shadow[PM8921_SHADOW_REGS];
+static unsigned long shadow_valid[BITMAP_NUM_WORDS(PM8921_SHADOW_REGS)];
+
+/* banked registers cannot be read back, so only what was written */
+static struct {
+	uint16_t addr;
+	uint8_t valid;		/* one bit per bank */
+	uint8_t val[8];
+} banked[PM8921_BANKED_REGS];
+static unsigned banked_next;
+
+struct pm8921_op {
+	uint16_t addr;
+	uint8_t val;
+};
+
+/* writes queued between pm8921_batch_begin() and pm8921_batch_end() */
+static struct pm8921_op batch[PM8921_BATCH_OPS];
+static unsigned batch_len;
+static unsigned batch_depth;
+
+static struct pm8921_stats stats;
+
 static uint8_t ldo_n_voltage_mult[LDO_VOLTAGE_ENTRIES] = {
 	18, /* 1.2V */
 	0,
@@ -58,13 +98,151 @@ void pm8921_init(pm8921_dev_t *pmic)
 	dev->initialized = 1;
 }
 
+/* issue the queued writes, one write call per run to the same register */
+static int pm8921_batch_flush(void)
+{
+	uint8_t buf[PM8921_BATCH_OPS];
+	unsigned i, n;
+	int rc = 0;
+
+	if (!batch_len)
+		return 0;
+
+	for (i = 0; i < batch_len; i += n) {
+		for (n = 0; i + n < batch_len &&
+		     batch[i + n].addr == batch[i].addr; n++)
+			buf[n] = batch[i + n].val;
+
+		rc = dev->write(buf, n, batch[i].addr);
+		stats.writes += n;
+		if (rc) {
+			/* what made it out is unknown; forget all of it */
+			memset(shadow_valid, 0, sizeof(shadow_valid));
+			memset(banked, 0, sizeof(banked));
+			break;
+		}
+	}
+	stats.flushes++;
+	batch_len = 0;
+	return rc;
+}
+
+static int pm8921_queue_write(uint16_t addr, uint8_t val, int banked)
+{
+	struct pm8921_op *last = batch_len ? &batch[batch_len - 1] : NULL;
+	int rc;
+
+	if (!batch_depth) {
+		stats.writes++;
+		return dev->write(&val, 1, addr);
+	}
+
+	/* a second write to the register just queued replaces the first */
+	if (last && last->addr == addr &&
+	    (!banked || PM8921_BANK(last->val) == PM8921_BANK(val))) {
+		last->val = val;
+		stats.writes_merged++;
+		return 0;
+	}
+
+	if (batch_len == PM8921_BATCH_OPS) {
+		rc = pm8921_batch_flush();
+		if (rc)
+			return rc;
+	}
+	batch[batch_len].addr = addr;
+	batch[batch_len].val = val;
+	batch_len++;
+	return 0;
+}
+
+/*
+ * Writes made until the matching pm8921_batch_end() are queued and
+ * issued together.  Batches nest; the outermost end issues them and
+ * returns the first error.
+ */
+void pm8921_batch_begin(void)
+{
+	batch_depth++;
+}
+
+int pm8921_batch_end(void)
+{
+	ASSERT(batch_depth);
+
+	if (--batch_depth)
+		return 0;
+	return pm8921_batch_flush();
+}
+
+static int pm8921_read_reg(uint16_t addr, uint8_t *val)
+{
+	int rc;
+
+	ASSERT(addr < PM8921_SHADOW_REGS);
+
+	if (bitmap_test(shadow_valid, addr)) {
+		*val = shadow[addr];
+		stats.reads_cached++;
+		return 0;
+	}
+
+	rc = dev->read(val, 1, addr);
+	stats.reads++;
+	if (rc)
+		return rc;
+
+	shadow[addr] = *val;
+	bitmap_set(shadow_valid, addr);
+	return 0;
+}
+
+static int pm8921_write_reg(uint16_t addr, uint8_t val)
+{
+	ASSERT(addr < PM8921_SHADOW_REGS);
+
+	if (bitmap_test(shadow_valid, addr) && shadow[addr] == val) {
+		stats.writes_elided++;
+		return 0;
+	}
+
+	shadow[addr] = val;
+	bitmap_set(shadow_valid, addr);
+	return pm8921_queue_write(addr, val, 0);
+}
+
+static int pm8921_write_banked(uint16_t addr, uint8_t val)
+{
+	unsigned bank = PM8921_BANK(val);
+	unsigned i;
+
+	for (i = 0; i < PM8921_BANKED_REGS; i++)
+		if (banked[i].valid && banked[i].addr == addr)
+			break;
+
+	if (i == PM8921_BANKED_REGS) {
+		i = banked_next;
+		banked_next = (banked_next + 1) % PM8921_BANKED_REGS;
+		banked[i].addr = addr;
+		banked[i].valid = 0;
+	} else if ((banked[i].valid & (1 << bank)) &&
+		   banked[i].val[bank] == val) {
+		stats.writes_elided++;
+		return 0;
+	}
+
+	banked[i].val[bank] = val;
+	banked[i].valid |= 1 << bank;
+	return pm8921_queue_write(addr, val, 1);
+}
+
 static int pm8921_masked_write(uint16_t addr,
 					uint8_t mask, uint8_t val)
 {
 	int rc;
 	uint8_t reg;
 
-	rc = dev->read(&reg, 1, addr);
+	rc = pm8921_read_reg(addr, &reg);
 	if (rc)
 	{
 		return rc;
@@ -72,11 +250,24 @@ static int pm8921_masked_write(uint16_t addr,
 
 	reg &= ~mask;
 	reg |= val & mask;
-	rc = dev->write(&reg, 1, addr);
+	rc = pm8921_write_reg(addr, reg);
 
 	return rc;
 }
 
+struct pm8921_stats *pm8921_get_stats(void)
+{
+	return &stats;
+}
+
+void pm8921_stats_dump(void)
+{
+	dprintf(INFO, "pm8921: %u reads, %u writes issued in %u batches; "
+		"%u reads cached, %u writes elided, %u merged\n",
+		stats.reads, stats.writes, stats.flushes, stats.reads_cached,
+		stats.writes_elided, stats.writes_merged);
+}
+
 /* Set the BOOT_DONE flag */
 void pm8921_boot_done(void)
 {
@@ -85,21 +276,27 @@ void pm8921_boot_done(void)
 	ASSERT(dev);
 	ASSERT(dev->initialized);
 
-	dev->read(&val, 1, PBL_ACCESS_2);
-	val |= PBL_ACCESS_2_ENUM_TIMER_STOP;
+	pm8921_batch_begin();
+
+	val = PBL_ACCESS_2_ENUM_TIMER_STOP;
 	/* TODO: Remove next line when h/w is rewired for battery simulation.*/
 	val |= (0x7 << 2);
-	dev->write(&val, 1, PBL_ACCESS_2);
+	pm8921_masked_write(PBL_ACCESS_2, val, val);
+
+	val = SYS_CONFIG_2_BOOT_DONE | SYS_CONFIG_2_ADAPTIVE_BOOT_DISABLE;
+	pm8921_masked_write(SYS_CONFIG_2, val, val);
 
-	dev->read(&val, 1, SYS_CONFIG_2);
-	val |= (SYS_CONFIG_2_BOOT_DONE | SYS_CONFIG_2_ADAPTIVE_BOOT_DISABLE);
-	dev->write(&val, 1, SYS_CONFIG_2);
+	pm8921_batch_end();
+
+	/* the bootloader is done with the PMIC */
+	pm8921_stats_dump();
 }
 
 /* Configure PMIC GPIO */
 int pm8921_gpio_config(int gpio, struct pm8921_gpio *param)
 {
 	int ret;
+	int i;
 	uint8_t bank[6];
 	uint8_t output_buf_config;
 	uint8_t output_value;
@@ -160,7 +357,11 @@ int pm8921_gpio_config(int gpio, struct pm8921_gpio *param)
 		((5 << PM_GPIO_BANK_SHIFT) & PM_GPIO_BANK_MASK) |
 		(param->inv_int_pol ? 0 : PM_GPIO_NON_INT_POL_INV);
 
-	ret = dev->write(bank, 6, GPIO_CNTL(gpio));
+	ret = 0;
+	pm8921_batch_begin();
+	for (i = 0; i < 6; i++)
+		ret |= pm8921_write_banked(GPIO_CNTL(gpio), bank[i]);
+	ret |= pm8921_batch_end();
 	if (ret) {
 		dprintf(CRITICAL, "Failed to write to PM8921 ret=%d.\n", ret);
 		return -1;
@@ -181,27 +382,21 @@ int pm8921_ldo_set_voltage(uint32_t ldo_id, uint32_t voltage)
 	else
 		mult = ldo_n_voltage_mult[voltage];
 
+	pm8921_batch_begin();
+
 	/* Program the TEST reg */
 	if (ldo_id & LDO_P_MASK){
 		/* Bank 2, only for p ldo, use 1.25V reference */
 		val = 0x0;
 		val |= ( 1 << PM8921_LDO_TEST_REG_RW );
 		val |= ( 2 << PM8921_LDO_TEST_REG_BANK_SEL);
-		ret = dev->write(&val, 1, PM8921_LDO_TEST_REG(ldo_number));
-		if (ret) {
-			dprintf(CRITICAL, "Failed to write to PM8921 LDO Test Reg ret=%d.\n", ret);
-			return -1;
-		}
+		ret |= pm8921_write_banked(PM8921_LDO_TEST_REG(ldo_number), val);
 
 		/* Bank 4, only for p ldo, disable output range ext, normal capacitance */
 		val = 0x0;
 		val |= ( 1 << PM8921_LDO_TEST_REG_RW );
 		val |= ( 4 << PM8921_LDO_TEST_REG_BANK_SEL);
-		ret = dev->write(&val, 1, PM8921_LDO_TEST_REG(ldo_number));
-		if (ret) {
-			dprintf(CRITICAL, "Failed to write to PM8921 LDO Test Reg ret=%d.\n", ret);
-			return -1;
-		}
+		ret |= pm8921_write_banked(PM8921_LDO_TEST_REG(ldo_number), val);
 	}
 
 	/* Program the CTRL reg */
@@ -210,9 +405,12 @@ int pm8921_ldo_set_voltage(uint32_t ldo_id, uint32_t voltage)
 	val |= ( 1 << PM8921_LDO_CTRL_REG_PULL_DOWN);
 	val |= ( 0 << PM8921_LDO_CTRL_REG_POWER_MODE);
 	val |= ( mult << PM8921_LDO_CTRL_REG_VOLTAGE);
-	ret = dev->write(&val, 1, PM8921_LDO_CTRL_REG(ldo_number));
+	ret |= pm8921_write_reg(PM8921_LDO_CTRL_REG(ldo_number), val);
+
+	/* the writes above are only queued; this is where they fail */
+	ret |= pm8921_batch_end();
 	if (ret) {
-		dprintf(CRITICAL, "Failed to write to PM8921 LDO Ctrl Reg ret=%d.\n", ret);
+		dprintf(CRITICAL, "Failed to write to PM8921 LDO regs ret=%d.\n", ret);
 		return -1;
 	}
 
@@ -256,3 +454,23 @@ read_write_err:
 	return rc;
 }
 
+#if WITH_LIB_CONSOLE
+
+#include <lib/console.h>
+
+static int cmd_pmic(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+	{ "pmic", "PMIC access statistics [reset]", &cmd_pmic },
+STATIC_COMMAND_END(pmic);
+
+static int cmd_pmic(int argc, const cmd_args *argv)
+{
+	if (argc > 1 && !strcmp(argv[1].str, "reset"))
+		memset(&stats, 0, sizeof(stats));
+	else
+		pm8921_stats_dump();
+	return 0;
+}
+
+#endif
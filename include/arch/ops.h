@@ -49,6 +49,10 @@ int atomic_or(volatile int *ptr, int val);
 void arch_disable_cache(uint flags);
 void arch_enable_cache(uint flags);
 
+/* disable caches, discarding dirty lines except for the stack up to
+ * stack_top; anything else still needed must be cleaned beforehand */
+void arch_disable_cache_discard(uint flags, addr_t stack_top);
+
 void arch_clean_cache_range(addr_t start, size_t len);
 void arch_clean_invalidate_cache_range(addr_t start, size_t len);
 void arch_invalidate_cache_range(addr_t start, size_t len);
@@ -49,6 +49,7 @@ struct fbcon_config {
 void fbcon_setup(struct fbcon_config *cfg);
 void fbcon_putc(char c);
 void fbcon_clear(void);
+void fbcon_set_cursor(unsigned col, unsigned row);
 struct fbcon_config* fbcon_display(void);
 
 #endif /* __DEV_FBCON_H */
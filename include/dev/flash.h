@@ -56,6 +56,20 @@ int flash_read_ext(struct ptentry *ptn, unsigned extra_per_page,
 int flash_write(struct ptentry *ptn, unsigned extra_per_page, const void *data,
 		unsigned bytes);
 
+/* flash_write() in pieces, for images that arrive a chunk at a time */
+struct flash_write_state {
+	struct ptentry *ptn;
+	unsigned extra;
+	unsigned page;
+	unsigned lastpage;
+};
+
+int flash_write_begin(struct flash_write_state *w, struct ptentry *ptn,
+		      unsigned extra_per_page);
+int flash_write_next(struct flash_write_state *w, const void *data,
+		     unsigned bytes);
+int flash_write_end(struct flash_write_state *w);
+
 static inline int flash_read(struct ptentry *ptn, unsigned offset, void *data,
 			     unsigned bytes)
 {
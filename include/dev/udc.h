@@ -40,6 +40,9 @@ struct udc_request {
 /* endpoints are opaque handles specific to the particular device controller */
 struct udc_endpoint;
 
+/* largest transfer a single request may carry, whatever the buffer alignment */
+#define UDC_MAX_REQUEST_SIZE	(16 * 1024)
+
 struct udc_request *udc_request_alloc(void);
 void udc_request_free(struct udc_request *req);
 int udc_request_queue(struct udc_endpoint *ept, struct udc_request *req);
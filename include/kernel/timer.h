@@ -27,6 +27,7 @@
 #include <sys/types.h>
 
 void timer_init(void);
+void timer_set_tick(time_t interval);
 
 struct timer;
 typedef enum handler_return (*timer_callback)(struct timer *, time_t now, void *arg);
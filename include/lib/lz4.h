@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __LIB_LZ4_H
+#define __LIB_LZ4_H
+
+#include <sys/types.h>
+
+#define LZ4_FRAME_MAGIC		0x184D2204
+#define LZ4_LEGACY_MAGIC	0x184C2102
+
+/* lz4_frame_decode() return codes */
+#define LZ4_FRAME_DONE		1	/* end of frame reached */
+#define LZ4_FRAME_OK		0	/* one unit decoded, call again */
+#define LZ4_FRAME_MORE		-1	/* need more input, nothing consumed */
+#define LZ4_FRAME_ERROR		-2	/* corrupt or unsupported stream */
+#define LZ4_FRAME_NOSPACE	-3	/* output limit reached */
+
+struct xxh32_state {
+	uint32_t total;
+	uint32_t large;
+	uint32_t v[4];
+	uint8_t mem[16];
+	uint32_t memsize;
+};
+
+/*
+ * Streaming decoder for the lz4 frame format (and the legacy format
+ * produced by "lz4 -l" and the kernel build).  Output is written to a
+ * single contiguous buffer so linked blocks can reference earlier data
+ * in place; input is consumed in whole units (header or block) so the
+ * caller can feed it data as it arrives without staging copies.
+ */
+struct lz4_frame {
+	unsigned state;
+	unsigned flags;
+	unsigned block_max;
+	unsigned long long content_size;
+	struct xxh32_state xxh;
+
+	unsigned char *out;
+	unsigned out_len;
+	unsigned out_max;
+};
+
+/* returns 1 if buf starts with an lz4 frame or legacy magic */
+int lz4_is_compressed(const void *buf, unsigned len);
+
+void lz4_frame_init(struct lz4_frame *f, void *out, unsigned out_max);
+
+/*
+ * Decode at most one unit from in[0..len).  *consumed is set to the
+ * number of input bytes used.  eof tells the decoder no further input
+ * follows, which ends legacy streams.  out_max may be raised by the
+ * caller between calls.
+ */
+int lz4_frame_decode(struct lz4_frame *f, const void *in, unsigned len,
+		     unsigned *consumed, bool eof);
+
+/* decode a single raw lz4 block; returns bytes written or -1 */
+int lz4_decompress_block(const void *src, unsigned srclen,
+			 void *dst, unsigned dstmax, const void *dict_start);
+
+void xxh32_init(struct xxh32_state *s);
+void xxh32_update(struct xxh32_state *s, const void *buf, unsigned len);
+uint32_t xxh32_final(struct xxh32_state *s);
+
+#endif
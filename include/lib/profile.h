@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __LIB_PROFILE_H
+#define __LIB_PROFILE_H
+
+#include <sys/types.h>
+
+/*
+ * Statistical PC sampling.  While running, every platform timer tick
+ * records the interrupted PC and thread into a buffer allocated when
+ * sampling starts.  The dump read with profile_dump_read() is
+ *
+ *   struct profile_header
+ *   struct profile_thread[thread_count]
+ *   struct profile_sample[sample_count]
+ *
+ * all little endian; scripts/lkprof symbolizes it against lk.elf.sym.
+ */
+#define PROFILE_MAGIC		0x464f5250	/* "PROF" */
+#define PROFILE_VERSION		1
+#define PROFILE_MAX_THREADS	16
+#define PROFILE_THREAD_NONE	0xffff		/* thread table was full */
+
+struct profile_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t thread_count;
+	uint32_t period;	/* ms between samples */
+	uint32_t sample_count;
+	uint32_t dropped;	/* samples lost to a full buffer */
+	uint32_t duration;	/* ms spent sampling */
+};
+
+struct profile_thread {
+	char name[32];
+};
+
+struct profile_sample {
+	uint32_t pc;
+	uint16_t thread;	/* index into the thread table */
+	uint16_t mode;		/* processor mode that was interrupted */
+};
+
+/* start sampling every 'period' ms (1-10), discarding earlier samples */
+int profile_start(unsigned period);
+void profile_stop(void);
+int profile_running(void);
+
+/* called by the platform from the timer interrupt */
+void profile_sample(addr_t pc, uint32_t mode);
+
+/* the dump of the last run; only stable while stopped */
+unsigned profile_dump_size(void);
+void profile_dump_read(void *buf, unsigned offset, unsigned len);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __LIB_REGMODEL_H
+#define __LIB_REGMODEL_H
+
+#include <sys/types.h>
+
+/*
+ * Register models of the MSM storage blocks (SDCC, NAND controller and
+ * the ADM/DMOV data mover), so mmc.c, nand.c and adm.c can run on the
+ * emulator against image files; lib/regmodel/msm builds the drivers
+ * for it (project armemu-regmodel).  With the module in the build,
+ * readl/writel/readb/writeb (include/reg.h) go through reg_model_*():
+ * an access inside an attached block is handed to its model, anything
+ * else reaches memory as before.
+ *
+ * Models keep a virtual clock in ns.  Register accesses, data mover
+ * traffic and device operations are charged with the latencies below,
+ * and a poll of a busy status register moves the clock to the moment
+ * the device is done, so the time a run takes is repeatable and does
+ * not depend on the host.
+ */
+
+struct reg_model_latency {
+	unsigned reg_ns;	/* CPU access to a modelled register */
+	unsigned dm_setup_ns;	/* data mover: command pointer to first access */
+	unsigned dm_cmd_ns;	/* data mover: per command fetched */
+	unsigned dm_word_ns;	/* data mover: per word moved */
+	unsigned mmc_cmd_ns;	/* command and response on the CMD line */
+	unsigned mmc_access_ns;	/* read access time before the first block */
+	unsigned mmc_byte_ns;	/* DAT bus time per byte */
+	unsigned mmc_prog_ns;	/* program time per block */
+	unsigned nand_read_ns;	/* tR */
+	unsigned nand_prog_ns;	/* tPROG */
+	unsigned nand_erase_ns;	/* tBERS */
+	unsigned nand_byte_ns;	/* flash bus time per byte */
+};
+
+extern struct reg_model_latency reg_model_lat;
+
+/* a block of registers; offsets passed to the ops are from its base */
+struct reg_model_ops {
+	uint32_t (*read)(void *ctx, addr_t off, unsigned size);
+	void (*write)(void *ctx, addr_t off, uint32_t val, unsigned size);
+	void (*dump)(void *ctx);	/* optional: print statistics */
+	void (*reset)(void *ctx);	/* optional: clear statistics */
+};
+
+int reg_model_register(const char *name, addr_t base, size_t size,
+		       const struct reg_model_ops *ops, void *ctx);
+
+/* the accessors include/reg.h maps readl/writel/readb/writeb to */
+uint32_t reg_model_readl(addr_t addr);
+void reg_model_writel(uint32_t val, addr_t addr);
+uint8_t reg_model_readb(addr_t addr);
+void reg_model_writeb(uint8_t val, addr_t addr);
+
+/* virtual clock */
+uint64_t reg_model_now(void);
+void reg_model_advance(uint64_t ns);
+void reg_model_wait(uint64_t until);	/* a poll that sees the device busy */
+
+/*
+ * Models.  'bdev' names the lib/bio device holding the image: raw
+ * sectors for the eMMC card, raw pages (528 bytes a codeword, spare
+ * included) for the NAND part.  The data mover is attached at the
+ * register window of the security domain the driver uses.
+ */
+int reg_model_sdcc_attach(addr_t base, const char *bdev);
+int reg_model_nand_attach(addr_t base, const char *bdev);
+int reg_model_dm_attach(const char *name, addr_t base);
+
+/* all of the above where lib/regmodel/msm's drivers look; NULL skips one */
+int reg_model_msm_attach(const char *emmc, const char *nand);
+
+/*
+ * Krait CPU0 and L2 clocks: their HFPLLs in the clock controller at
+ * 'clk_ctl' and the two aux selects.  On the emulator acpuclock.c
+ * reaches the CPMR mux registers through reg_model_l2_read/write.
+ * Switch sequences that would glitch or hang the part are counted.
+ */
+int reg_model_krait_attach(addr_t clk_ctl, addr_t cpu0_aux, addr_t l2_aux);
+uint32_t reg_model_l2_read(uint32_t addr);
+void reg_model_l2_write(uint32_t addr, uint32_t val);
+unsigned reg_model_krait_violations(void);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __LIB_TRACE_H
+#define __LIB_TRACE_H
+
+#include <sys/types.h>
+
+/*
+ * Function entry/exit tracing.  Modules listed in TRACE_MODULES (see
+ * make/build.mk) are built with -finstrument-functions; every call in
+ * them is logged with the cycle counter into a ring that needs no lock.
+ * Recording starts at boot and stops when the ring is full, so the
+ * boot path is kept; "trace start wrap" keeps the newest events instead.
+ * The dump read with trace_dump_read() is
+ *
+ *   struct trace_header
+ *   struct trace_thread[thread_count]
+ *   struct trace_event[event_count], oldest first
+ *
+ * all little endian; scripts/lktrace turns it into a Chrome trace.
+ */
+#define TRACE_MAGIC		0x45435254	/* "TRCE" */
+#define TRACE_VERSION		1
+#define TRACE_MAX_THREADS	16
+#define TRACE_THREAD_NONE	0xffff		/* thread table was full */
+
+#define TRACE_EVENT_ENTER	0
+#define TRACE_EVENT_EXIT	1
+
+/* for code that runs on behalf of the tracer */
+#define __NO_TRACE	__attribute__((no_instrument_function))
+
+struct trace_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t thread_count;
+	uint32_t event_count;
+	uint32_t lost;		/* events dropped or overwritten */
+	uint32_t cycles_per_ms;	/* 0 if the cycle counter does not run */
+};
+
+struct trace_thread {
+	char name[32];
+};
+
+struct trace_event {
+	uint32_t cycles;
+	uint32_t fn;		/* address of the function */
+	uint32_t site;		/* return address into the caller */
+	uint16_t thread;	/* index into the thread table */
+	uint16_t type;		/* TRACE_EVENT_ENTER or TRACE_EVENT_EXIT */
+};
+
+/* clear the ring and record; with 'wrap' old events are overwritten */
+void trace_start(int wrap);
+void trace_stop(void);
+int trace_running(void);
+
+/* the dump of the ring; only stable while stopped */
+unsigned trace_dump_size(void);
+void trace_dump_read(void *buf, unsigned offset, unsigned len);
+
+#endif
@@ -36,9 +36,20 @@
 #define RMWREG16(addr, startbit, width, val) *REG16(addr) = (*REG16(addr) & ~(((1<<(width)) - 1) << (startbit))) | ((val) << (startbit))
 #define RMWREG8(addr, startbit, width, val) *REG8(addr) = (*REG8(addr) & ~(((1<<(width)) - 1) << (startbit))) | ((val) << (startbit))
 
+#if WITH_REG_MODEL
+/* registers of modelled devices are simulated, see lib/regmodel.h */
+#include <lib/regmodel.h>
+
+#define writel(v, a) reg_model_writel((v), (addr_t)(a))
+#define readl(a) reg_model_readl((addr_t)(a))
+
+#define writeb(v, a) reg_model_writeb((v), (addr_t)(a))
+#define readb(a) reg_model_readb((addr_t)(a))
+#else
 #define writel(v, a) (*REG32(a) = (v))
 #define readl(a) (*REG32(a))
 
 #define writeb(v, a) (*REG8(a) = (v))
 #define readb(a) (*REG8(a))
 #endif
+#endif
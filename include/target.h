@@ -23,6 +23,8 @@
 #ifndef __TARGET_H
 #define __TARGET_H
 
+#include <sys/types.h>
+
 /* super early platform initialization, before almost everything */
 void target_early_init(void);
 
@@ -35,17 +37,48 @@ void *target_get_scratch_address(void);
 /* get the max allowed flash size */
 unsigned target_get_max_flash_size(void);
 
+/*
+ * Targets with a single storage, signing and baseband configuration set
+ * TARGET_FIXED_CONFIG (and TARGET_BASEBAND) so these become constants
+ * and the code for the other configurations is compiled out.
+ */
+#if TARGET_FIXED_CONFIG
+#if _EMMC_BOOT
+#define target_is_emmc_boot()		1
+#else
+#define target_is_emmc_boot()		0
+#endif
+#if _SIGNED_KERNEL
+#define target_use_signed_kernel()	1
+#else
+#define target_use_signed_kernel()	0
+#endif
+#else
 /* if target is using eMMC bootup */
 int target_is_emmc_boot(void);
 
+/* if boot and recovery images must be signed */
+bool target_use_signed_kernel(void);
+#endif
+
+#ifdef TARGET_BASEBAND
+#define target_baseband()		(TARGET_BASEBAND)
+#else
+unsigned target_baseband(void);
+#endif
+
 unsigned* target_atag_mem(unsigned* ptr);
 void *target_get_scratch_address(void);
 unsigned target_get_max_flash_size(void);
 void target_battery_charging_enable(unsigned enable, unsigned disconnect);
 unsigned target_pause_for_battery_charge(void);
-unsigned target_baseband(void);
 void target_serialno(unsigned char *buf);
 void target_fastboot_init(void);
 
+/* RAM kept across warm resets for the boot image cache; must lie
+ * outside the memory handed to the kernel.  NULL if there is none.
+ */
+void *target_get_boot_cache(unsigned *size);
+
 
 #endif
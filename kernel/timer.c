@@ -275,4 +275,12 @@ void timer_init(void)
 	platform_set_periodic_timer(timer_tick, NULL, 10); /* 10ms */
 }
 
+#if !PLATFORM_HAS_DYNAMIC_TIMER
+/* change the tick period; thread quanta and timer slack scale with it */
+void timer_set_tick(time_t interval)
+{
+	platform_set_periodic_timer(timer_tick, NULL, interval);
+}
+#endif
+
 
@@ -0,0 +1,461 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <debug.h>
+#include <string.h>
+#include <lib/lz4.h>
+
+#define LOCAL_TRACE 0
+
+#define LZ4_SKIPPABLE_MAGIC	0x184D2A50
+#define LZ4_SKIPPABLE_MASK	0xFFFFFFF0
+
+#define LZ4_LEGACY_BLOCK_MAX	(8 * 1024 * 1024)
+
+/* frame descriptor FLG bits */
+#define FLG_VERSION_MASK	0xC0
+#define FLG_VERSION		0x40
+#define FLG_BLOCK_CHECKSUM	0x10
+#define FLG_CONTENT_SIZE	0x08
+#define FLG_CONTENT_CHECKSUM	0x04
+#define FLG_RESERVED		0x02
+#define FLG_DICT_ID		0x01
+
+#define BLOCK_UNCOMPRESSED	0x80000000
+
+enum {
+	STATE_MAGIC,
+	STATE_BLOCK,
+	STATE_CHECKSUM,
+	STATE_LEGACY,
+	STATE_DONE,
+};
+
+#define XXH_P1	2654435761U
+#define XXH_P2	2246822519U
+#define XXH_P3	3266489917U
+#define XXH_P4	668265263U
+#define XXH_P5	374761393U
+
+static inline uint32_t read_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint32_t rotl32(uint32_t x, unsigned r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t xxh32_round(uint32_t acc, uint32_t in)
+{
+	acc += in * XXH_P2;
+	acc = rotl32(acc, 13);
+	return acc * XXH_P1;
+}
+
+void xxh32_init(struct xxh32_state *s)
+{
+	memset(s, 0, sizeof(*s));
+	s->v[0] = XXH_P1 + XXH_P2;
+	s->v[1] = XXH_P2;
+	s->v[2] = 0;
+	s->v[3] = 0 - XXH_P1;
+}
+
+void xxh32_update(struct xxh32_state *s, const void *buf, unsigned len)
+{
+	const uint8_t *p = buf;
+	const uint8_t *end = p + len;
+
+	s->total += len;
+	s->large |= (len >= 16) | (s->total >= 16);
+
+	if (s->memsize + len < 16) {
+		memcpy(s->mem + s->memsize, p, len);
+		s->memsize += len;
+		return;
+	}
+
+	if (s->memsize) {
+		memcpy(s->mem + s->memsize, p, 16 - s->memsize);
+		p += 16 - s->memsize;
+		s->v[0] = xxh32_round(s->v[0], read_le32(s->mem));
+		s->v[1] = xxh32_round(s->v[1], read_le32(s->mem + 4));
+		s->v[2] = xxh32_round(s->v[2], read_le32(s->mem + 8));
+		s->v[3] = xxh32_round(s->v[3], read_le32(s->mem + 12));
+		s->memsize = 0;
+	}
+
+	while (p + 16 <= end) {
+		s->v[0] = xxh32_round(s->v[0], read_le32(p));
+		s->v[1] = xxh32_round(s->v[1], read_le32(p + 4));
+		s->v[2] = xxh32_round(s->v[2], read_le32(p + 8));
+		s->v[3] = xxh32_round(s->v[3], read_le32(p + 12));
+		p += 16;
+	}
+
+	if (p < end) {
+		memcpy(s->mem, p, end - p);
+		s->memsize = end - p;
+	}
+}
+
+uint32_t xxh32_final(struct xxh32_state *s)
+{
+	const uint8_t *p = s->mem;
+	const uint8_t *end = p + s->memsize;
+	uint32_t h;
+
+	if (s->large)
+		h = rotl32(s->v[0], 1) + rotl32(s->v[1], 7) +
+		    rotl32(s->v[2], 12) + rotl32(s->v[3], 18);
+	else
+		h = s->v[2] + XXH_P5;
+
+	h += s->total;
+
+	while (p + 4 <= end) {
+		h += read_le32(p) * XXH_P3;
+		h = rotl32(h, 17) * XXH_P4;
+		p += 4;
+	}
+	while (p < end) {
+		h += (*p++) * XXH_P5;
+		h = rotl32(h, 11) * XXH_P1;
+	}
+
+	h ^= h >> 15;
+	h *= XXH_P2;
+	h ^= h >> 13;
+	h *= XXH_P3;
+	h ^= h >> 16;
+	return h;
+}
+
+static inline int read_length(const uint8_t **ip, const uint8_t *iend,
+			      unsigned *len)
+{
+	unsigned s;
+
+	do {
+		if (*ip >= iend)
+			return -1;
+		s = *(*ip)++;
+		*len += s;
+	} while (s == 255);
+
+	return 0;
+}
+
+int lz4_decompress_block(const void *src, unsigned srclen,
+			 void *dst, unsigned dstmax, const void *dict_start)
+{
+	const uint8_t *ip = src;
+	const uint8_t *iend = ip + srclen;
+	const uint8_t *lowest = dict_start ? dict_start : dst;
+	uint8_t *op = dst;
+	uint8_t *oend = op + dstmax;
+	const uint8_t *match;
+	unsigned token, len, offset;
+
+	if (srclen == 0)
+		return -1;
+
+	for (;;) {
+		/* a block must end with literals, never with a match */
+		if (ip >= iend)
+			return -1;
+		token = *ip++;
+
+		/* literals */
+		len = token >> 4;
+		if (len == 15 && read_length(&ip, iend, &len))
+			return -1;
+		if (len > (unsigned)(iend - ip) || len > (unsigned)(oend - op))
+			return -1;
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		/* the last sequence carries literals only */
+		if (ip == iend)
+			break;
+
+		/* match */
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (unsigned)(op - lowest))
+			return -1;
+
+		len = token & 15;
+		if (len == 15 && read_length(&ip, iend, &len))
+			return -1;
+		len += 4;
+		if (len > (unsigned)(oend - op))
+			return -1;
+
+		match = op - offset;
+		if (offset >= len) {
+			memcpy(op, match, len);
+			op += len;
+		} else {
+			/* overlapping copy replicates the pattern */
+			while (len--)
+				*op++ = *match++;
+		}
+	}
+
+	return op - (uint8_t *)dst;
+}
+
+int lz4_is_compressed(const void *buf, unsigned len)
+{
+	uint32_t magic;
+
+	if (len < 4)
+		return 0;
+
+	magic = read_le32(buf);
+	return (magic == LZ4_FRAME_MAGIC) || (magic == LZ4_LEGACY_MAGIC);
+}
+
+void lz4_frame_init(struct lz4_frame *f, void *out, unsigned out_max)
+{
+	memset(f, 0, sizeof(*f));
+	f->state = STATE_MAGIC;
+	f->out = out;
+	f->out_max = out_max;
+}
+
+static int lz4_frame_header(struct lz4_frame *f, const uint8_t *in,
+			    unsigned len, unsigned *consumed)
+{
+	struct xxh32_state hc;
+	unsigned hdr_len = 7;
+	uint32_t magic;
+	unsigned flg, bd;
+
+	if (len < 4)
+		return LZ4_FRAME_MORE;
+
+	magic = read_le32(in);
+	if (magic == LZ4_LEGACY_MAGIC) {
+		f->block_max = LZ4_LEGACY_BLOCK_MAX;
+		f->state = STATE_LEGACY;
+		*consumed = 4;
+		return LZ4_FRAME_OK;
+	}
+
+	if ((magic & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+		if (len < 8)
+			return LZ4_FRAME_MORE;
+		if (len - 8 < read_le32(in + 4))
+			return LZ4_FRAME_MORE;
+		*consumed = 8 + read_le32(in + 4);
+		return LZ4_FRAME_OK;
+	}
+
+	if (magic != LZ4_FRAME_MAGIC) {
+		dprintf(CRITICAL, "lz4: bad magic 0x%08x\n", magic);
+		return LZ4_FRAME_ERROR;
+	}
+
+	if (len < 6)
+		return LZ4_FRAME_MORE;
+
+	flg = in[4];
+	bd = in[5];
+	if ((flg & FLG_VERSION_MASK) != FLG_VERSION || (flg & FLG_RESERVED)) {
+		dprintf(CRITICAL, "lz4: unsupported frame version\n");
+		return LZ4_FRAME_ERROR;
+	}
+	if (flg & FLG_DICT_ID) {
+		dprintf(CRITICAL, "lz4: external dictionaries not supported\n");
+		return LZ4_FRAME_ERROR;
+	}
+	if ((bd & 0x8f) || ((bd >> 4) & 7) < 4) {
+		dprintf(CRITICAL, "lz4: bad block descriptor 0x%02x\n", bd);
+		return LZ4_FRAME_ERROR;
+	}
+
+	if (flg & FLG_CONTENT_SIZE)
+		hdr_len += 8;
+	if (len < hdr_len)
+		return LZ4_FRAME_MORE;
+
+	xxh32_init(&hc);
+	xxh32_update(&hc, in + 4, hdr_len - 5);
+	if (((xxh32_final(&hc) >> 8) & 0xff) != in[hdr_len - 1]) {
+		dprintf(CRITICAL, "lz4: frame header checksum mismatch\n");
+		return LZ4_FRAME_ERROR;
+	}
+
+	f->flags = flg;
+	f->block_max = 1 << (8 + 2 * ((bd >> 4) & 7));
+	if (flg & FLG_CONTENT_SIZE) {
+		f->content_size = read_le32(in + 6) |
+			((unsigned long long)read_le32(in + 10) << 32);
+	}
+	if (flg & FLG_CONTENT_CHECKSUM)
+		xxh32_init(&f->xxh);
+
+	f->state = STATE_BLOCK;
+	*consumed = hdr_len;
+	return LZ4_FRAME_OK;
+}
+
+static int lz4_frame_block(struct lz4_frame *f, const uint8_t *data,
+			   unsigned size, unsigned raw)
+{
+	unsigned room = f->out_max - f->out_len;
+	unsigned char *dst = f->out + f->out_len;
+	int n;
+
+	if (raw) {
+		if (size > room)
+			return LZ4_FRAME_NOSPACE;
+		memcpy(dst, data, size);
+		n = size;
+	} else {
+		n = lz4_decompress_block(data, size, dst,
+					 room < f->block_max ? room : f->block_max,
+					 f->out);
+		if (n < 0)
+			return (room < f->block_max) ? LZ4_FRAME_NOSPACE :
+				LZ4_FRAME_ERROR;
+	}
+
+	if (f->flags & FLG_CONTENT_CHECKSUM)
+		xxh32_update(&f->xxh, dst, n);
+	f->out_len += n;
+	return LZ4_FRAME_OK;
+}
+
+int lz4_frame_decode(struct lz4_frame *f, const void *_in, unsigned len,
+		     unsigned *consumed, bool eof)
+{
+	const uint8_t *in = _in;
+	unsigned need, size;
+	int ret;
+
+	*consumed = 0;
+
+	switch (f->state) {
+	case STATE_MAGIC:
+		ret = lz4_frame_header(f, in, len, consumed);
+		break;
+
+	case STATE_BLOCK:
+		if (len < 4) {
+			ret = LZ4_FRAME_MORE;
+			break;
+		}
+		size = read_le32(in);
+		if (size == 0) {
+			f->state = (f->flags & FLG_CONTENT_CHECKSUM) ?
+				STATE_CHECKSUM : STATE_DONE;
+			*consumed = 4;
+			ret = (f->state == STATE_DONE) ? LZ4_FRAME_DONE :
+				LZ4_FRAME_OK;
+			break;
+		}
+		need = 4 + (size & ~BLOCK_UNCOMPRESSED);
+		if (f->flags & FLG_BLOCK_CHECKSUM)
+			need += 4;
+		if ((size & ~BLOCK_UNCOMPRESSED) > f->block_max) {
+			ret = LZ4_FRAME_ERROR;
+			break;
+		}
+		if (len < need) {
+			ret = LZ4_FRAME_MORE;
+			break;
+		}
+		ret = lz4_frame_block(f, in + 4, size & ~BLOCK_UNCOMPRESSED,
+				      size & BLOCK_UNCOMPRESSED);
+		if (ret == LZ4_FRAME_OK)
+			*consumed = need;
+		break;
+
+	case STATE_CHECKSUM:
+		if (len < 4) {
+			ret = LZ4_FRAME_MORE;
+			break;
+		}
+		if (read_le32(in) != xxh32_final(&f->xxh)) {
+			dprintf(CRITICAL, "lz4: content checksum mismatch\n");
+			ret = LZ4_FRAME_ERROR;
+			break;
+		}
+		*consumed = 4;
+		f->state = STATE_DONE;
+		ret = LZ4_FRAME_DONE;
+		break;
+
+	case STATE_LEGACY:
+		if (len == 0 && eof) {
+			f->state = STATE_DONE;
+			ret = LZ4_FRAME_DONE;
+			break;
+		}
+		if (len < 4) {
+			ret = LZ4_FRAME_MORE;
+			break;
+		}
+		size = read_le32(in);
+		if (size == LZ4_LEGACY_MAGIC) {
+			/* concatenated legacy streams */
+			*consumed = 4;
+			ret = LZ4_FRAME_OK;
+			break;
+		}
+		if (size > f->block_max + f->block_max / 255 + 16) {
+			/* trailing data after the last block ends the stream */
+			f->state = STATE_DONE;
+			ret = LZ4_FRAME_DONE;
+			break;
+		}
+		if (len - 4 < size) {
+			ret = LZ4_FRAME_MORE;
+			break;
+		}
+		ret = lz4_frame_block(f, in + 4, size, 0);
+		if (ret == LZ4_FRAME_OK)
+			*consumed = 4 + size;
+		break;
+
+	case STATE_DONE:
+		ret = LZ4_FRAME_DONE;
+		break;
+
+	default:
+		ret = LZ4_FRAME_ERROR;
+		break;
+	}
+
+	if (ret == LZ4_FRAME_MORE && eof)
+		ret = LZ4_FRAME_ERROR;
+
+	return ret;
+}
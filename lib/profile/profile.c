@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <debug.h>
+#include <err.h>
+#include <string.h>
+#include <malloc.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <platform.h>
+#include <lib/profile.h>
+
+#ifndef PROFILE_SAMPLES
+#define PROFILE_SAMPLES		16384	/* 128 KB */
+#endif
+
+#define PROFILE_PERIOD_MAX	10	/* the normal kernel tick */
+
+static struct profile_header hdr;
+static struct profile_thread threads[PROFILE_MAX_THREADS];
+static thread_t *thread_ptr[PROFILE_MAX_THREADS];
+static struct profile_sample *samples;
+static volatile int running;
+static time_t started;
+
+int profile_start(unsigned period)
+{
+	if (period == 0 || period > PROFILE_PERIOD_MAX)
+		return ERR_INVALID_ARGS;
+
+	if (!samples) {
+		samples = malloc(PROFILE_SAMPLES * sizeof(*samples));
+		if (!samples)
+			return ERR_NO_MEMORY;
+	}
+
+	profile_stop();
+
+	enter_critical_section();
+	memset(&hdr, 0, sizeof(hdr));
+	memset(thread_ptr, 0, sizeof(thread_ptr));
+	hdr.magic = PROFILE_MAGIC;
+	hdr.version = PROFILE_VERSION;
+	hdr.period = period;
+	started = current_time();
+	running = 1;
+	exit_critical_section();
+
+	/* sample on every tick, so tick at the sampling rate */
+	timer_set_tick(period);
+	return NO_ERROR;
+}
+
+void profile_stop(void)
+{
+	if (!running)
+		return;
+
+	enter_critical_section();
+	running = 0;
+	hdr.duration = current_time() - started;
+	exit_critical_section();
+
+	timer_set_tick(PROFILE_PERIOD_MAX);
+}
+
+int profile_running(void)
+{
+	return running;
+}
+
+static unsigned profile_thread(thread_t *t)
+{
+	unsigned i;
+
+	for (i = 0; i < hdr.thread_count; i++)
+		if (thread_ptr[i] == t &&
+		    !strncmp(threads[i].name, t->name, sizeof(threads[i].name)))
+			return i;
+
+	if (i == PROFILE_MAX_THREADS)
+		return PROFILE_THREAD_NONE;
+
+	thread_ptr[i] = t;
+	memcpy(threads[i].name, t->name, sizeof(threads[i].name));
+	threads[i].name[sizeof(threads[i].name) - 1] = 0;
+	hdr.thread_count++;
+	return i;
+}
+
+void profile_sample(addr_t pc, uint32_t mode)
+{
+	struct profile_sample *s;
+
+	if (!running)
+		return;
+
+	if (hdr.sample_count == PROFILE_SAMPLES) {
+		hdr.dropped++;
+		return;
+	}
+
+	s = &samples[hdr.sample_count++];
+	s->pc = pc;
+	s->thread = profile_thread(current_thread);
+	s->mode = mode;
+}
+
+unsigned profile_dump_size(void)
+{
+	if (!samples)
+		return 0;
+
+	return sizeof(hdr) + hdr.thread_count * sizeof(threads[0]) +
+	       hdr.sample_count * sizeof(samples[0]);
+}
+
+void profile_dump_read(void *buf, unsigned offset, unsigned len)
+{
+	const struct {
+		const void *base;
+		unsigned size;
+	} part[] = {
+		{ &hdr, sizeof(hdr) },
+		{ threads, hdr.thread_count * sizeof(threads[0]) },
+		{ samples, hdr.sample_count * sizeof(samples[0]) },
+	};
+	unsigned char *out = buf;
+	unsigned i, n;
+
+	for (i = 0; i < countof(part) && len; i++) {
+		if (offset >= part[i].size) {
+			offset -= part[i].size;
+			continue;
+		}
+		n = part[i].size - offset;
+		if (n > len)
+			n = len;
+		memcpy(out, (const unsigned char *) part[i].base + offset, n);
+		out += n;
+		len -= n;
+		offset = 0;
+	}
+}
+
+#if WITH_LIB_CONSOLE
+
+#include <lib/console.h>
+
+static int cmd_profile(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+	{ "profile", "pc sampling profiler", &cmd_profile },
+STATIC_COMMAND_END(profile);
+
+static int cmd_profile(int argc, const cmd_args *argv)
+{
+	unsigned i;
+	int err;
+
+	if (argc < 2) {
+		printf("usage: profile start [ms] | stop | dump\n");
+		printf("%s, %u samples, %u dropped\n",
+			running ? "running" : "stopped", hdr.sample_count,
+			hdr.dropped);
+		return 0;
+	}
+
+	if (!strcmp(argv[1].str, "start")) {
+		err = profile_start(argc > 2 ? argv[2].u : 1);
+		if (err < 0)
+			printf("profile: cannot start (%d)\n", err);
+		return err;
+	} else if (!strcmp(argv[1].str, "stop")) {
+		profile_stop();
+		printf("%u samples in %u ms, %u dropped\n", hdr.sample_count,
+			hdr.duration, hdr.dropped);
+	} else if (!strcmp(argv[1].str, "dump")) {
+		/* same records as the binary dump, for scripts/lkprof */
+		profile_stop();
+		printf("prof-header %u %u %u %u\n", hdr.period,
+			hdr.sample_count, hdr.dropped, hdr.duration);
+		for (i = 0; i < hdr.thread_count; i++)
+			printf("prof-thread %u %s\n", i, threads[i].name);
+		for (i = 0; i < hdr.sample_count; i++)
+			printf("prof %08x %u %u\n", samples[i].pc,
+				samples[i].thread, samples[i].mode);
+	} else {
+		printf("unrecognized command\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+#endif
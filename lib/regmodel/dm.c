@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Data mover model, for both the ADM (adm.c) and the DMOV (nand.c):
+ * they are the same engine with the same per channel registers in a
+ * security domain window.  A command pointer write runs the whole
+ * pointer list at once on the mover's own timeline, which starts at
+ * the write and ends when the result becomes visible; the CPU goes on
+ * meanwhile and a status poll before the end waits for it.  Transfers
+ * to or from a modelled block go through that block's model a word at
+ * a time, so the SDCC FIFO and the NAND buffer see what the real
+ * controller would.
+ *
+ * Single item and box commands are modelled; scatter/gather is not and
+ * fails the list.  CRCI flow control is implicit: the models make data
+ * available when it is asked for, and charge the wait on the clock.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+#include "regmodel_p.h"
+
+#define DM_WINDOW		0x400
+#define DM_CHANNELS		16
+
+/* per channel registers, 4 bytes apart */
+#define DM_CMD_PTR		0x000
+#define DM_RSLT			0x040
+#define DM_FLUSH0		0x080
+#define DM_FLUSH5		0x1C0
+#define DM_STATUS		0x200
+#define DM_CONFIG		0x300
+#define DM_ISR			0x380
+
+#define DM_CMD_PTR_MODE(v)	(((v) >> 29) & 3)
+#define DM_CMD_PTR_CONFIG	2	/* modes 2 and 3 load configuration */
+#define DM_ADDR(v)		(((v) & 0x1FFFFFFF) << 3)
+#define DM_PTR_LP		(1U << 31)
+
+#define DM_CMD_LC		(1U << 31)
+#define DM_CMD_MODE(c)		((c) & 3)
+#define DM_CMD_SINGLE		0
+#define DM_CMD_BOX		3
+
+#define DM_RSLT_VALID		(1U << 31)
+#define DM_RSLT_ERROR		(1 << 3)
+#define DM_RSLT_DONE		(1 << 1)
+
+#define DM_STATUS_RSLT_VALID	(1 << 1)
+#define DM_STATUS_CMD_PTR_RDY	(1 << 0)
+
+/* a runaway list is a driver bug; do not hang the emulator on it */
+#define DM_MAX_CMDS		4096
+
+struct dm_chan {
+	uint64_t done_at;
+	unsigned results;
+	uint32_t result;
+	uint32_t config;
+};
+
+struct dm {
+	const char *name;
+	struct dm_chan ch[DM_CHANNELS];
+	uint32_t isr;
+
+	unsigned ptrs;
+	unsigned cmds;
+	unsigned errors;
+	unsigned long long bytes;
+	unsigned long long busy_ns;
+};
+
+/* move 'len' bytes; a modelled side is accessed a word at a time */
+static void dm_copy(addr_t dst, addr_t src, unsigned len)
+{
+	uint32_t w;
+	unsigned n;
+
+	reg_model_advance((uint64_t) ((len + 3) / 4) *
+			  reg_model_lat.dm_word_ns);
+
+	if (!reg_model_claimed(dst) && !reg_model_claimed(src)) {
+		memcpy((void *) dst, (const void *) src, len);
+		return;
+	}
+
+	while (len) {
+		n = MIN(len, 4);
+		if (reg_model_claimed(src))
+			w = reg_model_dm_read(src);
+		else
+			memcpy(&w, (const void *) src, n);
+		if (reg_model_claimed(dst))
+			reg_model_dm_write(w, dst);
+		else
+			memcpy((void *) dst, &w, n);
+		src += n;
+		dst += n;
+		len -= n;
+	}
+}
+
+/* one command list; 0 or an error */
+static int dm_run_list(struct dm *dm, addr_t list)
+{
+	uint32_t cmd, src, dst, len, rows, offset;
+	unsigned i, r;
+
+	for (i = 0; i < DM_MAX_CMDS; i++) {
+		cmd = reg_model_dm_read(list);
+		src = reg_model_dm_read(list + 4);
+		dst = reg_model_dm_read(list + 8);
+		reg_model_advance(reg_model_lat.dm_cmd_ns);
+		dm->cmds++;
+
+		switch (DM_CMD_MODE(cmd)) {
+		case DM_CMD_SINGLE:
+			len = reg_model_dm_read(list + 12) & 0xFFFF;
+			dm_copy(dst, src, len);
+			dm->bytes += len;
+			list += 16;
+			break;
+
+		case DM_CMD_BOX:
+			len = reg_model_dm_read(list + 12);
+			rows = reg_model_dm_read(list + 16);
+			offset = reg_model_dm_read(list + 20);
+			if ((len >> 16) != (len & 0xFFFF) ||
+			    (rows >> 16) != (rows & 0xFFFF))
+				return ERR_NOT_SUPPORTED;
+			len &= 0xFFFF;
+			for (r = 0; r < (rows & 0xFFFF); r++)
+				dm_copy(dst + r * (offset & 0xFFFF),
+					src + r * (offset >> 16), len);
+			dm->bytes += len * (rows & 0xFFFF);
+			list += 24;
+			break;
+
+		default:
+			dprintf(CRITICAL, "regmodel: %s: command mode %u not "
+				"modelled\n", dm->name, DM_CMD_MODE(cmd));
+			return ERR_NOT_SUPPORTED;
+		}
+
+		if (cmd & DM_CMD_LC)
+			return 0;
+	}
+	return ERR_TOO_BIG;
+}
+
+/*
+ * The ADM driver writes its pointer list address with mode 0 where the
+ * DMOV driver uses mode 1; both work on silicon, so both walk a list of
+ * command list pointers here.
+ */
+static void dm_start(struct dm *dm, unsigned n, uint32_t val)
+{
+	struct dm_chan *ch = &dm->ch[n];
+	uint64_t cpu = reg_model_fork();
+	addr_t ptr = DM_ADDR(val);
+	uint32_t p;
+	int err = 0;
+	unsigned i;
+
+	dm->ptrs++;
+	reg_model_advance(reg_model_lat.dm_setup_ns);
+
+	if (DM_CMD_PTR_MODE(val) < DM_CMD_PTR_CONFIG) {
+		for (i = 0; i < DM_MAX_CMDS && !err; i++, ptr += 4) {
+			p = reg_model_dm_read(ptr);
+			err = dm_run_list(dm, DM_ADDR(p));
+			if (p & DM_PTR_LP)
+				break;
+		}
+	}
+
+	if (err)
+		dm->errors++;
+	ch->result = DM_RSLT_VALID | DM_RSLT_DONE | (err ? DM_RSLT_ERROR : 0);
+	ch->results = 1;
+	ch->done_at = reg_model_now();
+	dm->isr |= 1 << n;
+	dm->busy_ns += ch->done_at - cpu;
+
+	reg_model_join(cpu);
+}
+
+static uint32_t dm_read(void *ctx, addr_t off, unsigned size)
+{
+	struct dm *dm = ctx;
+	struct dm_chan *ch;
+	unsigned n = (off & 0x3F) >> 2;
+	uint32_t val;
+
+	if (off >= DM_ISR) {
+		val = dm->isr;
+		dm->isr = 0;
+		return val;
+	}
+
+	ch = &dm->ch[n];
+	switch (off & ~0x3F) {
+	case DM_RSLT:
+		reg_model_wait(ch->done_at);
+		if (!ch->results)
+			return 0;
+		ch->results--;
+		return ch->result;
+	case DM_STATUS:
+		reg_model_wait(ch->done_at);
+		return (ch->results << 29) |
+		       (ch->results ? DM_STATUS_RSLT_VALID : 0) |
+		       DM_STATUS_CMD_PTR_RDY;
+	case DM_CONFIG:
+		return ch->config;
+	default:
+		/* FLUSH0-5: nothing is ever flushed */
+		return 0;
+	}
+}
+
+static void dm_write(void *ctx, addr_t off, uint32_t val, unsigned size)
+{
+	struct dm *dm = ctx;
+	unsigned n = (off & 0x3F) >> 2;
+
+	if (off >= DM_ISR)
+		return;
+
+	switch (off & ~0x3F) {
+	case DM_CMD_PTR:
+		/* a new list waits for the one in flight */
+		reg_model_wait(dm->ch[n].done_at);
+		dm_start(dm, n, val);
+		break;
+	case DM_CONFIG:
+		dm->ch[n].config = val;
+		break;
+	}
+}
+
+static void dm_dump(void *ctx)
+{
+	struct dm *dm = ctx;
+
+	printf("       %u pointer lists, %u commands, %u failed, %llu KB, "
+		"busy %llu us\n", dm->ptrs, dm->cmds, dm->errors,
+		dm->bytes / 1024, dm->busy_ns / 1000);
+}
+
+static void dm_reset(void *ctx)
+{
+	struct dm *dm = ctx;
+	unsigned n;
+
+	dm->ptrs = 0;
+	dm->cmds = 0;
+	dm->errors = 0;
+	dm->bytes = 0;
+	dm->busy_ns = 0;
+	for (n = 0; n < DM_CHANNELS; n++)
+		dm->ch[n].done_at = 0;
+}
+
+static const struct reg_model_ops dm_ops = {
+	.read = dm_read,
+	.write = dm_write,
+	.dump = dm_dump,
+	.reset = dm_reset,
+};
+
+int reg_model_dm_attach(const char *name, addr_t base)
+{
+	struct dm *dm;
+	int err;
+
+	dm = calloc(1, sizeof(*dm));
+	if (!dm)
+		return ERR_NO_MEMORY;
+	dm->name = name;
+
+	err = reg_model_register(name, base, DM_WINDOW, &dm_ops, dm);
+	if (err < 0)
+		free(dm);
+	return err;
+}
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Krait CPU0 and L2 clocks as acpuclock.c drives them: the HFPLL of
+ * each in the clock controller, the secondary mux aux selects in the
+ * APCS, and the primary/secondary mux selects in the L2 indirect CPMR
+ * registers, which the driver reaches through reg_model_l2_read/write
+ * instead of CP15.  The clocks start as the previous stage leaves them,
+ * on PLL8 through the aux source with the HFPLLs off.
+ *
+ * The model checks the switch sequence and counts what would glitch or
+ * hang the part:
+ * - an HFPLL written while its clock runs from it;
+ * - reset released under 10us after bypass, or the output enabled
+ *   under 60us after reset, before the PLL can have locked;
+ * - the primary mux moved from or to an HFPLL that is not running.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <kernel/thread.h>
+
+#include "regmodel_p.h"
+
+/* clock controller offsets, as apq-touchpad's platform/iomap.h */
+#define GCC_WINDOW_OFF		0x3100
+#define GCC_WINDOW		0x400
+#define GCC_PLL8_STATUS		0x058
+#define GCC_HFPLL_CPU0		0x100
+#define GCC_HFPLL_L2		0x200
+#define GCC_PLL_ENABLE_SC0	0x3C0
+
+#define HFPLL_WINDOW		0x18
+#define HFPLL_MODE		0x00
+#define HFPLL_CONFIG_CTL	0x04
+#define HFPLL_L_VAL		0x08
+#define HFPLL_M_VAL		0x0C
+#define HFPLL_N_VAL		0x10
+#define HFPLL_DROOP_CTL		0x14
+
+#define HFPLL_OUTCTRL		(1 << 0)
+#define HFPLL_BYPASSNL		(1 << 1)
+#define HFPLL_RESET_N		(1 << 2)
+#define HFPLL_ON		(HFPLL_OUTCTRL | HFPLL_BYPASSNL | HFPLL_RESET_N)
+
+#define HFPLL_BYPASS_NS		10000
+#define HFPLL_LOCK_NS		60000
+
+/* L2 indirect CPMR registers and their mux selects */
+#define CPMR_L2			0x0500
+#define CPMR_CPU0		0x4501
+#define PRI_SRC_SEL_MASK	0x3
+#define PRI_SRC_SEL_HFPLL	1
+#define SEC_SRC_SEL_AUX		(2 << 2)
+
+#define AUX_CLK_SEL_PLL8	3
+
+#define PLL8_STATUS_ON		(1 << 16)
+
+struct krait_clk {
+	const char *name;
+	uint32_t cpmr_addr;
+	uint32_t cpmr;
+	uint32_t aux;
+	uint32_t pll[HFPLL_WINDOW / 4];
+	uint64_t bypass_at;
+	uint64_t reset_at;
+	unsigned switches;
+};
+
+struct krait {
+	struct krait_clk clk[2];	/* L2, CPU0 */
+	uint32_t enable_sc0;
+	unsigned violations;
+};
+
+static struct krait *krait;
+
+static void krait_violation(struct krait *k, struct krait_clk *c,
+			    const char *what)
+{
+	dprintf(CRITICAL, "regmodel: krait: %s %s at %llu ns\n", c->name,
+		what, reg_model_now());
+	k->violations++;
+}
+
+static int krait_on_hfpll(struct krait_clk *c)
+{
+	return (c->cpmr & PRI_SRC_SEL_MASK) == PRI_SRC_SEL_HFPLL;
+}
+
+static int krait_hfpll_running(struct krait_clk *c)
+{
+	return (c->pll[HFPLL_MODE / 4] & HFPLL_ON) == HFPLL_ON;
+}
+
+static void krait_hfpll_write(struct krait *k, struct krait_clk *c,
+			      addr_t off, uint32_t val)
+{
+	uint32_t old = c->pll[HFPLL_MODE / 4];
+	uint32_t rise = val & ~old;
+
+	if (krait_on_hfpll(c))
+		krait_violation(k, c, "HFPLL written while in use");
+	if (off != HFPLL_MODE) {
+		c->pll[off / 4] = val;
+		return;
+	}
+
+	if (rise & HFPLL_BYPASSNL)
+		c->bypass_at = reg_model_now();
+	if (rise & HFPLL_RESET_N) {
+		if (reg_model_now() - c->bypass_at < HFPLL_BYPASS_NS)
+			krait_violation(k, c, "HFPLL out of reset too early");
+		c->reset_at = reg_model_now();
+	}
+	if ((rise & HFPLL_OUTCTRL) &&
+	    (!(val & HFPLL_RESET_N) ||
+	     reg_model_now() - c->reset_at < HFPLL_LOCK_NS))
+		krait_violation(k, c, "HFPLL output on before lock");
+	c->pll[HFPLL_MODE / 4] = val;
+}
+
+static uint32_t krait_gcc_read(void *ctx, addr_t off, unsigned size)
+{
+	struct krait *k = ctx;
+
+	if (off >= GCC_HFPLL_CPU0 && off < GCC_HFPLL_CPU0 + HFPLL_WINDOW)
+		return k->clk[1].pll[(off - GCC_HFPLL_CPU0) / 4];
+	if (off >= GCC_HFPLL_L2 && off < GCC_HFPLL_L2 + HFPLL_WINDOW)
+		return k->clk[0].pll[(off - GCC_HFPLL_L2) / 4];
+
+	switch (off) {
+	case GCC_PLL8_STATUS:
+		/* PLL8 is up before we run; the vote only keeps it there */
+		return PLL8_STATUS_ON;
+	case GCC_PLL_ENABLE_SC0:
+		return k->enable_sc0;
+	}
+	return 0;
+}
+
+static void krait_gcc_write(void *ctx, addr_t off, uint32_t val,
+			    unsigned size)
+{
+	struct krait *k = ctx;
+
+	if (off >= GCC_HFPLL_CPU0 && off < GCC_HFPLL_CPU0 + HFPLL_WINDOW)
+		krait_hfpll_write(k, &k->clk[1], off - GCC_HFPLL_CPU0, val);
+	else if (off >= GCC_HFPLL_L2 && off < GCC_HFPLL_L2 + HFPLL_WINDOW)
+		krait_hfpll_write(k, &k->clk[0], off - GCC_HFPLL_L2, val);
+	else if (off == GCC_PLL_ENABLE_SC0)
+		k->enable_sc0 = val;
+}
+
+static void krait_dump(void *ctx)
+{
+	struct krait *k = ctx;
+	struct krait_clk *c;
+	unsigned i;
+
+	for (i = 0; i < countof(k->clk); i++) {
+		c = &k->clk[i];
+		printf("       %s: %s, HFPLL L %u %s, %u switches\n", c->name,
+			krait_on_hfpll(c) ? "HFPLL" : "secondary",
+			c->pll[HFPLL_L_VAL / 4],
+			krait_hfpll_running(c) ? "on" : "off", c->switches);
+	}
+	printf("       %u sequence violations\n", k->violations);
+}
+
+static void krait_reset(void *ctx)
+{
+	struct krait *k = ctx;
+
+	k->violations = 0;
+	k->clk[0].switches = 0;
+	k->clk[1].switches = 0;
+}
+
+static const struct reg_model_ops krait_gcc_ops = {
+	.read = krait_gcc_read,
+	.write = krait_gcc_write,
+	.dump = krait_dump,
+	.reset = krait_reset,
+};
+
+static uint32_t krait_aux_read(void *ctx, addr_t off, unsigned size)
+{
+	struct krait_clk *c = ctx;
+
+	return c->aux;
+}
+
+static void krait_aux_write(void *ctx, addr_t off, uint32_t val,
+			    unsigned size)
+{
+	struct krait_clk *c = ctx;
+
+	c->aux = val;
+}
+
+static const struct reg_model_ops krait_aux_ops = {
+	.read = krait_aux_read,
+	.write = krait_aux_write,
+};
+
+static struct krait_clk *krait_cpmr(uint32_t addr)
+{
+	unsigned i;
+
+	if (!krait)
+		return NULL;
+	for (i = 0; i < countof(krait->clk); i++)
+		if (krait->clk[i].cpmr_addr == addr)
+			return &krait->clk[i];
+	return NULL;
+}
+
+uint32_t reg_model_l2_read(uint32_t addr)
+{
+	struct krait_clk *c = krait_cpmr(addr);
+
+	reg_model_advance(reg_model_lat.reg_ns);
+	return c ? c->cpmr : 0;
+}
+
+void reg_model_l2_write(uint32_t addr, uint32_t val)
+{
+	struct krait_clk *c = krait_cpmr(addr);
+	uint32_t old;
+
+	reg_model_advance(reg_model_lat.reg_ns);
+	if (!c)
+		return;
+
+	enter_critical_section();
+	old = c->cpmr;
+	c->cpmr = val;
+	if ((old ^ val) & PRI_SRC_SEL_MASK) {
+		/* the glitch-free mux needs both of its inputs running */
+		if (((old & PRI_SRC_SEL_MASK) == PRI_SRC_SEL_HFPLL ||
+		     krait_on_hfpll(c)) && !krait_hfpll_running(c))
+			krait_violation(krait, c, "switched with its HFPLL off");
+		c->switches++;
+	}
+	exit_critical_section();
+}
+
+unsigned reg_model_krait_violations(void)
+{
+	return krait ? krait->violations : 0;
+}
+
+int reg_model_krait_attach(addr_t clk_ctl, addr_t cpu0_aux, addr_t l2_aux)
+{
+	struct krait *k;
+	unsigned i;
+	int err;
+
+	if (krait)
+		return ERR_ALREADY_EXISTS;
+	k = calloc(1, sizeof(*k));
+	if (!k)
+		return ERR_NO_MEMORY;
+
+	k->clk[0].name = "L2";
+	k->clk[0].cpmr_addr = CPMR_L2;
+	k->clk[1].name = "CPU0";
+	k->clk[1].cpmr_addr = CPMR_CPU0;
+	for (i = 0; i < countof(k->clk); i++) {
+		k->clk[i].cpmr = SEC_SRC_SEL_AUX;
+		k->clk[i].aux = AUX_CLK_SEL_PLL8;
+	}
+
+	err = reg_model_register("gcc", clk_ctl + GCC_WINDOW_OFF, GCC_WINDOW,
+				 &krait_gcc_ops, k);
+	if (!err)
+		err = reg_model_register("aux0", cpu0_aux, 4, &krait_aux_ops,
+					 &k->clk[1]);
+	if (!err)
+		err = reg_model_register("auxl2", l2_aux, 4, &krait_aux_ops,
+					 &k->clk[0]);
+	if (err < 0)
+		return err;	/* blocks already registered still use k */
+
+	krait = k;
+	return NO_ERROR;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __PLATFORM_IOMAP_H
+#define __PLATFORM_IOMAP_H
+
+/*
+ * Where the MSM drivers find their blocks on the emulator.  The storage
+ * addresses are the msm8x60 ones; nand.c and its DMOV use the defaults
+ * in nand.h and dmov.h.  Nothing is there until the models are attached.
+ */
+#define MSM_SDC1_BASE		0x12400000
+
+#define MSM_ADM_BASE		0x18400000
+#define MSM_ADM_SD_OFFSET	0x00020800
+
+/* Krait clocks for acpuclock.c, as apq-touchpad */
+#define CLK_CTL_BASE		0x00900000
+#define MSM_BOOT_PLL8_STATUS	(CLK_CTL_BASE + 0x3158)
+#define MSM_BOOT_PLL_ENABLE_SC0	(CLK_CTL_BASE + 0x34C0)
+
+#define HFPLL_CPU0_BASE		(CLK_CTL_BASE + 0x3200)
+#define HFPLL_L2_BASE		(CLK_CTL_BASE + 0x3300)
+#define HFPLL_MODE(b)		((b) + 0x00)
+#define HFPLL_CONFIG_CTL(b)	((b) + 0x04)
+#define HFPLL_L_VAL(b)		((b) + 0x08)
+#define HFPLL_M_VAL(b)		((b) + 0x0C)
+#define HFPLL_N_VAL(b)		((b) + 0x10)
+#define HFPLL_DROOP_CTL(b)	((b) + 0x14)
+
+#define APCS_CPU0_AUX_CLK_SEL	0x02088014
+#define APCS_L2_AUX_CLK_SEL	0x02011028
+
+#endif
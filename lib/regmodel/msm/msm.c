@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * What mmc.c, adm.c, nand.c and acpuclock.c need from an MSM platform,
+ * on the emulator.  Clocks and GPIOs are not modelled; delays are charged to
+ * the virtual clock rather than spun, so they count in a run's time
+ * the way they would on the part.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <lib/regmodel.h>
+#include <platform/iomap.h>
+#include <platform/adm.h>
+#include <nand.h>
+
+#include "adm.h"
+#include "dmov.h"
+
+/* CRCI - mmc slot mapping, as msm8x60 */
+uint8_t sdc_crci_map[5] = {0, 1, 4, 2, 5};
+
+void clock_init_mmc(uint32_t interface)
+{
+}
+
+void clock_config_mmc(uint32_t interface, uint32_t freq)
+{
+}
+
+void platform_config_interleaved_mode_gpios(void)
+{
+}
+
+void udelay(unsigned usecs)
+{
+	reg_model_advance((uint64_t) usecs * 1000);
+}
+
+void mdelay(unsigned msecs)
+{
+	reg_model_advance((uint64_t) msecs * 1000000);
+}
+
+int reg_model_msm_attach(const char *emmc, const char *nand)
+{
+	int err;
+
+	if (emmc) {
+		err = reg_model_dm_attach("adm", ADM_BASE_ADDR(0, ADM_SD));
+		if (err < 0)
+			return err;
+		err = reg_model_sdcc_attach(MSM_SDC1_BASE, emmc);
+		if (err < 0)
+			return err;
+	}
+	if (nand) {
+		err = reg_model_dm_attach("dmov", DMOV_CMD_PTR(0));
+		if (err < 0)
+			return err;
+		err = reg_model_nand_attach(MSM_NAND_BASE, nand);
+		if (err < 0)
+			return err;
+	}
+	return NO_ERROR;
+}
@@ -0,0 +1,25 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+# the MSM storage drivers and the apq-touchpad Krait clock code, built
+# for the emulator to run against the register models;
+# reg_model_msm_attach() puts the storage models where the drivers look
+
+INCLUDES += \
+	-I$(LOCAL_DIR)/include \
+	-Iplatform/msm_shared/include \
+	-Iplatform/msm_shared
+
+DEFINES += \
+	MMC_BOOT_ADM=1
+
+MODULES += \
+	lib/regmodel
+
+OBJS += \
+	$(LOCAL_DIR)/msm.o \
+	platform/msm_shared/adm.o \
+	platform/msm_shared/iostat.o \
+	platform/msm_shared/mmc.o \
+	platform/msm_shared/nand.o \
+	platform/msm_shared/partition_parser.o \
+	platform/apq-touchpad/acpuclock.o
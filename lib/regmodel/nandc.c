@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * NAND controller with an 8 bit, 2k page SLC ONFI part behind it, as
+ * nand.c drives it through the DMOV: one codeword per EXEC_CMD, the
+ * codeword index restarting when ADDR0 is written.  The image holds
+ * the raw pages, four 528 byte codewords each, the way the controller
+ * lays them out on flash; an erased image is all 0xFF, so a new one
+ * should be created that way or every block reads as bad.
+ *
+ * ECC reads and programs move the 516 data bytes of a codeword and
+ * never see a bit error.  Programming only clears bits, as on flash.
+ * Interleaved (NC01/NC10) operation and BCH codewords are not modelled.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <lib/bio.h>
+
+#include "regmodel_p.h"
+
+#define NANDC_WINDOW		0x800
+
+/* register offsets, as platform/msm_shared/include/nand.h */
+#define NANDC_FLASH_CMD		0x000
+#define NANDC_ADDR0		0x004
+#define NANDC_ADDR1		0x008
+#define NANDC_EXEC_CMD		0x010
+#define NANDC_FLASH_STATUS	0x014
+#define NANDC_BUFFER_STATUS	0x018
+#define NANDC_DEV0_CFG0		0x020
+#define NANDC_READ_ID		0x040
+#define NANDC_DEV_CMD1		0x0A4
+#define NANDC_FLASH_BUFFER	0x100
+
+#define NANDC_BUFFER_SIZE	(NANDC_WINDOW - NANDC_FLASH_BUFFER)
+
+#define NANDC_CMD_PAGE_READ	0x32
+#define NANDC_CMD_PAGE_READ_ECC	0x33
+#define NANDC_CMD_PAGE_READ_ALL	0x34
+#define NANDC_CMD_PRG_PAGE	0x36
+#define NANDC_CMD_PRG_PAGE_ECC	0x37
+#define NANDC_CMD_PRG_PAGE_ALL	0x39
+#define NANDC_CMD_BLOCK_ERASE	0x3A
+#define NANDC_CMD_FETCH_ID	0x0B
+#define NANDC_CMD_STATUS	0x0C
+#define NANDC_CMD_RESET		0x0D
+
+#define NANDC_CFG0_CW(v)	((((v) >> 6) & 7) + 1)
+#define NANDC_CFG0_UD_SIZE(v)	(((v) >> 9) & 0x3FF)
+
+#define NANDC_STAT_OP_ERR	(1 << 4)
+#define NANDC_STAT_READY	(1 << 5)
+#define NANDC_STAT_OP_OK	(1 << 7)	/* program/erase passed */
+
+/* flash */
+#define NAND_CW			528
+#define NAND_CW_DATA		516
+#define NAND_CW_PER_PAGE	4
+#define NAND_PAGE		2048
+#define NAND_SPARE		64
+#define NAND_RAW_PAGE		(NAND_CW * NAND_CW_PER_PAGE)
+#define NAND_PAGES_PER_BLOCK	64
+
+#define NAND_ID			0x1590AA2C
+#define ONFI_ID_ADDR		0x20
+#define ONFI_SIGNATURE		0x49464E4F
+#define ONFI_CMD_READ_PARAM	0xEC
+#define ONFI_PARAM_LEN		256
+
+struct nandc {
+	bdev_t *dev;
+	uint32_t pages;
+
+	uint32_t regs[NANDC_FLASH_BUFFER / 4];
+	uint8_t buf[NANDC_BUFFER_SIZE];
+	uint8_t raw[NAND_RAW_PAGE];
+	unsigned cw;			/* codeword of the current page */
+	uint64_t done_at;
+
+	unsigned reads;
+	unsigned programs;
+	unsigned erases;
+	unsigned failed;
+};
+
+static void onfi_put(uint8_t *p, uint32_t val, unsigned len)
+{
+	while (len--) {
+		*p++ = val;
+		val >>= 8;
+	}
+}
+
+static unsigned onfi_crc16(const uint8_t *p, unsigned len)
+{
+	unsigned crc = 0x4F4E;
+	unsigned i;
+
+	while (len--) {
+		crc ^= *p++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+	}
+	return crc & 0xFFFF;
+}
+
+/* the parameter page, repeated to fill 'len' bytes of the buffer */
+static void nandc_onfi_param(struct nandc *s, unsigned len)
+{
+	uint8_t *p = s->buf;
+	unsigned i;
+
+	memset(p, 0, ONFI_PARAM_LEN);
+	onfi_put(p, ONFI_SIGNATURE, 4);
+	onfi_put(p + 4, 1 << 1, 2);		/* ONFI 1.0 */
+	memcpy(p + 32, "REGMODEL    ", 12);
+	memcpy(p + 44, "LK NAND MODEL       ", 20);
+	p[64] = NAND_ID & 0xFF;
+	onfi_put(p + 80, NAND_PAGE, 4);
+	onfi_put(p + 84, NAND_SPARE, 2);
+	onfi_put(p + 92, NAND_PAGES_PER_BLOCK, 4);
+	onfi_put(p + 96, s->pages / NAND_PAGES_PER_BLOCK, 4);
+	p[100] = 1;				/* LUNs */
+	p[101] = 0x23;				/* address cycles */
+	p[102] = 1;				/* bits per cell */
+	p[112] = 1;				/* ECC bits */
+	onfi_put(p + 129, 0x1F, 2);		/* timing modes 0-4 */
+	onfi_put(p + 133, reg_model_lat.nand_prog_ns / 1000, 2);
+	onfi_put(p + 135, reg_model_lat.nand_erase_ns / 1000, 2);
+	onfi_put(p + 137, reg_model_lat.nand_read_ns / 1000, 2);
+	onfi_put(p + 254, onfi_crc16(p, ONFI_PARAM_LEN - 2), 2);
+
+	for (i = ONFI_PARAM_LEN; i < len; i++)
+		p[i] = p[i % ONFI_PARAM_LEN];
+}
+
+static int nandc_load(struct nandc *s, uint32_t page)
+{
+	if (page >= s->pages)
+		return ERR_INVALID_ARGS;
+	if (bio_read(s->dev, s->raw, (off_t) page * NAND_RAW_PAGE,
+		     NAND_RAW_PAGE) != NAND_RAW_PAGE)
+		return ERR_IO;
+	return 0;
+}
+
+static int nandc_store(struct nandc *s, uint32_t page)
+{
+	if (bio_write(s->dev, s->raw, (off_t) page * NAND_RAW_PAGE,
+		      NAND_RAW_PAGE) != NAND_RAW_PAGE)
+		return ERR_IO;
+	return 0;
+}
+
+/* data bytes and column of the current codeword */
+static unsigned nandc_span(struct nandc *s, unsigned cmd, unsigned *col)
+{
+	unsigned len;
+
+	if (cmd == NANDC_CMD_PAGE_READ_ECC || cmd == NANDC_CMD_PRG_PAGE_ECC) {
+		*col = s->cw * NAND_CW;
+		return NAND_CW_DATA;
+	}
+
+	*col = (s->regs[NANDC_ADDR0 / 4] & 0xFFFF) + s->cw * NAND_CW;
+	len = NANDC_CFG0_UD_SIZE(s->regs[NANDC_DEV0_CFG0 / 4]);
+	len = MIN(len, NANDC_BUFFER_SIZE);
+	if (*col >= NAND_RAW_PAGE)
+		return 0;
+	return MIN(len, NAND_RAW_PAGE - *col);
+}
+
+static int nandc_read(struct nandc *s, unsigned cmd, uint32_t page)
+{
+	unsigned col, len = nandc_span(s, cmd, &col);
+	int err;
+
+	if (cmd == NANDC_CMD_PAGE_READ_ALL &&
+	    (s->regs[NANDC_DEV_CMD1 / 4] & 0xFF) == ONFI_CMD_READ_PARAM) {
+		len = NANDC_CFG0_UD_SIZE(s->regs[NANDC_DEV0_CFG0 / 4]);
+		nandc_onfi_param(s, MIN(len, NANDC_BUFFER_SIZE));
+		s->done_at += reg_model_lat.nand_read_ns;
+		return 0;
+	}
+
+	err = nandc_load(s, page);
+	if (err)
+		return err;
+	memcpy(s->buf, s->raw + col, len);
+
+	/* the array read happens once, the codewords stream out of it */
+	if (!s->cw)
+		s->done_at += reg_model_lat.nand_read_ns;
+	s->done_at += (uint64_t) len * reg_model_lat.nand_byte_ns;
+	s->reads++;
+	return 0;
+}
+
+static int nandc_program(struct nandc *s, unsigned cmd, uint32_t page)
+{
+	unsigned col, len = nandc_span(s, cmd, &col);
+	unsigned i;
+	int err;
+
+	err = nandc_load(s, page);
+	if (err)
+		return err;
+	for (i = 0; i < len; i++)
+		s->raw[col + i] &= s->buf[i];
+	err = nandc_store(s, page);
+	if (err)
+		return err;
+
+	s->done_at += (uint64_t) len * reg_model_lat.nand_byte_ns;
+	if (s->cw + 1 == NANDC_CFG0_CW(s->regs[NANDC_DEV0_CFG0 / 4])) {
+		s->done_at += reg_model_lat.nand_prog_ns;
+		s->programs++;
+	}
+	return 0;
+}
+
+static int nandc_erase(struct nandc *s, uint32_t page)
+{
+	unsigned i;
+	int err;
+
+	if (page % NAND_PAGES_PER_BLOCK || page >= s->pages)
+		return ERR_INVALID_ARGS;
+
+	memset(s->raw, 0xFF, NAND_RAW_PAGE);
+	for (i = 0; i < NAND_PAGES_PER_BLOCK; i++) {
+		err = nandc_store(s, page + i);
+		if (err)
+			return err;
+	}
+	s->done_at += reg_model_lat.nand_erase_ns;
+	s->erases++;
+	return 0;
+}
+
+/* run one codeword of the command; its status is valid at done_at */
+static void nandc_exec(struct nandc *s)
+{
+	unsigned cmd = s->regs[NANDC_FLASH_CMD / 4];
+	uint32_t addr0 = s->regs[NANDC_ADDR0 / 4];
+	uint32_t page = (addr0 >> 16) | (s->regs[NANDC_ADDR1 / 4] & 0xFF) << 16;
+	uint32_t status = NANDC_STAT_READY;
+	int err = 0;
+
+	/* one operation at a time; the time it takes is added to done_at */
+	s->done_at = MAX(s->done_at, reg_model_now());
+
+	switch (cmd) {
+	case NANDC_CMD_PAGE_READ:
+	case NANDC_CMD_PAGE_READ_ECC:
+	case NANDC_CMD_PAGE_READ_ALL:
+		err = nandc_read(s, cmd, page);
+		break;
+	case NANDC_CMD_PRG_PAGE:
+	case NANDC_CMD_PRG_PAGE_ECC:
+	case NANDC_CMD_PRG_PAGE_ALL:
+		err = nandc_program(s, cmd, page);
+		status |= NANDC_STAT_OP_OK;
+		break;
+	case NANDC_CMD_BLOCK_ERASE:
+		/* the row address goes in ADDR0 as is */
+		err = nandc_erase(s, addr0);
+		status |= NANDC_STAT_OP_OK;
+		break;
+	case NANDC_CMD_FETCH_ID:
+		s->regs[NANDC_READ_ID / 4] = (addr0 & 0xFF) == ONFI_ID_ADDR ?
+					     ONFI_SIGNATURE : NAND_ID;
+		break;
+	case NANDC_CMD_STATUS:
+	case NANDC_CMD_RESET:
+		break;
+	default:
+		dprintf(CRITICAL, "regmodel: nand: command 0x%x not "
+			"modelled\n", cmd);
+		err = ERR_NOT_SUPPORTED;
+		break;
+	}
+
+	if (err) {
+		s->failed++;
+		status = NANDC_STAT_READY | NANDC_STAT_OP_ERR;
+	}
+	s->regs[NANDC_FLASH_STATUS / 4] = status;
+	s->regs[NANDC_BUFFER_STATUS / 4] = 0;
+	s->cw++;
+}
+
+static uint32_t nandc_read_reg(void *ctx, addr_t off, unsigned size)
+{
+	struct nandc *s = ctx;
+	uint32_t val;
+
+	if (off >= NANDC_FLASH_BUFFER) {
+		off -= NANDC_FLASH_BUFFER;
+		val = 0;
+		memcpy(&val, s->buf + off, MIN(size, NANDC_BUFFER_SIZE - off));
+		return val;
+	}
+
+	switch (off) {
+	case NANDC_FLASH_STATUS:
+	case NANDC_BUFFER_STATUS:
+		/* the CRCI holds the data mover until the codeword is done */
+		reg_model_wait(s->done_at);
+		break;
+	}
+	return s->regs[off / 4];
+}
+
+static void nandc_write_reg(void *ctx, addr_t off, uint32_t val,
+			    unsigned size)
+{
+	struct nandc *s = ctx;
+
+	if (off >= NANDC_FLASH_BUFFER) {
+		off -= NANDC_FLASH_BUFFER;
+		memcpy(s->buf + off, &val, MIN(size, NANDC_BUFFER_SIZE - off));
+		return;
+	}
+
+	switch (off) {
+	case NANDC_EXEC_CMD:
+		if (val & 1)
+			nandc_exec(s);
+		break;
+	case NANDC_ADDR0:
+		s->regs[off / 4] = val;
+		s->cw = 0;
+		break;
+	case NANDC_READ_ID:
+	case NANDC_BUFFER_STATUS:
+		break;
+	default:
+		/* FLASH_STATUS and READ_STATUS are cleared the same way */
+		s->regs[off / 4] = val;
+		break;
+	}
+}
+
+static void nandc_dump(void *ctx)
+{
+	struct nandc *s = ctx;
+
+	printf("       %u codewords read, %u pages programmed, "
+		"%u blocks erased, %u failed\n", s->reads, s->programs,
+		s->erases, s->failed);
+}
+
+static void nandc_reset(void *ctx)
+{
+	struct nandc *s = ctx;
+
+	s->reads = 0;
+	s->programs = 0;
+	s->erases = 0;
+	s->failed = 0;
+	s->done_at = 0;
+}
+
+static const struct reg_model_ops nandc_ops = {
+	.read = nandc_read_reg,
+	.write = nandc_write_reg,
+	.dump = nandc_dump,
+	.reset = nandc_reset,
+};
+
+int reg_model_nand_attach(addr_t base, const char *bdev)
+{
+	struct nandc *s;
+	int err;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return ERR_NO_MEMORY;
+
+	s->dev = bio_open(bdev);
+	if (!s->dev) {
+		dprintf(CRITICAL, "regmodel: no block device %s\n", bdev);
+		free(s);
+		return ERR_NOT_FOUND;
+	}
+	s->pages = s->dev->size / NAND_RAW_PAGE;
+	s->pages -= s->pages % NAND_PAGES_PER_BLOCK;
+	s->regs[NANDC_FLASH_STATUS / 4] = NANDC_STAT_READY;
+
+	err = reg_model_register("nand", base, NANDC_WINDOW, &nandc_ops, s);
+	if (err < 0) {
+		bio_close(s->dev);
+		free(s);
+		return err;
+	}
+	dprintf(INFO, "regmodel: NAND on %s, %u blocks\n", bdev,
+		s->pages / NAND_PAGES_PER_BLOCK);
+	return NO_ERROR;
+}
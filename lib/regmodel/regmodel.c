@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <debug.h>
+#include <err.h>
+#include <string.h>
+#include <reg.h>
+#include <kernel/thread.h>
+
+#include "regmodel_p.h"
+
+#define REG_MODEL_MAX_BLOCKS	8
+
+/* roughly an eMMC 4.4 part on a 4 bit 50 MHz bus and an SLC NAND part */
+struct reg_model_latency reg_model_lat = {
+	.reg_ns		= 100,
+	.dm_setup_ns	= 1000,
+	.dm_cmd_ns	= 200,
+	.dm_word_ns	= 20,
+	.mmc_cmd_ns	= 2000,
+	.mmc_access_ns	= 100000,
+	.mmc_byte_ns	= 40,
+	.mmc_prog_ns	= 30000,
+	.nand_read_ns	= 25000,
+	.nand_prog_ns	= 200000,
+	.nand_erase_ns	= 2000000,
+	.nand_byte_ns	= 25,
+};
+
+struct reg_model_block {
+	const char *name;
+	addr_t base;
+	size_t size;
+	const struct reg_model_ops *ops;
+	void *ctx;
+	unsigned reads;
+	unsigned writes;
+};
+
+static struct reg_model_block blocks[REG_MODEL_MAX_BLOCKS];
+static unsigned block_count;
+
+static uint64_t now;
+static uint64_t stalled;	/* ns the CPU spent polling busy devices */
+static uint64_t forked_stalled;
+
+int reg_model_register(const char *name, addr_t base, size_t size,
+		       const struct reg_model_ops *ops, void *ctx)
+{
+	struct reg_model_block *b;
+	unsigned i;
+
+	for (i = 0; i < block_count; i++) {
+		b = &blocks[i];
+		if (base < b->base + b->size && b->base < base + size) {
+			dprintf(CRITICAL, "regmodel: %s overlaps %s\n", name,
+				b->name);
+			return ERR_ALREADY_EXISTS;
+		}
+	}
+	if (block_count == REG_MODEL_MAX_BLOCKS)
+		return ERR_NO_MEMORY;
+
+	enter_critical_section();
+	b = &blocks[block_count];
+	b->name = name;
+	b->base = base;
+	b->size = size;
+	b->ops = ops;
+	b->ctx = ctx;
+	b->reads = 0;
+	b->writes = 0;
+	block_count++;
+	exit_critical_section();
+
+	dprintf(INFO, "regmodel: %s at 0x%08lx\n", name, base);
+	return NO_ERROR;
+}
+
+static struct reg_model_block *reg_model_find(addr_t addr)
+{
+	unsigned i;
+
+	for (i = 0; i < block_count; i++)
+		if (addr - blocks[i].base < blocks[i].size)
+			return &blocks[i];
+	return NULL;
+}
+
+int reg_model_claimed(addr_t addr)
+{
+	return reg_model_find(addr) != NULL;
+}
+
+static uint32_t reg_model_read(struct reg_model_block *b, addr_t addr,
+			       unsigned size)
+{
+	uint32_t val;
+
+	enter_critical_section();
+	b->reads++;
+	val = b->ops->read(b->ctx, addr - b->base, size);
+	exit_critical_section();
+	return val;
+}
+
+static void reg_model_write(struct reg_model_block *b, addr_t addr,
+			    uint32_t val, unsigned size)
+{
+	enter_critical_section();
+	b->writes++;
+	b->ops->write(b->ctx, addr - b->base, val, size);
+	exit_critical_section();
+}
+
+uint32_t reg_model_readl(addr_t addr)
+{
+	struct reg_model_block *b = reg_model_find(addr);
+
+	if (!b)
+		return *REG32(addr);
+	now += reg_model_lat.reg_ns;
+	return reg_model_read(b, addr, 4);
+}
+
+void reg_model_writel(uint32_t val, addr_t addr)
+{
+	struct reg_model_block *b = reg_model_find(addr);
+
+	if (!b) {
+		*REG32(addr) = val;
+		return;
+	}
+	now += reg_model_lat.reg_ns;
+	reg_model_write(b, addr, val, 4);
+}
+
+uint8_t reg_model_readb(addr_t addr)
+{
+	struct reg_model_block *b = reg_model_find(addr);
+
+	if (!b)
+		return *REG8(addr);
+	now += reg_model_lat.reg_ns;
+	return reg_model_read(b, addr, 1);
+}
+
+void reg_model_writeb(uint8_t val, addr_t addr)
+{
+	struct reg_model_block *b = reg_model_find(addr);
+
+	if (!b) {
+		*REG8(addr) = val;
+		return;
+	}
+	now += reg_model_lat.reg_ns;
+	reg_model_write(b, addr, val, 1);
+}
+
+uint32_t reg_model_dm_read(addr_t addr)
+{
+	struct reg_model_block *b = reg_model_find(addr);
+
+	return b ? reg_model_read(b, addr, 4) : *REG32(addr);
+}
+
+void reg_model_dm_write(uint32_t val, addr_t addr)
+{
+	struct reg_model_block *b = reg_model_find(addr);
+
+	if (b)
+		reg_model_write(b, addr, val, 4);
+	else
+		*REG32(addr) = val;
+}
+
+uint64_t reg_model_now(void)
+{
+	return now;
+}
+
+void reg_model_advance(uint64_t ns)
+{
+	now += ns;
+}
+
+void reg_model_wait(uint64_t until)
+{
+	if (until > now) {
+		stalled += until - now;
+		now = until;
+	}
+}
+
+uint64_t reg_model_fork(void)
+{
+	forked_stalled = stalled;
+	return now;
+}
+
+void reg_model_join(uint64_t cpu)
+{
+	now = cpu;
+	stalled = forked_stalled;
+}
+
+#if WITH_LIB_CONSOLE
+
+#include <lib/console.h>
+
+#define LAT(field)	{ #field, &reg_model_lat.field }
+
+static const struct {
+	const char *name;
+	unsigned *val;
+} lat_table[] = {
+	LAT(reg_ns),
+	LAT(dm_setup_ns),
+	LAT(dm_cmd_ns),
+	LAT(dm_word_ns),
+	LAT(mmc_cmd_ns),
+	LAT(mmc_access_ns),
+	LAT(mmc_byte_ns),
+	LAT(mmc_prog_ns),
+	LAT(nand_read_ns),
+	LAT(nand_prog_ns),
+	LAT(nand_erase_ns),
+	LAT(nand_byte_ns),
+};
+
+static int cmd_regmodel(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+	{ "regmodel", "storage register models", &cmd_regmodel },
+STATIC_COMMAND_END(regmodel);
+
+static void regmodel_usage(void)
+{
+	printf("usage: regmodel stat | reset\n");
+	printf("       regmodel lat [name [ns]]\n");
+	printf("       regmodel attach sdcc|nand <base> <bdev>\n");
+	printf("       regmodel attach adm|dmov <base>\n");
+}
+
+static int regmodel_attach(int argc, const cmd_args *argv)
+{
+	const char *kind = argv[2].str;
+	addr_t base = argv[3].u;
+
+	if (!strcmp(kind, "adm") || !strcmp(kind, "dmov"))
+		return reg_model_dm_attach(!strcmp(kind, "adm") ?
+					   "adm" : "dmov", base);
+	if (argc < 5) {
+		regmodel_usage();
+		return ERR_INVALID_ARGS;
+	}
+	if (!strcmp(kind, "sdcc"))
+		return reg_model_sdcc_attach(base, argv[4].str);
+	if (!strcmp(kind, "nand"))
+		return reg_model_nand_attach(base, argv[4].str);
+
+	regmodel_usage();
+	return ERR_INVALID_ARGS;
+}
+
+static int cmd_regmodel(int argc, const cmd_args *argv)
+{
+	struct reg_model_block *b;
+	unsigned i;
+
+	if (argc < 2) {
+		regmodel_usage();
+		return 0;
+	}
+
+	if (!strcmp(argv[1].str, "stat")) {
+		printf("virtual time %llu us, %llu us polling busy devices\n",
+			now / 1000, stalled / 1000);
+		for (i = 0; i < block_count; i++) {
+			b = &blocks[i];
+			printf("%-6s 0x%08lx: %u reads, %u writes\n", b->name,
+				b->base, b->reads, b->writes);
+			if (b->ops->dump)
+				b->ops->dump(b->ctx);
+		}
+	} else if (!strcmp(argv[1].str, "reset")) {
+		enter_critical_section();
+		now = 0;
+		stalled = 0;
+		for (i = 0; i < block_count; i++) {
+			b = &blocks[i];
+			b->reads = 0;
+			b->writes = 0;
+			if (b->ops->reset)
+				b->ops->reset(b->ctx);
+		}
+		exit_critical_section();
+	} else if (!strcmp(argv[1].str, "lat")) {
+		for (i = 0; i < countof(lat_table); i++) {
+			if (argc > 2 && strcmp(argv[2].str, lat_table[i].name))
+				continue;
+			if (argc > 3)
+				*lat_table[i].val = argv[3].u;
+			printf("%-14s %u\n", lat_table[i].name,
+				*lat_table[i].val);
+		}
+	} else if (!strcmp(argv[1].str, "attach") && argc > 3) {
+		return regmodel_attach(argc, argv);
+	} else {
+		regmodel_usage();
+		return ERR_INVALID_ARGS;
+	}
+
+	return 0;
+}
+
+#endif
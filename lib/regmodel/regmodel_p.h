@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __REGMODEL_P_H
+#define __REGMODEL_P_H
+
+#include <lib/regmodel.h>
+
+/* accesses by the data mover: charged by the mover, not as CPU accesses */
+uint32_t reg_model_dm_read(addr_t addr);
+void reg_model_dm_write(uint32_t val, addr_t addr);
+int reg_model_claimed(addr_t addr);
+
+/*
+ * A data mover runs on its own timeline: fork returns the CPU's time
+ * and lets the mover's work advance the clock, join goes back to it.
+ */
+uint64_t reg_model_fork(void);
+void reg_model_join(uint64_t cpu);
+
+#endif
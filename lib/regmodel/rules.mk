@@ -0,0 +1,13 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+DEFINES += WITH_REG_MODEL=1
+
+MODULES += \
+	lib/bio
+
+OBJS += \
+	$(LOCAL_DIR)/dm.o \
+	$(LOCAL_DIR)/krait.o \
+	$(LOCAL_DIR)/nandc.o \
+	$(LOCAL_DIR)/regmodel.o \
+	$(LOCAL_DIR)/sdcc.o
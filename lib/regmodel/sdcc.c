@@ -0,0 +1,667 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * SDCC (MCI) host controller with a sector mode eMMC card behind it,
+ * enough for the init, read and write paths of mmc.c in PIO and ADM
+ * mode.  The card answers CMD0/1/2/3/6/7/8/9/12/13/16/17/18/23/24/25;
+ * anything else gets no response, as an illegal command would.
+ *
+ * The data path moves whole blocks between the image and a block
+ * buffer behind the FIFO window.  A read block is available one access
+ * time plus its bus time after the read command, later blocks follow
+ * at the bus rate; reading the FIFO ahead of that waits.  Written
+ * blocks go to the image as they fill and keep the card busy for the
+ * program time, which CMD12/CMD13 with PROG_ENA then wait out.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <lib/bio.h>
+
+#include "regmodel_p.h"
+
+#define SDCC_WINDOW		0x100
+
+/* register offsets, as platform/msm_shared/include/mmc.h */
+#define SDCC_POWER		0x000
+#define SDCC_CLK		0x004
+#define SDCC_ARGUMENT		0x008
+#define SDCC_CMD		0x00C
+#define SDCC_RESP_CMD		0x010
+#define SDCC_RESP_0		0x014
+#define SDCC_RESP_3		0x020
+#define SDCC_DATA_TIMER		0x024
+#define SDCC_DATA_LENGTH	0x028
+#define SDCC_DATA_CTL		0x02C
+#define SDCC_DATA_COUNT		0x030
+#define SDCC_STATUS		0x034
+#define SDCC_CLEAR		0x038
+#define SDCC_FIFO_COUNT		0x044
+#define SDCC_FIFO		0x080
+#define SDCC_FIFO_END		0x0C0
+
+#define SDCC_CMD_INDEX(v)	((v) & 0x3F)
+#define SDCC_CMD_RESPONSE	(1 << 6)
+#define SDCC_CMD_LONGRSP	(1 << 7)
+#define SDCC_CMD_ENABLE		(1 << 10)
+#define SDCC_CMD_PROG_ENA	(1 << 11)
+
+#define SDCC_DATA_ENABLE	(1 << 0)
+#define SDCC_DATA_DIR		(1 << 1)	/* card to host */
+#define SDCC_DATA_DM_ENABLE	(1 << 3)
+
+#define SDCC_STAT_CMD_TIMEOUT	(1 << 2)
+#define SDCC_STAT_CMD_RESP_END	(1 << 6)
+#define SDCC_STAT_CMD_SENT	(1 << 7)
+#define SDCC_STAT_DATA_END	(1 << 8)
+#define SDCC_STAT_DATA_BLK_END	(1 << 10)
+#define SDCC_STAT_TX_ACTIVE	(1 << 12)
+#define SDCC_STAT_RX_ACTIVE	(1 << 13)
+#define SDCC_STAT_TX_FIFO_HFULL	(1 << 14)	/* half empty, really */
+#define SDCC_STAT_RX_FIFO_HFULL	(1 << 15)
+#define SDCC_STAT_TX_FIFO_EMPTY	(1 << 18)
+#define SDCC_STAT_RX_FIFO_EMPTY	(1 << 19)
+#define SDCC_STAT_RX_DATA_AVLBL	(1 << 21)
+#define SDCC_STAT_PROG_DONE	(1 << 23)
+#define SDCC_STAT_STATIC	0x01C007FF
+
+#define SDCC_HFIFO_BYTES	32
+
+/* card */
+#define MMC_BLOCK		512
+#define MMC_OCR			0xC0FF8080	/* ready, sector mode, 2.7-3.6V */
+
+#define MMC_STATE_IDLE		0
+#define MMC_STATE_READY		1
+#define MMC_STATE_IDENT		2
+#define MMC_STATE_STBY		3
+#define MMC_STATE_TRAN		4
+#define MMC_STATE_DATA		5
+#define MMC_STATE_RCV		6
+#define MMC_STATE_PRG		7
+
+#define MMC_R1_READY_FOR_DATA	(1 << 8)
+#define MMC_R1_BLOCK_LEN_ERR	(1 << 29)
+#define MMC_R1_ADDR_ERR		(1 << 30)
+#define MMC_R1_OUT_OF_RANGE	(1U << 31)
+
+#define EXT_CSD_BUS_WIDTH	183
+#define EXT_CSD_HS_TIMING	185
+#define EXT_CSD_REV		192
+#define EXT_CSD_CARD_TYPE	196
+#define EXT_CSD_SEC_COUNT	212
+#define EXT_CSD_HC_WP_GRP_SIZE	221
+#define EXT_CSD_HC_ERASE_GRP	224
+
+enum sdcc_xfer {
+	XFER_NONE,
+	XFER_EXT_CSD,
+	XFER_READ,
+	XFER_WRITE,
+};
+
+struct sdcc {
+	bdev_t *dev;
+	uint32_t sectors;
+
+	/* host */
+	uint32_t regs[SDCC_WINDOW / 4];
+	uint32_t status;		/* static bits */
+	uint64_t cmd_done_at;
+
+	/* card */
+	unsigned state;
+	unsigned rca;
+	unsigned block_count;		/* from CMD23, 0 if open ended */
+	uint64_t busy_until;		/* programming */
+	int prog_wait;			/* PROG_DONE owed to the host */
+	uint8_t ext_csd[MMC_BLOCK];
+	uint32_t cid[4];
+	uint32_t csd[4];
+
+	/* data path */
+	enum sdcc_xfer xfer;
+	int data_enabled;
+	uint32_t sector;		/* next block */
+	unsigned len;			/* bytes the host asked for */
+	unsigned done;			/* bytes through the FIFO */
+	unsigned pos;			/* in buf */
+	int loaded;
+	uint64_t next_at;		/* bus free for the next block */
+	uint64_t ready_at;		/* read block in buf available */
+	uint8_t buf[MMC_BLOCK];
+
+	unsigned cmds;
+	unsigned errors;
+	unsigned blocks_read;
+	unsigned blocks_written;
+	unsigned fifo_words;
+};
+
+/* set 'len' bits at 'start' of a register laid out as mmc.c unpacks it */
+static void sdcc_bits(uint32_t *r, unsigned start, unsigned len, uint32_t val)
+{
+	unsigned i;
+
+	for (i = 0; i < len; i++, start++) {
+		r[start / 32] &= ~(1U << (start % 32));
+		r[start / 32] |= ((val >> i) & 1) << (start % 32);
+	}
+}
+
+static void sdcc_card_init(struct sdcc *s)
+{
+	uint32_t *cid = s->cid, *csd = s->csd;
+	const char *name = "REGMDL";
+	unsigned i;
+
+	/* CID: MID, OID, product name, revision, serial */
+	sdcc_bits(cid, 120, 8, 0x15);
+	sdcc_bits(cid, 104, 8, 0x00);
+	for (i = 0; i < 6; i++)
+		sdcc_bits(cid, 96 - i * 8, 8, name[i]);
+	sdcc_bits(cid, 48, 8, 0x10);
+	sdcc_bits(cid, 16, 32, 0x00000001);
+	sdcc_bits(cid, 0, 1, 1);
+
+	/* CSD: capacity comes from EXT_CSD (C_SIZE 0xFFF), 512 byte blocks */
+	sdcc_bits(csd, 126, 2, 3);
+	sdcc_bits(csd, 122, 4, 4);
+	sdcc_bits(csd, 112, 8, 0x27);		/* TAAC 1.5 ms */
+	sdcc_bits(csd, 96, 8, 0x32);		/* 26 MHz */
+	sdcc_bits(csd, 84, 12, 0x0F5);
+	sdcc_bits(csd, 80, 4, 9);
+	sdcc_bits(csd, 62, 12, 0xFFF);
+	sdcc_bits(csd, 47, 3, 7);
+	sdcc_bits(csd, 26, 3, 2);
+	sdcc_bits(csd, 22, 4, 9);
+	sdcc_bits(csd, 0, 1, 1);
+
+	memset(s->ext_csd, 0, sizeof(s->ext_csd));
+	s->ext_csd[EXT_CSD_REV] = 5;
+	s->ext_csd[EXT_CSD_CARD_TYPE] = 0x03;	/* 26 and 52 MHz */
+	s->ext_csd[EXT_CSD_HC_WP_GRP_SIZE] = 1;
+	s->ext_csd[EXT_CSD_HC_ERASE_GRP] = 1;
+	for (i = 0; i < 4; i++)
+		s->ext_csd[EXT_CSD_SEC_COUNT + i] = s->sectors >> (i * 8);
+
+	s->state = MMC_STATE_IDLE;
+}
+
+static uint64_t sdcc_block_ns(void)
+{
+	return (uint64_t) MMC_BLOCK * reg_model_lat.mmc_byte_ns;
+}
+
+/* the card is done programming by now */
+static void sdcc_settle(struct sdcc *s)
+{
+	if (s->state == MMC_STATE_PRG && reg_model_now() >= s->busy_until)
+		s->state = MMC_STATE_TRAN;
+}
+
+static uint32_t sdcc_r1(struct sdcc *s, uint32_t err)
+{
+	return err | (s->state << 9) |
+	       (s->state == MMC_STATE_PRG ? 0 : MMC_R1_READY_FOR_DATA);
+}
+
+static void sdcc_data_end(struct sdcc *s)
+{
+	s->status |= SDCC_STAT_DATA_END | SDCC_STAT_DATA_BLK_END;
+	s->data_enabled = 0;
+
+	if (s->xfer == XFER_WRITE) {
+		/* single block and CMD23 writes end by themselves */
+		if (s->block_count || s->len <= MMC_BLOCK)
+			s->state = MMC_STATE_PRG;
+	} else if (s->xfer != XFER_READ || s->block_count) {
+		s->state = MMC_STATE_TRAN;
+	}
+	if (s->xfer != XFER_READ || s->block_count)
+		s->xfer = XFER_NONE;
+	s->block_count = 0;
+}
+
+/* fill the block buffer for a read */
+static void sdcc_load(struct sdcc *s)
+{
+	uint64_t start = MAX(reg_model_now(), s->next_at);
+
+	if (s->xfer == XFER_EXT_CSD) {
+		memcpy(s->buf, s->ext_csd, MMC_BLOCK);
+	} else {
+		if (bio_read(s->dev, s->buf, (off_t) s->sector * MMC_BLOCK,
+			     MMC_BLOCK) != MMC_BLOCK)
+			memset(s->buf, 0, MMC_BLOCK);
+		s->sector++;
+		s->blocks_read++;
+	}
+	s->ready_at = start + sdcc_block_ns();
+	s->next_at = s->ready_at;
+	s->loaded = 1;
+	s->pos = 0;
+}
+
+/* a full write block goes to the image and keeps the card busy */
+static void sdcc_store(struct sdcc *s)
+{
+	uint64_t received = MAX(reg_model_now(), s->next_at) + sdcc_block_ns();
+
+	if (s->sector < s->sectors)
+		bio_write(s->dev, s->buf, (off_t) s->sector * MMC_BLOCK,
+			  MMC_BLOCK);
+	s->sector++;
+	s->blocks_written++;
+	s->next_at = received;
+	s->busy_until = MAX(s->busy_until, received) + reg_model_lat.mmc_prog_ns;
+	s->pos = 0;
+}
+
+static uint32_t sdcc_fifo_read(struct sdcc *s)
+{
+	uint32_t w;
+
+	if (s->xfer != XFER_READ && s->xfer != XFER_EXT_CSD)
+		return 0;
+	if (!s->data_enabled || s->done >= s->len)
+		return 0;
+
+	if (!s->loaded)
+		sdcc_load(s);
+	reg_model_wait(s->ready_at);
+
+	memcpy(&w, s->buf + s->pos, 4);
+	s->pos += 4;
+	s->done += 4;
+	s->fifo_words++;
+	if (s->pos == MMC_BLOCK)
+		s->loaded = 0;
+	if (s->done == s->len)
+		sdcc_data_end(s);
+	return w;
+}
+
+static void sdcc_fifo_write(struct sdcc *s, uint32_t w)
+{
+	if (s->xfer != XFER_WRITE || !s->data_enabled || s->done >= s->len)
+		return;
+
+	memcpy(s->buf + s->pos, &w, 4);
+	s->pos += 4;
+	s->done += 4;
+	s->fifo_words++;
+	if (s->pos == MMC_BLOCK)
+		sdcc_store(s);
+	if (s->done == s->len)
+		sdcc_data_end(s);
+}
+
+/* the data phase needs both the command and DATA_CTL */
+static void sdcc_data_start(struct sdcc *s)
+{
+	uint32_t ctl = s->regs[SDCC_DATA_CTL / 4];
+
+	if (s->xfer == XFER_NONE || !(ctl & SDCC_DATA_ENABLE) ||
+	    s->data_enabled)
+		return;
+
+	s->data_enabled = 1;
+	s->len = s->regs[SDCC_DATA_LENGTH / 4];
+	s->done = 0;
+	s->pos = 0;
+	s->loaded = 0;
+	s->next_at = reg_model_now();
+	if (s->xfer != XFER_WRITE)
+		s->next_at += reg_model_lat.mmc_access_ns;
+	if (!s->len)
+		sdcc_data_end(s);
+}
+
+static void sdcc_resp_long(struct sdcc *s, const uint32_t *r)
+{
+	unsigned i;
+
+	/* RESP0 holds bits 127:96 */
+	for (i = 0; i < 4; i++)
+		s->regs[SDCC_RESP_0 / 4 + i] = r[3 - i];
+	s->regs[SDCC_RESP_CMD / 4] = 0x3F;
+}
+
+/* 0 and the response in RESP0..3, or no response from the card */
+static int sdcc_card_cmd(struct sdcc *s, unsigned idx, uint32_t arg,
+			 uint32_t cmd)
+{
+	uint32_t *resp = &s->regs[SDCC_RESP_0 / 4];
+	unsigned count;
+
+	sdcc_settle(s);
+	s->regs[SDCC_RESP_CMD / 4] = idx;
+
+	switch (idx) {
+	case 0:
+		sdcc_card_init(s);
+		s->xfer = XFER_NONE;
+		s->data_enabled = 0;
+		return 0;
+
+	case 1:
+		if (s->state != MMC_STATE_IDLE && s->state != MMC_STATE_READY)
+			return ERR_INVALID_ARGS;
+		*resp = MMC_OCR;
+		s->regs[SDCC_RESP_CMD / 4] = 0x3F;
+		s->state = MMC_STATE_READY;
+		return 0;
+
+	case 2:
+		if (s->state != MMC_STATE_READY)
+			return ERR_INVALID_ARGS;
+		sdcc_resp_long(s, s->cid);
+		s->state = MMC_STATE_IDENT;
+		return 0;
+
+	case 3:
+		if (s->state != MMC_STATE_IDENT)
+			return ERR_INVALID_ARGS;
+		*resp = sdcc_r1(s, 0);
+		s->rca = arg >> 16;
+		s->state = MMC_STATE_STBY;
+		return 0;
+
+	case 6:
+		if (s->state != MMC_STATE_TRAN)
+			return ERR_INVALID_ARGS;
+		*resp = sdcc_r1(s, 0);
+		switch ((arg >> 24) & 3) {
+		case 1:
+			s->ext_csd[(arg >> 16) & 0xFF] |= arg >> 8;
+			break;
+		case 2:
+			s->ext_csd[(arg >> 16) & 0xFF] &= ~(arg >> 8);
+			break;
+		case 3:
+			s->ext_csd[(arg >> 16) & 0xFF] = arg >> 8;
+			break;
+		}
+		return 0;
+
+	case 7:
+		if ((arg >> 16) != s->rca || !s->rca) {
+			if (s->state == MMC_STATE_TRAN)
+				s->state = MMC_STATE_STBY;
+			return 0;
+		}
+		if (s->state != MMC_STATE_STBY)
+			return ERR_INVALID_ARGS;
+		*resp = sdcc_r1(s, 0);
+		s->state = MMC_STATE_TRAN;
+		return 0;
+
+	case 8:
+		/* SEND_EXT_CSD; an SD probe in idle state gets nothing */
+		if (s->state != MMC_STATE_TRAN)
+			return ERR_INVALID_ARGS;
+		*resp = sdcc_r1(s, 0);
+		s->state = MMC_STATE_DATA;
+		s->xfer = XFER_EXT_CSD;
+		s->block_count = 1;
+		sdcc_data_start(s);
+		return 0;
+
+	case 9:
+		if (s->state != MMC_STATE_STBY || (arg >> 16) != s->rca)
+			return ERR_INVALID_ARGS;
+		sdcc_resp_long(s, s->csd);
+		return 0;
+
+	case 12:
+		*resp = sdcc_r1(s, 0);
+		if (s->state == MMC_STATE_RCV)
+			s->state = MMC_STATE_PRG;
+		else if (s->state == MMC_STATE_DATA)
+			s->state = MMC_STATE_TRAN;
+		s->xfer = XFER_NONE;
+		s->data_enabled = 0;
+		s->block_count = 0;
+		break;
+
+	case 13:
+		if ((arg >> 16) != s->rca)
+			return ERR_INVALID_ARGS;
+		*resp = sdcc_r1(s, 0);
+		break;
+
+	case 16:
+		*resp = sdcc_r1(s, arg == MMC_BLOCK ? 0 : MMC_R1_BLOCK_LEN_ERR);
+		return 0;
+
+	case 17:
+	case 18:
+	case 24:
+	case 25:
+		if (s->state != MMC_STATE_TRAN)
+			return ERR_INVALID_ARGS;
+		count = (idx == 17 || idx == 24) ? 1 :
+			(s->block_count ? s->block_count : 1);
+		if (arg >= s->sectors || count > s->sectors - arg) {
+			*resp = sdcc_r1(s, MMC_R1_OUT_OF_RANGE |
+					MMC_R1_ADDR_ERR);
+			s->block_count = 0;
+			return 0;
+		}
+		*resp = sdcc_r1(s, 0);
+		if (idx == 17 || idx == 24)
+			s->block_count = 1;
+		s->sector = arg;
+		if (idx < 24) {
+			s->xfer = XFER_READ;
+			s->state = MMC_STATE_DATA;
+		} else {
+			s->xfer = XFER_WRITE;
+			s->state = MMC_STATE_RCV;
+		}
+		sdcc_data_start(s);
+		return 0;
+
+	case 23:
+		if (s->state != MMC_STATE_TRAN)
+			return ERR_INVALID_ARGS;
+		*resp = sdcc_r1(s, 0);
+		s->block_count = arg & 0xFFFF;
+		return 0;
+
+	default:
+		return ERR_NOT_SUPPORTED;
+	}
+
+	/* CMD12 and CMD13 with PROG_ENA report the end of programming */
+	if (cmd & SDCC_CMD_PROG_ENA)
+		s->prog_wait = 1;
+	return 0;
+}
+
+static void sdcc_cmd(struct sdcc *s, uint32_t cmd)
+{
+	unsigned idx = SDCC_CMD_INDEX(cmd);
+	int err;
+
+	if (!(cmd & SDCC_CMD_ENABLE))
+		return;
+
+	s->cmds++;
+	s->cmd_done_at = reg_model_now() + reg_model_lat.mmc_cmd_ns;
+	err = sdcc_card_cmd(s, idx, s->regs[SDCC_ARGUMENT / 4], cmd);
+	if (err) {
+		s->errors++;
+		s->status |= SDCC_STAT_CMD_TIMEOUT;
+	} else if (cmd & SDCC_CMD_RESPONSE) {
+		s->status |= SDCC_STAT_CMD_RESP_END;
+	} else {
+		s->status |= SDCC_STAT_CMD_SENT;
+	}
+}
+
+static uint32_t sdcc_status(struct sdcc *s)
+{
+	uint32_t st;
+	unsigned left;
+
+	/* the driver spins on CMD_ACTIVE; skip to the response */
+	reg_model_wait(s->cmd_done_at);
+
+	if (s->prog_wait) {
+		reg_model_wait(s->busy_until);
+		sdcc_settle(s);
+		s->status |= SDCC_STAT_PROG_DONE;
+		s->prog_wait = 0;
+	}
+
+	st = s->status;
+	if (!s->data_enabled)
+		return st | SDCC_STAT_TX_FIFO_EMPTY | SDCC_STAT_RX_FIFO_EMPTY;
+
+	left = s->len - s->done;
+	if (s->xfer == XFER_WRITE) {
+		st |= SDCC_STAT_TX_ACTIVE | SDCC_STAT_TX_FIFO_HFULL;
+	} else {
+		st |= SDCC_STAT_RX_ACTIVE | SDCC_STAT_RX_DATA_AVLBL;
+		if (left >= SDCC_HFIFO_BYTES)
+			st |= SDCC_STAT_RX_FIFO_HFULL;
+	}
+	return st;
+}
+
+static uint32_t sdcc_read(void *ctx, addr_t off, unsigned size)
+{
+	struct sdcc *s = ctx;
+
+	if (off >= SDCC_FIFO && off < SDCC_FIFO_END)
+		return sdcc_fifo_read(s);
+
+	switch (off) {
+	case SDCC_STATUS:
+		return sdcc_status(s);
+	case SDCC_DATA_COUNT:
+		return s->data_enabled ? s->len - s->done : 0;
+	case SDCC_FIFO_COUNT:
+		return s->data_enabled ? (s->len - s->done) / 4 : 0;
+	default:
+		return s->regs[(off & (SDCC_WINDOW - 1)) / 4];
+	}
+}
+
+static void sdcc_write(void *ctx, addr_t off, uint32_t val, unsigned size)
+{
+	struct sdcc *s = ctx;
+
+	if (off >= SDCC_FIFO && off < SDCC_FIFO_END) {
+		sdcc_fifo_write(s, val);
+		return;
+	}
+
+	switch (off) {
+	case SDCC_CMD:
+		s->regs[SDCC_CMD / 4] = val;
+		sdcc_cmd(s, val);
+		break;
+	case SDCC_CLEAR:
+		s->status &= ~(val & SDCC_STAT_STATIC);
+		break;
+	case SDCC_DATA_CTL:
+		s->regs[SDCC_DATA_CTL / 4] = val;
+		if (val & SDCC_DATA_ENABLE)
+			sdcc_data_start(s);
+		else
+			s->data_enabled = 0;
+		break;
+	case SDCC_RESP_CMD:
+	case SDCC_STATUS:
+		break;
+	default:
+		s->regs[(off & (SDCC_WINDOW - 1)) / 4] = val;
+		break;
+	}
+}
+
+static void sdcc_dump(void *ctx)
+{
+	struct sdcc *s = ctx;
+
+	printf("       %u commands, %u unanswered, %u blocks read, "
+		"%u written, %u FIFO words\n", s->cmds, s->errors,
+		s->blocks_read, s->blocks_written, s->fifo_words);
+}
+
+static void sdcc_reset(void *ctx)
+{
+	struct sdcc *s = ctx;
+
+	s->cmds = 0;
+	s->errors = 0;
+	s->blocks_read = 0;
+	s->blocks_written = 0;
+	s->fifo_words = 0;
+	s->cmd_done_at = 0;
+	s->busy_until = 0;
+	s->next_at = 0;
+	s->ready_at = 0;
+}
+
+static const struct reg_model_ops sdcc_ops = {
+	.read = sdcc_read,
+	.write = sdcc_write,
+	.dump = sdcc_dump,
+	.reset = sdcc_reset,
+};
+
+int reg_model_sdcc_attach(addr_t base, const char *bdev)
+{
+	struct sdcc *s;
+	int err;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return ERR_NO_MEMORY;
+
+	s->dev = bio_open(bdev);
+	if (!s->dev) {
+		dprintf(CRITICAL, "regmodel: no block device %s\n", bdev);
+		free(s);
+		return ERR_NOT_FOUND;
+	}
+	s->sectors = s->dev->size / MMC_BLOCK;
+	sdcc_card_init(s);
+
+	err = reg_model_register("sdcc", base, SDCC_WINDOW, &sdcc_ops, s);
+	if (err < 0) {
+		bio_close(s->dev);
+		free(s);
+		return err;
+	}
+	dprintf(INFO, "regmodel: eMMC on %s, %u sectors\n", bdev, s->sectors);
+	return NO_ERROR;
+}
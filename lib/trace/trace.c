@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <debug.h>
+#include <string.h>
+#include <arch/ops.h>
+#include <kernel/thread.h>
+#include <platform.h>
+#include <lib/trace.h>
+
+/*
+ * Nothing here may be instrumented, and the hooks call nothing that
+ * could be (string functions included): only the cycle counter and
+ * atomic_add, both in assembly.
+ */
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS		8192	/* 128 KB */
+#endif
+
+/* slots are picked modulo the size with a counter that may wrap */
+#if TRACE_EVENTS & (TRACE_EVENTS - 1)
+#error TRACE_EVENTS must be a power of two
+#endif
+
+static struct trace_event ring[TRACE_EVENTS];
+static volatile int head;	/* events ever reserved since the start */
+static volatile int recording = 1;
+static int wrap;
+
+static struct trace_thread threads[TRACE_MAX_THREADS];
+static thread_t *thread_ptr[TRACE_MAX_THREADS];
+static volatile unsigned thread_count;
+
+static uint32_t cycles_per_ms;
+static int cycles_timed;
+
+static __NO_TRACE unsigned trace_thread(thread_t *t)
+{
+	unsigned i, n;
+
+	for (i = 0; i < thread_count; i++)
+		if (thread_ptr[i] == t)
+			return i;
+
+	/* new threads are rare; interrupts may trace while we add one */
+	enter_critical_section();
+	for (i = 0; i < thread_count; i++)
+		if (thread_ptr[i] == t)
+			break;
+	if (i == thread_count && i < TRACE_MAX_THREADS) {
+		for (n = 0; n < sizeof(threads[i].name) - 1 && t->name[n]; n++)
+			threads[i].name[n] = t->name[n];
+		threads[i].name[n] = 0;
+		thread_ptr[i] = t;
+		thread_count = i + 1;
+	}
+	exit_critical_section();
+
+	return (i < TRACE_MAX_THREADS) ? i : TRACE_THREAD_NONE;
+}
+
+static __NO_TRACE void trace_event(void *fn, void *site, unsigned type)
+{
+	struct trace_event *e;
+	uint32_t cycles = arch_cycle_count();
+	unsigned n;
+
+	if (!recording || !current_thread)
+		return;
+
+	/* the slot is ours once reserved, whoever interrupts us */
+	n = atomic_add(&head, 1);
+	if (n >= TRACE_EVENTS && !wrap)
+		return;
+
+	e = &ring[n % TRACE_EVENTS];
+	e->cycles = cycles;
+	e->fn = (uint32_t) fn;
+	e->site = (uint32_t) site;
+	e->thread = trace_thread(current_thread);
+	e->type = type;
+}
+
+__NO_TRACE void __cyg_profile_func_enter(void *fn, void *site)
+{
+	trace_event(fn, site, TRACE_EVENT_ENTER);
+}
+
+__NO_TRACE void __cyg_profile_func_exit(void *fn, void *site)
+{
+	trace_event(fn, site, TRACE_EVENT_EXIT);
+}
+
+void __NO_TRACE trace_start(int w)
+{
+	recording = 0;
+	head = 0;
+	thread_count = 0;
+	wrap = w;
+	recording = 1;
+}
+
+void __NO_TRACE trace_stop(void)
+{
+	recording = 0;
+}
+
+int __NO_TRACE trace_running(void)
+{
+	return recording;
+}
+
+static __NO_TRACE unsigned trace_event_count(void)
+{
+	return ((unsigned) head < TRACE_EVENTS) ? (unsigned) head : TRACE_EVENTS;
+}
+
+/* the cycle counter rate, timed against the kernel tick */
+static __NO_TRACE uint32_t trace_cycles_per_ms(void)
+{
+	time_t t0, t;
+	uint32_t c0;
+
+	if (cycles_timed)
+		return cycles_per_ms;
+
+	t0 = current_time();
+	while ((t = current_time()) == t0)
+		;
+	c0 = arch_cycle_count();
+	while (current_time() - t < 100)
+		;
+	cycles_per_ms = (arch_cycle_count() - c0) / (current_time() - t);
+	cycles_timed = 1;
+	return cycles_per_ms;
+}
+
+unsigned __NO_TRACE trace_dump_size(void)
+{
+	return sizeof(struct trace_header) +
+	       thread_count * sizeof(threads[0]) +
+	       trace_event_count() * sizeof(ring[0]);
+}
+
+void __NO_TRACE trace_dump_read(void *buf, unsigned offset, unsigned len)
+{
+	struct trace_header hdr;
+	unsigned count = trace_event_count();
+	unsigned first = (unsigned) head - count;
+	unsigned char *out = buf;
+	unsigned i, n, skip, pos;
+	const struct {
+		const void *base;
+		unsigned size;
+	} part[] = {
+		{ &hdr, sizeof(hdr) },
+		{ threads, thread_count * sizeof(threads[0]) },
+	};
+
+	hdr.magic = TRACE_MAGIC;
+	hdr.version = TRACE_VERSION;
+	hdr.thread_count = thread_count;
+	hdr.event_count = count;
+	hdr.lost = head - count;
+	hdr.cycles_per_ms = trace_cycles_per_ms();
+
+	for (i = 0; i < countof(part) && len; i++) {
+		if (offset >= part[i].size) {
+			offset -= part[i].size;
+			continue;
+		}
+		n = part[i].size - offset;
+		if (n > len)
+			n = len;
+		memcpy(out, (const unsigned char *) part[i].base + offset, n);
+		out += n;
+		len -= n;
+		offset = 0;
+	}
+
+	/* events, oldest first: a wrapped ring starts at head */
+	while (len && offset < count * sizeof(ring[0])) {
+		pos = offset / sizeof(ring[0]);
+		skip = offset % sizeof(ring[0]);
+		n = sizeof(ring[0]) - skip;
+		if (n > len)
+			n = len;
+		memcpy(out, (const unsigned char *)
+		       &ring[(first + pos) % TRACE_EVENTS] + skip, n);
+		out += n;
+		len -= n;
+		offset += n;
+	}
+}
+
+#if WITH_LIB_CONSOLE
+
+#include <lib/console.h>
+
+static int cmd_trace(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+	{ "trace", "function entry/exit tracing", &cmd_trace },
+STATIC_COMMAND_END(trace);
+
+static __NO_TRACE int cmd_trace(int argc, const cmd_args *argv)
+{
+	struct trace_event *e;
+	unsigned count, first, i;
+
+	if (argc < 2) {
+		printf("usage: trace start [wrap] | stop | dump\n");
+		printf("%s, %d events, %u threads\n",
+			recording ? "recording" : "stopped", head, thread_count);
+		return 0;
+	}
+
+	if (!strcmp(argv[1].str, "start")) {
+		trace_start(argc > 2 && !strcmp(argv[2].str, "wrap"));
+	} else if (!strcmp(argv[1].str, "stop")) {
+		trace_stop();
+		printf("%u events kept of %d\n", trace_event_count(), head);
+	} else if (!strcmp(argv[1].str, "dump")) {
+		/* same records as the binary dump, for scripts/lktrace */
+		trace_stop();
+		count = trace_event_count();
+		first = (unsigned) head - count;
+		printf("trc-header %u %u %u\n", count, head - count,
+			trace_cycles_per_ms());
+		for (i = 0; i < thread_count; i++)
+			printf("trc-thread %u %s\n", i, threads[i].name);
+		for (i = 0; i < count; i++) {
+			e = &ring[(first + i) % TRACE_EVENTS];
+			printf("trc %08x %u %08x %08x %u\n", e->cycles, e->type,
+				e->fn, e->site, e->thread);
+		}
+	} else {
+		printf("unrecognized command\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+#endif
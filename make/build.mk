@@ -39,5 +39,13 @@ $(OUTPUT_TZ_BIN): $(INPUT_TZ_BIN)
 	$(NOECHO)$(OBJCOPY) -I binary -B arm -O elf32-littlearm $(INPUT_TZ_BIN) $(OUTPUT_TZ_BIN)
 endif
 
+# modules whose calls are logged by lib/trace, e.g.
+#   make msm8960 TRACE_MODULES="platform/msm_shared dev/usb"
+ifneq ($(TRACE_MODULES),)
+$(foreach m,$(TRACE_MODULES),\
+	$(eval $(BUILDDIR)/$(m)/%.o: CFLAGS += -finstrument-functions)\
+	$(eval $(BUILDDIR)/$(m)/%.Ao: CFLAGS += -finstrument-functions))
+endif
+
 include arch/$(ARCH)/compile.mk
 
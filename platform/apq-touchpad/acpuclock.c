@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor
+ *     the names of its contributors may be used to endorse or promote
+ *     products derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Krait CPU0 and L2 clocks.  Each has a primary mux choosing between
+ * its own HFPLL and a secondary mux, which the previous stage leaves
+ * on PLL8 through the aux source.  acpu_clock_init() moves CPU0 and L2
+ * onto their HFPLLs for the bootloader's own work, and
+ * acpu_clock_restore() puts the muxes and PLLs back as they were
+ * before the kernel's acpuclock driver takes over.
+ */
+
+#include <reg.h>
+#include <debug.h>
+#include <platform/iomap.h>
+#include <platform/clock.h>
+#include <platform/timer.h>
+
+/* Mux selects in the L2 indirect CPMR registers */
+#define PRI_SRC_SEL_MASK	0x3
+#define PRI_SRC_SEL_SEC_SRC	0
+#define PRI_SRC_SEL_HFPLL	1
+#define SEC_SRC_SEL_MASK	(0x3 << 2)
+#define SEC_SRC_SEL_AUX		(2 << 2)
+
+#define AUX_CLK_SEL_PLL8	3
+
+/* HFPLL_MODE bits */
+#define HFPLL_OUTCTRL		(1 << 0)
+#define HFPLL_BYPASSNL		(1 << 1)
+#define HFPLL_RESET_N		(1 << 2)
+
+#define PXO_KHZ			27000
+
+struct krait_clk {
+	const char *name;
+	uint32_t hfpll;		/* HFPLL register base */
+	uint32_t cpmr;		/* L2 indirect address of the mux */
+	uint32_t aux_sel;	/* secondary mux aux source select */
+	uint32_t l_val;
+
+	/* as found, for acpu_clock_restore() */
+	int boosted;
+	uint32_t saved_cpmr;
+	uint32_t saved_aux;
+	uint32_t saved_mode;
+	uint32_t saved_config;
+	uint32_t saved_droop;
+	uint32_t saved_l;
+	uint32_t saved_m;
+	uint32_t saved_n;
+};
+
+/* L2 first: the CPU should not outrun its cache */
+static struct krait_clk krait_clks[] = {
+	{
+		.name = "L2",
+		.hfpll = HFPLL_L2_BASE,
+		.cpmr = 0x0500,
+		.aux_sel = APCS_L2_AUX_CLK_SEL,
+		.l_val = L2_BOOT_L_VAL,
+	},
+	{
+		.name = "CPU0",
+		.hfpll = HFPLL_CPU0_BASE,
+		.cpmr = 0x4501,
+		.aux_sel = APCS_CPU0_AUX_CLK_SEL,
+		.l_val = ACPU_BOOT_L_VAL,
+	},
+};
+
+#if WITH_REG_MODEL
+/* on the emulator the CPMR registers are lib/regmodel's Krait model */
+#include <lib/regmodel.h>
+#define get_l2_indirect_reg	reg_model_l2_read
+#define set_l2_indirect_reg	reg_model_l2_write
+#else
+static uint32_t get_l2_indirect_reg(uint32_t addr)
+{
+	uint32_t val;
+
+	__asm__ volatile("mcr	p15, 3, %1, c15, c0, 6\n"
+			 "isb\n"
+			 "mrc	p15, 3, %0, c15, c0, 7\n"
+			 : "=r" (val) : "r" (addr));
+	return val;
+}
+
+static void set_l2_indirect_reg(uint32_t addr, uint32_t val)
+{
+	__asm__ volatile("dsb\n"
+			 "mcr	p15, 3, %0, c15, c0, 6\n"
+			 "isb\n"
+			 "mcr	p15, 3, %1, c15, c0, 7\n"
+			 "isb\n"
+			 :: "r" (addr), "r" (val));
+}
+#endif
+
+static void krait_set_mux(struct krait_clk *k, uint32_t mask, uint32_t sel)
+{
+	uint32_t val = get_l2_indirect_reg(k->cpmr);
+
+	val &= ~mask;
+	val |= sel;
+	set_l2_indirect_reg(k->cpmr, val);
+
+	/* Let the glitch-free mux finish switching */
+	udelay(1);
+}
+
+static void hfpll_disable(uint32_t base)
+{
+	/* Output off, bypass on, held in reset */
+	writel(0, HFPLL_MODE(base));
+}
+
+static void hfpll_enable(uint32_t base)
+{
+	/* Bypass off, then out of reset 10us later */
+	writel(HFPLL_BYPASSNL, HFPLL_MODE(base));
+	udelay(10);
+	writel(HFPLL_BYPASSNL | HFPLL_RESET_N, HFPLL_MODE(base));
+
+	/* Lock time is at most 60us; there is no lock status to poll */
+	udelay(60);
+	writel(HFPLL_BYPASSNL | HFPLL_RESET_N | HFPLL_OUTCTRL, HFPLL_MODE(base));
+}
+
+/* Park on PLL8 through the secondary mux */
+static void krait_to_aux(struct krait_clk *k)
+{
+	writel(AUX_CLK_SEL_PLL8, k->aux_sel);
+	krait_set_mux(k, SEC_SRC_SEL_MASK, SEC_SRC_SEL_AUX);
+	krait_set_mux(k, PRI_SRC_SEL_MASK, PRI_SRC_SEL_SEC_SRC);
+}
+
+static void krait_boost(struct krait_clk *k)
+{
+	k->saved_cpmr = get_l2_indirect_reg(k->cpmr);
+	k->saved_aux = readl(k->aux_sel);
+	k->saved_mode = readl(HFPLL_MODE(k->hfpll));
+	k->saved_config = readl(HFPLL_CONFIG_CTL(k->hfpll));
+	k->saved_droop = readl(HFPLL_DROOP_CTL(k->hfpll));
+	k->saved_l = readl(HFPLL_L_VAL(k->hfpll));
+	k->saved_m = readl(HFPLL_M_VAL(k->hfpll));
+	k->saved_n = readl(HFPLL_N_VAL(k->hfpll));
+
+	/* The HFPLL may be what we are running from */
+	krait_to_aux(k);
+
+	hfpll_disable(k->hfpll);
+	writel(HFPLL_CONFIG_VAL, HFPLL_CONFIG_CTL(k->hfpll));
+	writel(HFPLL_DROOP_VAL, HFPLL_DROOP_CTL(k->hfpll));
+	writel(0, HFPLL_M_VAL(k->hfpll));
+	writel(1, HFPLL_N_VAL(k->hfpll));
+	writel(k->l_val, HFPLL_L_VAL(k->hfpll));
+	hfpll_enable(k->hfpll);
+
+	krait_set_mux(k, PRI_SRC_SEL_MASK, PRI_SRC_SEL_HFPLL);
+	k->boosted = 1;
+}
+
+static void krait_restore(struct krait_clk *k)
+{
+	if (!k->boosted)
+		return;
+
+	krait_to_aux(k);
+	hfpll_disable(k->hfpll);
+
+	/* Bring the HFPLL back as it was set up, running if it was */
+	writel(k->saved_config, HFPLL_CONFIG_CTL(k->hfpll));
+	writel(k->saved_droop, HFPLL_DROOP_CTL(k->hfpll));
+	writel(k->saved_m, HFPLL_M_VAL(k->hfpll));
+	writel(k->saved_n, HFPLL_N_VAL(k->hfpll));
+	writel(k->saved_l, HFPLL_L_VAL(k->hfpll));
+	if (k->saved_mode & HFPLL_OUTCTRL)
+		hfpll_enable(k->hfpll);
+
+	writel(k->saved_aux, k->aux_sel);
+	set_l2_indirect_reg(k->cpmr, k->saved_cpmr);
+	udelay(1);
+	k->boosted = 0;
+}
+
+static void pll8_vote(void)
+{
+	writel(readl(MSM_BOOT_PLL_ENABLE_SC0) | (1 << 8), MSM_BOOT_PLL_ENABLE_SC0);
+	while (!(readl(MSM_BOOT_PLL8_STATUS) & (1 << 16)));
+}
+
+void acpu_clock_init(void)
+{
+	unsigned i;
+
+	/* The aux source has to be running before anything parks on it */
+	pll8_vote();
+
+	for (i = 0; i < ARRAY_SIZE(krait_clks); i++) {
+		krait_boost(&krait_clks[i]);
+		dprintf(INFO, "%s: %u MHz\n", krait_clks[i].name,
+			krait_clks[i].l_val * PXO_KHZ / 1000);
+	}
+}
+
+/* Back to the state the kernel expects, CPU0 before L2 */
+void acpu_clock_restore(void)
+{
+	unsigned i = ARRAY_SIZE(krait_clks);
+
+	while (i--)
+		krait_restore(&krait_clks[i]);
+}
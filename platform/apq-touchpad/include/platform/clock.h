@@ -46,4 +46,19 @@
 #define SDC_CLK_NS_48MHZ           0x00FE005B
 #define SDC_CLK_MD_48MHZ           0x000100FD
 
+/* Krait HFPLL setup; rate is PXO (27 MHz) * L */
+#define HFPLL_CONFIG_VAL           0x7845C665
+#define HFPLL_DROOP_VAL            0x0108C000
+
+/* Boot rates, within the voltage the previous stage leaves us at */
+#ifndef ACPU_BOOT_L_VAL
+#define ACPU_BOOT_L_VAL            0x1A        /* 702 MHz */
+#endif
+#ifndef L2_BOOT_L_VAL
+#define L2_BOOT_L_VAL              0x14        /* 540 MHz */
+#endif
+
+void acpu_clock_init(void);
+void acpu_clock_restore(void);
+
 #endif
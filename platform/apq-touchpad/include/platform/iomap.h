@@ -62,6 +62,20 @@
 #define MSM_BOOT_PLL8_STATUS    (CLK_CTL_BASE + 0x3158)
 #define MSM_BOOT_PLL_ENABLE_SC0 (CLK_CTL_BASE + 0x34C0)
 
+/* Krait CPU0 and L2 HFPLLs */
+#define HFPLL_CPU0_BASE         (CLK_CTL_BASE + 0x3200)
+#define HFPLL_L2_BASE           (CLK_CTL_BASE + 0x3300)
+#define HFPLL_MODE(b)           ((b) + 0x00)
+#define HFPLL_CONFIG_CTL(b)     ((b) + 0x04)
+#define HFPLL_L_VAL(b)          ((b) + 0x08)
+#define HFPLL_M_VAL(b)          ((b) + 0x0C)
+#define HFPLL_N_VAL(b)          ((b) + 0x10)
+#define HFPLL_DROOP_CTL(b)      ((b) + 0x14)
+
+/* Secondary mux aux source selects */
+#define APCS_CPU0_AUX_CLK_SEL    0x02088014
+#define APCS_L2_AUX_CLK_SEL      0x02011028
+
 /* GIC */
 #define MSM_GIC_DIST_BASE        0x02080000
 #define MSM_GIC_CPU_BASE         0x02081000
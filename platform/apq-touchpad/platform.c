@@ -37,6 +37,7 @@
 #include <qgic.h>
 #include <arch/arm/mmu.h>
 #include <dev/fbcon.h>
+#include <platform/clock.h>
 
 extern void platform_init_timer(void);
 extern uint8_t target_uart_gsbi(void);
@@ -68,11 +69,19 @@ void platform_early_init(void)
 #endif
 	qgic_init();
 	platform_init_timer();
+	acpu_clock_init();
 }
 
 void platform_init(void)
 {
 	dprintf(INFO, "platform_init()\n");
+	uart_init_irq();
+}
+
+void platform_uninit(void)
+{
+	uart_flush_tx(0);
+	acpu_clock_restore();
 }
 
 /* Setup memory for this platform */
@@ -14,6 +14,7 @@ MODULES += dev/fbcon
 OBJS += \
 	$(LOCAL_DIR)/platform.o \
 	$(LOCAL_DIR)/clock.o \
+	$(LOCAL_DIR)/acpuclock.o \
 	$(LOCAL_DIR)/gpio.o \
 
 LINKER_SCRIPT += $(BUILDDIR)/system-onesegment.ld
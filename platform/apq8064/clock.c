@@ -86,13 +86,13 @@ void hsusb_clock_init(void)
 void clock_config_uart_dm(uint8_t id)
 {
 	/* Enable gsbi_uart_clk */
-	clock_config(UART_DM_CLK_NS_115200,
-				 UART_DM_CLK_MD_115200,
+	clock_config(UART_DM_CLK_NS,
+				 UART_DM_CLK_MD,
 				 GSBIn_QUP_APPS_NS(id),
 				 GSBIn_QUP_APPS_MD(id));
 
 	/* Configure clock selection register for tx and rx rates.
-	 * Selecting 115.2k for both RX and TX.
+	 * Same rate (UART_DM_BAUD) for both RX and TX.
 	 */
 	writel(UART_DM_CLK_RX_TX_BIT_RATE, MSM_BOOT_UART_DM_CSR(id));
 
@@ -48,6 +48,8 @@
 
 #define GSBI_QUP_IRQ(id)        ((id) <= 8 ? (GIC_SPI_START + 145 + 2*(id)) : \
                                              (GIC_SPI_START + 187 + 2*((id)-8)))
+#define GSBI_UART_IRQ(id)       ((id) <= 8 ? (GIC_SPI_START + 144 + 2*(id)) : \
+                                             (GIC_SPI_START + 186 + 2*((id)-8)))
 
 
 /* Retrofit universal macro names */
@@ -70,6 +70,12 @@ void platform_early_init(void)
 void platform_init(void)
 {
 	dprintf(INFO, "platform_init()\n");
+	uart_init_irq();
+}
+
+void platform_uninit(void)
+{
+	uart_flush_tx(0);
 }
 
 /* Setup memory for this platform */
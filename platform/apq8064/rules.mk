@@ -6,6 +6,10 @@ CPU      := generic
 
 DEFINES  += ARM_CPU_CORE_KRAIT
 
+# 115200 or 460800
+UART_DM_BAUD ?= 115200
+DEFINES  += UART_DM_BAUD=$(UART_DM_BAUD)
+
 INCLUDES += -I$(LOCAL_DIR)/include -I$(LK_TOP_DIR)/platform/msm_shared/include
 
 DEVS += fbcon
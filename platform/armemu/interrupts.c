@@ -30,6 +30,9 @@
 #include <arch/ops.h>
 #include <arch/arm.h>
 #include "platform_p.h"
+#if WITH_LIB_PROFILE
+#include <lib/profile.h>
+#endif
 
 struct int_handler_struct {
 	int_handler handler;
@@ -89,6 +92,10 @@ enum handler_return platform_irq(struct arm_iframe *frame)
 	enum handler_return ret; 
 
 	ret = INT_NO_RESCHEDULE;
+#if WITH_LIB_PROFILE
+	if (vector == INT_PIT)
+		profile_sample(frame->pc, frame->spsr & MODE_MASK);
+#endif
 	if (int_handler_table[vector].handler)
 		ret = int_handler_table[vector].handler(int_handler_table[vector].arg);
 
@@ -19,6 +19,11 @@ OBJS += \
 	$(LOCAL_DIR)/display.o \
 
 
+ifeq ($(WITH_UDC_LOOPBACK),1)
+OBJS += \
+	$(LOCAL_DIR)/udc.o
+endif
+
 #	$(LOCAL_DIR)/console.o \
 	$(LOCAL_DIR)/net.o \
 
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor
+ *       the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Loopback stand-in for a USB device controller.  The udc_* API is
+ * carried over the emulator's network device as raw ethernet frames of
+ * type UDC_LOOP_ETHERTYPE, so gadgets such as fastboot run unchanged and
+ * a host script on the other end of the tap interface plays the part
+ * of the USB host (see scripts/fbloop).
+ *
+ * Every frame carries a 4 byte header after the ethernet header:
+ *   ept    endpoint number, bit 7 set for IN (device to host)
+ *   flags  UDC_LOOP_*
+ *   len    payload bytes (request size for READY), little endian
+ * The host only sends OUT data after the device has announced a queued
+ * request with a READY frame, which stands in for USB flow control and
+ * keeps the emulator's receive ring from overflowing.
+ */
+
+#include <debug.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <reg.h>
+#include <dev/udc.h>
+#include <kernel/thread.h>
+#include <platform/interrupts.h>
+#include <platform/armemu.h>
+
+#define UDC_LOOP_ETHERTYPE	0x88b5
+#define UDC_LOOP_HDR		18	/* ethernet header + loop header */
+#define UDC_LOOP_PKT		1024	/* payload bytes per frame */
+
+#define UDC_LOOP_END		0x01	/* last frame of a transfer */
+#define UDC_LOOP_READY		0x02	/* device: OUT request queued for len */
+#define UDC_LOOP_ONLINE		0x04	/* host: connected */
+#define UDC_LOOP_OFFLINE	0x08	/* host: disconnected */
+
+struct udc_endpoint {
+	struct udc_endpoint *next;
+	unsigned num;
+	unsigned in;
+	unsigned maxpkt;
+	struct udc_request *req;
+	unsigned actual;
+};
+
+static struct udc_endpoint *ept_list;
+static unsigned ept_count;
+static struct udc_gadget *the_gadget;
+static unsigned online;
+
+static unsigned char host_mac[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+static const unsigned char dev_mac[6] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05 };
+
+/* field goes in the header len word */
+static void loop_send(unsigned ept, unsigned flags, unsigned field,
+		      const void *data, unsigned len)
+{
+	const unsigned char *src = data;
+	unsigned i;
+
+	for (i = 0; i < 6; i++) {
+		*REG8(NET_OUT_BUF + i) = host_mac[i];
+		*REG8(NET_OUT_BUF + 6 + i) = dev_mac[i];
+	}
+	*REG8(NET_OUT_BUF + 12) = UDC_LOOP_ETHERTYPE >> 8;
+	*REG8(NET_OUT_BUF + 13) = UDC_LOOP_ETHERTYPE & 0xff;
+	*REG8(NET_OUT_BUF + 14) = ept;
+	*REG8(NET_OUT_BUF + 15) = flags;
+	*REG8(NET_OUT_BUF + 16) = field & 0xff;
+	*REG8(NET_OUT_BUF + 17) = (field >> 8) & 0xff;
+	for (i = 0; i < len; i++)
+		*REG8(NET_OUT_BUF + UDC_LOOP_HDR + i) = src[i];
+
+	*REG(NET_SEND_LEN) = UDC_LOOP_HDR + len;
+	*REG(NET_SEND) = 1;
+}
+
+static struct udc_endpoint *loop_find_ept(unsigned num, unsigned in)
+{
+	struct udc_endpoint *ept;
+
+	for (ept = ept_list; ept; ept = ept->next)
+		if (ept->num == num && ept->in == in)
+			return ept;
+	return 0;
+}
+
+static void loop_complete(struct udc_endpoint *ept, int status)
+{
+	struct udc_request *req = ept->req;
+
+	ept->req = 0;
+	if (req && req->complete)
+		req->complete(req, ept->actual, status);
+}
+
+static void loop_notify(unsigned event)
+{
+	struct udc_endpoint *ept;
+
+	online = (event == UDC_EVENT_ONLINE);
+	if (!online)
+		for (ept = ept_list; ept; ept = ept->next)
+			if (ept->req)
+				loop_complete(ept, -1);
+	if (the_gadget && the_gadget->notify)
+		the_gadget->notify(the_gadget, event);
+}
+
+/*
+ * Drain the receive ring.  Data for an endpoint with no request queued
+ * is left in the ring until one is, just as the controller would NAK.
+ * Returns 1 if a request completed.
+ */
+static int loop_rx(void)
+{
+	struct udc_endpoint *ept;
+	unsigned char *dst;
+	unsigned tail, len, flags, n, i;
+	int done = 0;
+
+	while ((tail = *REG(NET_TAIL)) != *REG(NET_HEAD)) {
+		len = *REG(NET_IN_BUF_LEN);
+		if (len < UDC_LOOP_HDR ||
+		    *REG8(NET_IN_BUF + 12) != (UDC_LOOP_ETHERTYPE >> 8) ||
+		    *REG8(NET_IN_BUF + 13) != (UDC_LOOP_ETHERTYPE & 0xff))
+			goto next;
+
+		flags = *REG8(NET_IN_BUF + 15);
+		n = *REG8(NET_IN_BUF + 16) | (*REG8(NET_IN_BUF + 17) << 8);
+		if (n > len - UDC_LOOP_HDR)
+			goto next;
+
+		if (flags & (UDC_LOOP_ONLINE | UDC_LOOP_OFFLINE)) {
+			for (i = 0; i < 6; i++)
+				host_mac[i] = *REG8(NET_IN_BUF + 6 + i);
+			loop_notify((flags & UDC_LOOP_ONLINE) ?
+				    UDC_EVENT_ONLINE : UDC_EVENT_OFFLINE);
+			done = 1;
+			goto next;
+		}
+
+		ept = loop_find_ept(*REG8(NET_IN_BUF + 14), 0);
+		if (!ept)
+			goto next;
+		if (!ept->req)
+			break;
+
+		if (n > ept->req->length - ept->actual) {
+			dprintf(INFO, "udc: ept%d overrun by %d bytes\n",
+				ept->num, n - (ept->req->length - ept->actual));
+			n = ept->req->length - ept->actual;
+		}
+		dst = (unsigned char *) ept->req->buf + ept->actual;
+		for (i = 0; i < n; i++)
+			dst[i] = *REG8(NET_IN_BUF + UDC_LOOP_HDR + i);
+		ept->actual += n;
+
+		if ((flags & UDC_LOOP_END) || ept->actual == ept->req->length) {
+			loop_complete(ept, 0);
+			done = 1;
+		}
+next:
+		*REG(NET_TAIL) = (tail + 1) % NET_IN_BUF_COUNT;
+	}
+	return done;
+}
+
+static enum handler_return loop_irq(void *arg)
+{
+	return loop_rx() ? INT_RESCHEDULE : INT_NO_RESCHEDULE;
+}
+
+struct udc_request *udc_request_alloc(void)
+{
+	struct udc_request *req;
+
+	req = malloc(sizeof(*req));
+	if (req) {
+		req->buf = 0;
+		req->length = 0;
+	}
+	return req;
+}
+
+void udc_request_free(struct udc_request *req)
+{
+	free(req);
+}
+
+int udc_request_queue(struct udc_endpoint *ept, struct udc_request *req)
+{
+	unsigned char *buf = req->buf;
+	unsigned left, n;
+
+	enter_critical_section();
+	if (!online || ept->req) {
+		exit_critical_section();
+		return -1;
+	}
+	ept->req = req;
+	ept->actual = 0;
+
+	if (!ept->in) {
+		loop_send(ept->num, UDC_LOOP_READY, req->length, 0, 0);
+		loop_rx();
+		exit_critical_section();
+		return 0;
+	}
+
+	/* IN transfers go straight out; the host end never NAKs */
+	left = req->length;
+	do {
+		n = MIN(left, UDC_LOOP_PKT);
+		loop_send(ept->num | 0x80, (n == left) ? UDC_LOOP_END : 0, n,
+			  buf + ept->actual, n);
+		ept->actual += n;
+		left -= n;
+	} while (left);
+	loop_complete(ept, 0);
+	exit_critical_section();
+	return 0;
+}
+
+int udc_request_cancel(struct udc_endpoint *ept, struct udc_request *req)
+{
+	enter_critical_section();
+	if (ept->req == req)
+		loop_complete(ept, -1);
+	exit_critical_section();
+	return 0;
+}
+
+struct udc_endpoint *udc_endpoint_alloc(unsigned type, unsigned maxpkt)
+{
+	struct udc_endpoint *ept;
+
+	if (type != UDC_TYPE_BULK_IN && type != UDC_TYPE_BULK_OUT)
+		return 0;
+
+	ept = malloc(sizeof(*ept));
+	if (!ept)
+		return 0;
+	ept->num = ++ept_count;
+	ept->in = (type == UDC_TYPE_BULK_IN);
+	ept->maxpkt = maxpkt;
+	ept->req = 0;
+	ept->actual = 0;
+	ept->next = ept_list;
+	ept_list = ept;
+	return ept;
+}
+
+void udc_endpoint_free(struct udc_endpoint *ept)
+{
+	/* todo */
+}
+
+int udc_init(struct udc_device *devinfo)
+{
+	if ((*REG32(SYSINFO_FEATURES) & SYSINFO_FEATURE_NETWORK) == 0) {
+		dprintf(CRITICAL, "udc: emulator has no network device\n");
+		return -1;
+	}
+	return 0;
+}
+
+int udc_register_gadget(struct udc_gadget *gadget)
+{
+	if (the_gadget) {
+		dprintf(CRITICAL, "only one gadget supported\n");
+		return -1;
+	}
+	the_gadget = gadget;
+	return 0;
+}
+
+int udc_start(void)
+{
+	register_int_handler(INT_NET, loop_irq, 0);
+	unmask_interrupt(INT_NET);
+	dprintf(INFO, "udc: loopback over network device, waiting for host\n");
+	return 0;
+}
+
+int udc_stop(void)
+{
+	mask_interrupt(INT_NET);
+	online = 0;
+	return 0;
+}
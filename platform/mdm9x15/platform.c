@@ -38,6 +38,7 @@
 #include <platform/iomap.h>
 #include <smem.h>
 #include <qgic.h>
+#include <uart_dm.h>
 
 static uint32_t ticks_per_sec = 0;
 
@@ -61,10 +62,12 @@ void platform_init(void)
 {
 	dprintf(INFO, "platform_init()\n");
 	acpu_clock_init();
+	uart_init_irq();
 }
 
 void platform_uninit(void)
 {
+	uart_flush_tx(0);
 	platform_uninit_timer();
 }
 
@@ -135,8 +135,8 @@ void hsusb_clock_init(void)
 void clock_config_uart_dm(uint8_t id)
 {
 	/* Enable gsbi_uart_clk */
-	clock_config(UART_DM_CLK_NS_115200,
-				 UART_DM_CLK_MD_115200,
+	clock_config(UART_DM_CLK_NS,
+				 UART_DM_CLK_MD,
 				 GSBIn_UART_APPS_NS(id),
 				 GSBIn_UART_APPS_MD(id));
 
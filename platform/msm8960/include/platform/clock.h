@@ -40,6 +40,17 @@
 /* NS/MD value for UART */
 #define UART_DM_CLK_NS_115200  0xFFE40040
 #define UART_DM_CLK_MD_115200  0x0002FFE2
+/* PXO * 3/11 is ~460227 baud, 0.12% slow; faster rates need M/N above 1/2 */
+#define UART_DM_CLK_NS_460800  0xFFF70040
+#define UART_DM_CLK_MD_460800  0x0003FFF4
+
+#if UART_DM_BAUD == 460800
+#define UART_DM_CLK_NS         UART_DM_CLK_NS_460800
+#define UART_DM_CLK_MD         UART_DM_CLK_MD_460800
+#else
+#define UART_DM_CLK_NS         UART_DM_CLK_NS_115200
+#define UART_DM_CLK_MD         UART_DM_CLK_MD_115200
+#endif
 
 
 #define UART_DM_CLK_RX_TX_BIT_RATE 0xFF
@@ -89,6 +89,7 @@ void platform_early_init(void)
 void platform_init(void)
 {
     dprintf(INFO, "platform_init()\n");
+    uart_init_irq();
 }
 
 void display_init(void){
@@ -113,6 +114,7 @@ void display_shutdown(void)
 
 void platform_uninit(void)
 {
+	uart_flush_tx(0);
 	platform_uninit_timer();
 #if DISPLAY_SPLASH_SCREEN
 	display_shutdown();
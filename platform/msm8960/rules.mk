@@ -7,9 +7,11 @@ CPU     := generic
 DEFINES += ARM_CPU_CORE_KRAIT
 
 MMC_SLOT         := 1
+# 115200 or 460800
+UART_DM_BAUD     ?= 115200
 
 DEFINES += WITH_CPU_EARLY_INIT=0 WITH_CPU_WARM_BOOT=0 \
-	   MMC_SLOT=$(MMC_SLOT) MDP4=1
+	   MMC_SLOT=$(MMC_SLOT) MDP4=1 UART_DM_BAUD=$(UART_DM_BAUD)
 
 INCLUDES += -I$(LOCAL_DIR)/include -I$(LK_TOP_DIR)/platform/msm_shared/include
 
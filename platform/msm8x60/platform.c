@@ -120,6 +120,7 @@ void platform_early_init(void)
 void platform_init(void)
 {
     dprintf(INFO, "platform_init()\n");
+    uart_init_irq();
 }
 
 void display_init(void)
@@ -234,6 +235,7 @@ void platform_uninit(void)
 	 */
 	mdelay(400);
 
+	uart_flush_tx(0);
 	platform_uninit_timer();
 #if DISPLAY_SPLASH_SCREEN
 	display_shutdown();
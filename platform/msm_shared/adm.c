@@ -76,7 +76,7 @@ extern uint8_t sdc_crci_map[5];
 adm_result_t adm_transfer_mmc_data(unsigned char slot,
 				   unsigned char* data_ptr,
 				   unsigned int data_len,
-				   unsigned char direction)
+				   adm_dir_t direction)
 {
 	uint32_t num_rows;
 	uint16_t row_len;
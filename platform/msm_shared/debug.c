@@ -76,6 +76,10 @@ int dgetc(char *c, bool wait)
 void platform_halt(void)
 {
 	dprintf(INFO, "HALT: spinning forever...\n");
+#if WITH_DEBUG_UART
+	/* nothing drains the TX ring once we spin */
+	uart_flush_tx(0);
+#endif
 	for(;;);
 }
 
@@ -34,7 +34,9 @@
 #include <debug.h>
 #include <arch/arm.h>
 #include <reg.h>
+#include <err.h>
 #include <kernel/thread.h>
+#include <kernel/event.h>
 #include <dev/gpio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,6 +53,9 @@
 
 static struct qup_i2c_dev *dev_addr = NULL;
 
+/* ms to wait for the interrupt ending one block of a transfer */
+#define QUP_XFER_TIMEOUT    1000
+
 /* QUP Registers */
 enum {
     QUP_CONFIG = 0x0,
@@ -194,6 +199,7 @@ static irqreturn_t qup_i2c_interrupt(void)
 
 intr_done:
     dev->err = err;
+    event_signal(&dev->complete, false);
     return IRQ_HANDLED;
 }
 
@@ -221,7 +227,7 @@ static int qup_i2c_poll_state(struct qup_i2c_dev *dev, unsigned state)
 {
     unsigned retries = 0;
 
-    dprintf(INFO, "Polling Status for state:0x%x\n", state);
+    dprintf(SPEW, "Polling Status for state:0x%x\n", state);
 
     while (retries != 2000) {
         unsigned status = readl(dev->qup_base + QUP_STATE);
@@ -434,7 +440,8 @@ static int qup_set_wr_mode(struct qup_i2c_dev *dev, int rem)
     return ret;
 }
 
-int qup_i2c_xfer(struct qup_i2c_dev *dev, struct i2c_msg msgs[], int num)
+static int
+qup_i2c_do_xfer(struct qup_i2c_dev *dev, struct i2c_msg msgs[], int num)
 {
     int ret;
     int rem = num;
@@ -583,14 +590,23 @@ int qup_i2c_xfer(struct qup_i2c_dev *dev, struct i2c_msg msgs[], int num)
                         filled = TRUE;
                 }
             }
+            event_unsignal(&dev->complete);
             err = qup_update_state(dev, QUP_RUN_STATE);
             if (err < 0) {
                 ret = err;
                 goto out_err;
             }
-            dprintf(INFO, "idx:%d, rem:%d, num:%d, mode:%d\n",
+            dprintf(SPEW, "idx:%d, rem:%d, num:%d, mode:%d\n",
                     idx, rem, num, dev->mode);
 
+            /* Sleep until the block has gone out or the data has come in */
+            if (event_wait_timeout(&dev->complete, QUP_XFER_TIMEOUT)) {
+                dprintf(CRITICAL, "QUP: transfer timed out, status 0x%x\n",
+                        readl(dev->qup_base + QUP_I2C_STATUS));
+                ret = -ETIMEDOUT;
+                goto out_err;
+            }
+
             qup_print_status(dev);
             if (dev->err) {
                 if (dev->err & QUP_I2C_NACK_FLAG) {
@@ -647,6 +663,54 @@ out_err:
     return ret;
 }
 
+int qup_i2c_xfer(struct qup_i2c_dev *dev, struct i2c_msg msgs[], int num)
+{
+    /* Let an asynchronous transfer in flight finish first */
+    event_wait(&dev->async_done);
+    return qup_i2c_do_xfer(dev, msgs, num);
+}
+
+static int qup_i2c_async_thread(void *arg)
+{
+    struct qup_i2c_dev *dev = arg;
+
+    dev->async_ret = qup_i2c_do_xfer(dev, dev->async_msgs, dev->async_num);
+    event_signal(&dev->async_done, true);
+    return 0;
+}
+
+/*
+ * Start a transfer on its own thread and return.  msgs and their buffers
+ * must stay untouched until qup_i2c_xfer_wait() returns its result.
+ */
+int qup_i2c_xfer_async(struct qup_i2c_dev *dev, struct i2c_msg msgs[], int num)
+{
+    thread_t *thr;
+
+    event_wait(&dev->async_done);
+
+    dev->async_msgs = msgs;
+    dev->async_num = num;
+    dev->async_ret = -EIO;
+    event_unsignal(&dev->async_done);
+
+    thr = thread_create("qup_i2c", qup_i2c_async_thread, dev,
+                        DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+    if (!thr) {
+        event_signal(&dev->async_done, false);
+        return -ENOMEM;
+    }
+    thread_resume(thr);
+    return 0;
+}
+
+/* Wait for the transfer qup_i2c_xfer_async() started; qup_i2c_xfer() result */
+int qup_i2c_xfer_wait(struct qup_i2c_dev *dev)
+{
+    event_wait(&dev->async_done);
+    return dev->async_ret;
+}
+
 struct qup_i2c_dev *qup_i2c_init(uint8_t gsbi_id,
                                  unsigned clk_freq, unsigned src_clk_freq)
 {
@@ -686,6 +750,10 @@ struct qup_i2c_dev *qup_i2c_init(uint8_t gsbi_id,
     dev->one_bit_t = USEC_PER_SEC / dev->clk_freq;
     dev->clk_ctl = 0;
 
+    event_init(&dev->complete, false, EVENT_FLAG_AUTOUNSIGNAL);
+    /* Signalled while no asynchronous transfer is in flight */
+    event_init(&dev->async_done, true, 0);
+
     /* Register the GSBIn QUP IRQ */
     register_int_handler(dev->qup_irq, (int_handler) qup_i2c_interrupt, 0);
 
@@ -697,6 +765,7 @@ struct qup_i2c_dev *qup_i2c_init(uint8_t gsbi_id,
 
 int qup_i2c_deinit(struct qup_i2c_dev *dev)
 {
+    event_wait(&dev->async_done);
     /* Disable the qup_irq */
     mask_interrupt(dev->qup_irq);
     /* Free the memory used for dev */
@@ -29,6 +29,8 @@
 #ifndef  __I2C_QUP__
 #define  __I2C_QUP__
 
+#include <kernel/event.h>
+
 /**
  * struct i2c_msg - an I2C transaction segment beginning with START
  * @addr: Slave address, either seven or ten bits.  When this is a ten
@@ -102,6 +104,12 @@ struct qup_i2c_dev {
     int wr_sz;
     int suspended;
     int clk_state;
+    event_t complete;           /* signalled by the QUP interrupt */
+    /* qup_i2c_xfer_async() */
+    event_t async_done;
+    struct i2c_msg *async_msgs;
+    int async_num;
+    int async_ret;
 };
 
 /* Function Definitions */
@@ -109,6 +117,8 @@ struct qup_i2c_dev *qup_i2c_init(uint8_t gsbi_id,
                                  unsigned clk_freq, unsigned src_clk_freq);
 int qup_i2c_deinit(struct qup_i2c_dev *dev);
 int qup_i2c_xfer(struct qup_i2c_dev *dev, struct i2c_msg msgs[], int num);
+int qup_i2c_xfer_async(struct qup_i2c_dev *dev, struct i2c_msg msgs[], int num);
+int qup_i2c_xfer_wait(struct qup_i2c_dev *dev);
 
 struct device {
     struct device *parent;
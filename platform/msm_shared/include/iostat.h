@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __PLATFORM_MSM_SHARED_IOSTAT_H
+#define __PLATFORM_MSM_SHARED_IOSTAT_H
+
+#include <sys/types.h>
+
+/*
+ * Storage statistics kept by the MMC and NAND drivers since boot.
+ * Latencies go into log2 histograms: bucket n counts operations that
+ * took [2^n, 2^(n+1)) us, bucket 0 anything under 2 us and the last
+ * bucket anything longer.
+ */
+#define IOSTAT_BUCKETS		16	/* the last one starts at 32 ms */
+
+struct iostat_hist {
+	uint32_t count[IOSTAT_BUCKETS];
+	uint32_t max_us;
+	uint64_t total_us;
+};
+
+struct mmc_stats {
+	uint32_t reads;		/* mmc_boot_read_from_card() calls */
+	uint32_t writes;	/* mmc_boot_write_to_card() calls */
+	uint64_t read_bytes;
+	uint64_t write_bytes;
+	uint32_t read_errors;
+	uint32_t write_errors;
+	uint32_t cmds;
+	uint32_t retries;	/* CMD1 reissued while the card is busy */
+	uint32_t crc_errors;	/* command and data */
+	uint32_t timeouts;	/* command and data */
+	struct iostat_hist read_lat;
+	struct iostat_hist write_lat;
+};
+
+struct nand_stats {
+	uint32_t pages_read;
+	uint32_t pages_written;
+	uint32_t read_errors;
+	uint32_t write_errors;
+	uint32_t blocks_erased;
+	uint32_t ecc_corrected;	/* bit errors fixed by the controller */
+	uint32_t bad_skips;	/* bad blocks stepped over */
+	uint32_t dmov_cmds;
+	uint64_t dmov_wait_us;	/* spent polling for data mover results */
+	struct iostat_hist read_lat;	/* per page */
+	struct iostat_hist write_lat;
+};
+
+struct mmc_stats *mmc_get_stats(void);
+struct nand_stats *nand_get_stats(void);
+
+/* microseconds since 'start', a current_time_hires() value */
+unsigned iostat_since(bigtime_t start);
+void iostat_hist_add(struct iostat_hist *h, unsigned us);
+
+/* one line summaries, short enough for a fastboot getvar reply */
+void iostat_hist_format(const struct iostat_hist *h, char *buf,
+			unsigned size);
+void iostat_mmc_format(char *buf, unsigned size);
+void iostat_nand_format(char *buf, unsigned size);
+
+void iostat_dump(void);
+void iostat_reset(void);
+
+#endif
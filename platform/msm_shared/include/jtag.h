@@ -35,6 +35,29 @@ void jtag_fail(const char *msg);
 void jtag_dputc(unsigned ch);
 void jtag_cmd_loop(void (*do_cmd)(const char *, unsigned, unsigned, unsigned));
 
+/*
+ * Bulk buffer ring, for commands that take more data than one upload.
+ * jtag_ring_init() publishes the buffers in _jtag_ring.  The debugger
+ * fills buffer (head % count), sets its len and flags, then bumps head;
+ * the target bumps tail once a buffer may be refilled.  The target only
+ * stops in jtag_hook() when the ring is empty, so a debugger that can
+ * write memory while the target runs keeps the ring full while the
+ * target works through it.
+ */
+#define JTAG_RING_MAGIC		0x474e4952	/* "RING" */
+#define JTAG_RING_MAX		16
+
+#define JTAG_BUF_LZ4		0x1	/* buffer holds an lz4 frame */
+#define JTAG_BUF_LAST		0x2	/* last buffer of the transfer */
+
+void jtag_ring_init(void *base, unsigned count, unsigned size);
+/* next buffer the debugger filled, waiting for it if need be */
+void *jtag_ring_get(unsigned *len, unsigned *flags);
+/* done with the buffer jtag_ring_get() returned */
+void jtag_ring_put(void);
+/* tell the debugger to stop filling, after the last buffer or a failure */
+void jtag_ring_close(void);
+
 
 #endif /*__JTAG_H_ */
 
@@ -229,4 +229,7 @@ enum MSM_BOOT_UART_DM_BITS_PER_CHAR
 #define MSM_BOOT_UART_DM_E_RX_NOT_READY      5
 
 void uart_init(uint8_t gsbi_id);
+void uart_init_irq(void);
+void uart_flush_tx(int port);
+int uart_putc(int port, char c);
 #endif /* __UART_DM_H__*/
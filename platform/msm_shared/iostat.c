@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor
+ *       the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <string.h>
+#include <printf.h>
+#include <platform.h>
+#include <iostat.h>
+
+unsigned iostat_since(bigtime_t start)
+{
+	bigtime_t now = current_time_hires();
+
+	/* a tick held off by a critical section can make time step back */
+	return (now > start) ? (unsigned) (now - start) : 0;
+}
+
+void iostat_hist_add(struct iostat_hist *h, unsigned us)
+{
+	unsigned b = 0;
+
+	while ((us >> (b + 1)) && b < IOSTAT_BUCKETS - 1)
+		b++;
+
+	h->count[b]++;
+	h->total_us += us;
+	if (us > h->max_us)
+		h->max_us = us;
+}
+
+/* the upper bound, in us, of the bucket holding the given share */
+static unsigned iostat_percentile(const struct iostat_hist *h, unsigned n,
+				  unsigned percent)
+{
+	unsigned want = (n * percent + 99) / 100;
+	unsigned seen = 0, b;
+
+	for (b = 0; b < IOSTAT_BUCKETS - 1; b++) {
+		seen += h->count[b];
+		if (seen >= want)
+			break;
+	}
+	return (b == IOSTAT_BUCKETS - 1) ? h->max_us : 2U << b;
+}
+
+static unsigned iostat_count(const struct iostat_hist *h)
+{
+	unsigned n = 0, b;
+
+	for (b = 0; b < IOSTAT_BUCKETS; b++)
+		n += h->count[b];
+	return n;
+}
+
+void iostat_hist_format(const struct iostat_hist *h, char *buf,
+			unsigned size)
+{
+	unsigned n = iostat_count(h);
+
+	if (!n) {
+		snprintf(buf, size, "n=0");
+		return;
+	}
+	snprintf(buf, size, "n=%u p50<%u p99<%u max=%u avg=%u", n,
+		 iostat_percentile(h, n, 50), iostat_percentile(h, n, 99),
+		 h->max_us, (unsigned) (h->total_us / n));
+}
+
+void iostat_mmc_format(char *buf, unsigned size)
+{
+	struct mmc_stats *s = mmc_get_stats();
+
+	snprintf(buf, size, "r %u %uK w %u %uK err %u/%u crc %u to %u rt %u",
+		 s->reads, (unsigned) (s->read_bytes >> 10), s->writes,
+		 (unsigned) (s->write_bytes >> 10), s->read_errors,
+		 s->write_errors, s->crc_errors, s->timeouts, s->retries);
+}
+
+void iostat_nand_format(char *buf, unsigned size)
+{
+	struct nand_stats *s = nand_get_stats();
+
+	snprintf(buf, size, "r %u w %u e %u ecc %u bad %u err %u/%u dm %ums",
+		 s->pages_read, s->pages_written, s->blocks_erased,
+		 s->ecc_corrected, s->bad_skips, s->read_errors,
+		 s->write_errors, (unsigned) (s->dmov_wait_us / 1000));
+}
+
+static void iostat_hist_dump(const char *name, const struct iostat_hist *h)
+{
+	char line[64];
+	unsigned b;
+
+	iostat_hist_format(h, line, sizeof(line));
+	dprintf(INFO, "  %s: %s us\n", name, line);
+	for (b = 0; b < IOSTAT_BUCKETS; b++) {
+		if (!h->count[b])
+			continue;
+		if (b == IOSTAT_BUCKETS - 1)
+			dprintf(INFO, "    >= %6u us: %u\n", 1U << b, h->count[b]);
+		else
+			dprintf(INFO, "    <  %6u us: %u\n", 2U << b, h->count[b]);
+	}
+}
+
+void iostat_dump(void)
+{
+	struct mmc_stats *m = mmc_get_stats();
+	struct nand_stats *n = nand_get_stats();
+	char line[64];
+
+	if (m->cmds) {
+		iostat_mmc_format(line, sizeof(line));
+		dprintf(INFO, "mmc: %s, %u cmds\n", line, m->cmds);
+		iostat_hist_dump("read", &m->read_lat);
+		iostat_hist_dump("write", &m->write_lat);
+	}
+	if (n->dmov_cmds) {
+		iostat_nand_format(line, sizeof(line));
+		dprintf(INFO, "nand: %s, %u dmov cmds\n", line, n->dmov_cmds);
+		iostat_hist_dump("page read", &n->read_lat);
+		iostat_hist_dump("page write", &n->write_lat);
+	}
+}
+
+void iostat_reset(void)
+{
+	memset(mmc_get_stats(), 0, sizeof(struct mmc_stats));
+	memset(nand_get_stats(), 0, sizeof(struct nand_stats));
+}
+
+#if WITH_LIB_CONSOLE
+
+#include <lib/console.h>
+
+static int cmd_iostat(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+	{ "iostat", "storage statistics [reset]", &cmd_iostat },
+STATIC_COMMAND_END(iostat);
+
+static int cmd_iostat(int argc, const cmd_args *argv)
+{
+	if (argc > 1 && !strcmp(argv[1].str, "reset"))
+		iostat_reset();
+	else
+		iostat_dump();
+	return 0;
+}
+
+#endif
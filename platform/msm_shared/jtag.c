@@ -88,6 +88,56 @@ void jtag_cmd_loop(void (*do_cmd)(const char *, unsigned, unsigned, unsigned))
     }
 }
 
+struct jtag_ring {
+    unsigned magic;
+    unsigned count;
+    unsigned size;
+    unsigned base;
+    volatile unsigned head;
+    volatile unsigned tail;
+    struct {
+        volatile unsigned len;
+        volatile unsigned flags;
+    } buf[JTAG_RING_MAX];
+};
+
+struct jtag_ring _jtag_ring;
+
+void jtag_ring_init(void *base, unsigned count, unsigned size)
+{
+    if(count > JTAG_RING_MAX) count = JTAG_RING_MAX;
+    _jtag_ring.count = count;
+    _jtag_ring.size = size;
+    _jtag_ring.base = (unsigned) base;
+    _jtag_ring.head = 0;
+    _jtag_ring.tail = 0;
+    _jtag_ring.magic = JTAG_RING_MAGIC;
+}
+
+void *jtag_ring_get(unsigned *len, unsigned *flags)
+{
+    unsigned n;
+
+    /* an empty ring means the debugger is behind: stop for it */
+    while(_jtag_ring.head == _jtag_ring.tail)
+        jtag_hook();
+
+    n = _jtag_ring.tail % _jtag_ring.count;
+    *len = _jtag_ring.buf[n].len;
+    *flags = _jtag_ring.buf[n].flags;
+    return (void *) (_jtag_ring.base + n * _jtag_ring.size);
+}
+
+void jtag_ring_put(void)
+{
+    _jtag_ring.tail++;
+}
+
+void jtag_ring_close(void)
+{
+    _jtag_ring.magic = 0;
+}
+
 static char jtag_putc_buffer[128];
 static unsigned jtag_putc_count = 0;
 
@@ -30,10 +30,13 @@
 #include <stdlib.h>
 #include <debug.h>
 #include <reg.h>
+#include <kernel/mutex.h>
 #include "mmc.h"
+#include <iostat.h>
 #include <partition_parser.h>
 #include <platform/iomap.h>
 #include <platform/timer.h>
+#include <platform.h>
 
 #if MMC_BOOT_ADM
 #include "adm.h"
@@ -80,6 +83,17 @@ unsigned int mmc_boot_mci_base = 0;
 static unsigned char ext_csd_buf[512];
 static unsigned char wp_status_buf[8];
 
+/* serialises card accesses from different threads */
+static mutex_t mmc_lock;
+static int mmc_lock_ready;
+
+static struct mmc_stats mmc_stats;
+
+struct mmc_stats *mmc_get_stats(void)
+{
+    return &mmc_stats;
+}
+
 int mmc_clock_enable_disable(unsigned id, unsigned enable);
 int mmc_clock_get_rate(unsigned id);
 int mmc_clock_set_rate(unsigned id, unsigned rate);
@@ -508,6 +522,7 @@ static unsigned int mmc_boot_send_command( struct mmc_boot_command* cmd )
 
     /* 2k. Write to MMC_BOOT_MCI_CMD register */
     writel( mmc_cmd, MMC_BOOT_MCI_CMD );
+    mmc_stats.cmds++;
 
 #ifndef DISABLE_MMC_DEBUG_SPEW
     dprintf(SPEW, "Command sent: CMD%d MCI_CMD_REG:%x MCI_ARG:%x\n",
@@ -535,6 +550,7 @@ static unsigned int mmc_boot_send_command( struct mmc_boot_command* cmd )
         else if( mmc_status & MMC_BOOT_MCI_STAT_CMD_TIMEOUT )
         {
             mmc_return = MMC_BOOT_E_TIMEOUT;
+            mmc_stats.timeouts++;
             break;
         }
         /* 3d. If CMD_RESPONSE_END bit is set to 1 then command's response was
@@ -595,7 +611,10 @@ static unsigned int mmc_boot_send_command( struct mmc_boot_command* cmd )
                 cmd->resp[0] = readl( MMC_BOOT_MCI_RESP_0);
             }
             else
+            {
                 mmc_return = MMC_BOOT_E_CRC_FAIL;
+                mmc_stats.crc_errors++;
+            }
             break;
         }
 
@@ -1020,12 +1039,14 @@ static unsigned int mmc_boot_status_error(unsigned mmc_status)
     if( mmc_status & MMC_BOOT_MCI_STAT_DATA_CRC_FAIL )
     {
         mmc_ret = MMC_BOOT_E_DATA_CRC_FAIL;
+        mmc_stats.crc_errors++;
     }
     /* If DATA_TIMEOUT bit is set to 1 then the data transfer time exceeded
        the data timeout period without completing the transfer */
     else if( mmc_status & MMC_BOOT_MCI_STAT_DATA_TIMEOUT )
     {
         mmc_ret = MMC_BOOT_E_DATA_TIMEOUT;
+        mmc_stats.timeouts++;
     }
     /* If RX_OVERRUN bit is set to 1 then SDCC2 tried to receive data from
        the card before empty storage for new received data was available.
@@ -1356,7 +1377,7 @@ static unsigned int mmc_boot_send_write_command( struct mmc_boot_card* card,
  * Write data_len data to address specified by data_addr. data_len is
  * multiple of blocks for block data transfer.
  */
-unsigned int mmc_boot_write_to_card( struct mmc_boot_host* host,
+static unsigned int mmc_boot_write_xfer( struct mmc_boot_host* host,
         struct mmc_boot_card* card,
         unsigned long long data_addr,
         unsigned int data_len,
@@ -1579,7 +1600,7 @@ static unsigned int mmc_boot_set_block_count( struct mmc_boot_card* card,
  * Reads a data of data_len from the address specified. data_len
  * should be multiple of block size for block data transfer.
  */
-unsigned int mmc_boot_read_from_card( struct mmc_boot_host* host,
+static unsigned int mmc_boot_read_xfer( struct mmc_boot_host* host,
         struct mmc_boot_card* card,
         unsigned long long data_addr,
         unsigned int data_len,
@@ -1713,6 +1734,58 @@ unsigned int mmc_boot_read_from_card( struct mmc_boot_host* host,
     return MMC_BOOT_E_SUCCESS;
 }
 
+/*
+ * Timed and counted entry points for data transfers.  They hold mmc_lock
+ * for the transfer, so callers in different threads take turns.
+ */
+unsigned int mmc_boot_write_to_card( struct mmc_boot_host* host,
+        struct mmc_boot_card* card,
+        unsigned long long data_addr,
+        unsigned int data_len,
+        unsigned int* in )
+{
+    bigtime_t start = current_time_hires();
+    unsigned int mmc_ret;
+
+    mutex_acquire(&mmc_lock);
+    mmc_ret = mmc_boot_write_xfer( host, card, data_addr, data_len, in );
+    mutex_release(&mmc_lock);
+    if( mmc_ret != MMC_BOOT_E_SUCCESS )
+    {
+        mmc_stats.write_errors++;
+        return mmc_ret;
+    }
+
+    mmc_stats.writes++;
+    mmc_stats.write_bytes += data_len;
+    iostat_hist_add( &mmc_stats.write_lat, iostat_since(start) );
+    return mmc_ret;
+}
+
+unsigned int mmc_boot_read_from_card( struct mmc_boot_host* host,
+        struct mmc_boot_card* card,
+        unsigned long long data_addr,
+        unsigned int data_len,
+        unsigned int* out )
+{
+    bigtime_t start = current_time_hires();
+    unsigned int mmc_ret;
+
+    mutex_acquire(&mmc_lock);
+    mmc_ret = mmc_boot_read_xfer( host, card, data_addr, data_len, out );
+    mutex_release(&mmc_lock);
+    if( mmc_ret != MMC_BOOT_E_SUCCESS )
+    {
+        mmc_stats.read_errors++;
+        return mmc_ret;
+    }
+
+    mmc_stats.reads++;
+    mmc_stats.read_bytes += data_len;
+    iostat_hist_add( &mmc_stats.read_lat, iostat_since(start) );
+    return mmc_ret;
+}
+
 /*
  * Initialize host structure, set and enable clock-rate and power mode.
  */
@@ -1976,6 +2049,7 @@ static unsigned int mmc_boot_init_card( struct mmc_boot_host* host,
         if( mmc_return == MMC_BOOT_E_CARD_BUSY )
         {
             mmc_retry++;
+            mmc_stats.retries++;
             mdelay(1);
             continue;
         }
@@ -2210,6 +2284,12 @@ unsigned int mmc_boot_main(unsigned char slot, unsigned int base)
 {
     unsigned int mmc_ret = MMC_BOOT_E_SUCCESS;
 
+    if (!mmc_lock_ready)
+    {
+        mutex_init(&mmc_lock);
+        mmc_lock_ready = 1;
+    }
+
     memset( (struct mmc_boot_host*)&mmc_host, 0, sizeof( struct mmc_boot_host ) );
     memset( (struct mmc_boot_card*)&mmc_card, 0, sizeof(struct mmc_boot_card) );
 
@@ -2679,9 +2759,11 @@ static unsigned int mmc_wp(unsigned int sector, unsigned int size,
     /* Checking whether group write protection feature is available */
     if(mmc_card.csd.wp_grp_enable)
     {
+        mutex_acquire(&mmc_lock);
         rc = mmc_boot_get_wp_status(&mmc_card,sector);
         rc = mmc_boot_set_clr_power_on_wp_user(&mmc_card,sector,size,set_clear_wp);
         rc = mmc_boot_get_wp_status(&mmc_card,sector);
+        mutex_release(&mmc_lock);
         return rc;
     }
     else
@@ -34,6 +34,8 @@
 #include <dev/flash.h>
 #include <lib/ptable.h>
 #include <nand.h>
+#include <iostat.h>
+#include <platform.h>
 
 #include "dmov.h"
 
@@ -84,17 +86,33 @@ static unsigned int *bbtbl;
 
 #define paddr(n) ((unsigned) (n))
 
+/* corrected bit count and uncorrectable flag in a codeword's buffer status */
+#define NAND_BUF_STAT_NUM_ERR_MASK	(enable_bch_ecc ? 0x1F : 0x0F)
+#define NAND_BUF_STAT_UNCRCTBL		(1 << 8)
+
+static struct nand_stats nand_stats;
+
+struct nand_stats *nand_get_stats(void)
+{
+	return &nand_stats;
+}
+
 static int dmov_exec_cmdptr(unsigned id, unsigned *ptr)
 {
 	dmov_ch ch;
 	unsigned n;
+	bigtime_t start;
 
 	dmov_prep_ch(&ch, id);
 
+	start = current_time_hires();
 	writel(DMOV_CMD_PTR_LIST | DMOV_CMD_ADDR(paddr(ptr)), ch.cmd);
 
 	while(!(readl(ch.status) & DMOV_STATUS_RSLT_VALID)) ;
 
+	nand_stats.dmov_cmds++;
+	nand_stats.dmov_wait_us += iostat_since(start);
+
 	n = readl(ch.status);
 	while(DMOV_STATUS_RSLT_COUNT(n)) {
 		n = readl(ch.result);
@@ -244,6 +262,296 @@ static void flash_nand_read_id(dmov_s *cmdlist, unsigned *ptrlist)
 	return;
 }
 
+/*
+ * ONFI parts carry a parameter page (three copies, each with a CRC)
+ * describing their geometry, ECC requirement, timings and optional
+ * commands.  It is read with a raw page read whose read command has
+ * been replaced by READ PARAMETER PAGE (ECh) and whose second read
+ * cycle (30h) has been switched off.
+ */
+#define ONFI_SIGNATURE		0x49464E4F	/* "ONFI" */
+#define ONFI_ID_ADDR		0x20
+#define ONFI_CMD_READ_PARAM	0xEC
+#define ONFI_PARAM_LEN		256
+#define ONFI_PARAM_COPIES	2		/* in the 512 bytes read */
+#define ONFI_CRC_POLY		0x8005
+#define ONFI_CRC_INIT		0x4F4E
+
+#define ONFI_CFG0_READ_ID	0x88000800	/* 1 addr cycle, 4 bytes */
+#define ONFI_CFG0_READ_PARAM	0x88040000	/* 1 addr cycle, 512 bytes */
+#define ONFI_CFG1_RAW		0x0005045D	/* ECC off */
+
+#define ONFI_FEATURE_16BIT		(1 << 0)
+#define ONFI_FEATURE_MULTIPLANE_PRG	(1 << 3)
+#define ONFI_FEATURE_MULTIPLANE_READ	(1 << 6)
+#define ONFI_OPT_CACHE_PROGRAM		(1 << 0)
+#define ONFI_OPT_CACHE_READ		(1 << 1)
+#define ONFI_OPT_SET_FEATURES		(1 << 2)
+
+static struct onfi_info {
+	unsigned valid;
+	unsigned ecc_bits;	/* correctable bits per 512 bytes required */
+	unsigned timing_modes;	/* bit n set: asynchronous timing mode n */
+	unsigned features;
+	unsigned opt_cmds;
+	unsigned planes;
+	unsigned t_r;		/* page read time, us */
+	unsigned t_prog;	/* page program time, us */
+} onfi;
+
+struct onfi_probe_io {
+	unsigned cmd;
+	unsigned addr0;
+	unsigned addr1;
+	unsigned chipsel;
+	unsigned cfg0;
+	unsigned cfg1;
+	unsigned exec;
+	unsigned dev_cmd1;
+	unsigned dev_cmd_vld;
+	unsigned dev_cmd1_orig;
+	unsigned dev_cmd_vld_orig;
+	unsigned burst_cfg_orig;
+	unsigned burst_cfg;
+	unsigned id;
+	unsigned flash_status;
+	unsigned buffer_status;
+};
+
+static unsigned onfi_crc16(const unsigned char *p, unsigned len)
+{
+	unsigned crc = ONFI_CRC_INIT;
+	unsigned i;
+
+	while (len--) {
+		crc ^= *p++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ ONFI_CRC_POLY : crc << 1;
+	}
+	return crc & 0xFFFF;
+}
+
+static unsigned onfi_le16(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static unsigned onfi_le32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+/* issue the prepared command in 'data' and collect its status */
+static dmov_s *onfi_cmd(dmov_s *cmd, struct onfi_probe_io *data)
+{
+	cmd->cmd = 0;
+	cmd->src = paddr(&data->cfg0);
+	cmd->dst = NAND_DEV0_CFG0;
+	cmd->len = 8;
+	cmd++;
+
+	cmd->cmd = DST_CRCI_NAND_CMD;
+	cmd->src = paddr(&data->cmd);
+	cmd->dst = NAND_FLASH_CMD;
+	cmd->len = 16;
+	cmd++;
+
+	cmd->cmd = 0;
+	cmd->src = paddr(&data->exec);
+	cmd->dst = NAND_EXEC_CMD;
+	cmd->len = 4;
+	cmd++;
+
+	cmd->cmd = SRC_CRCI_NAND_DATA;
+	cmd->src = NAND_FLASH_STATUS;
+	cmd->dst = paddr(&data->flash_status);
+	cmd->len = 8;
+	cmd++;
+
+	return cmd;
+}
+
+/* fill supported_flash[0] from the ONFI parameter page; 0 if not ONFI */
+static int flash_onfi_probe(dmov_s *cmdlist, unsigned *ptrlist)
+{
+	dmov_s *cmd = cmdlist;
+	unsigned *ptr = ptrlist;
+	struct onfi_probe_io *data = (void*) (ptrlist + 4);
+	struct flash_identification *row = &supported_flash[0];
+	unsigned char *param = flash_data;
+	unsigned pagesize, oobsize, pages, blocks, luns, copy, i;
+	unsigned long long density;
+	char model[21];
+
+	memset(data, 0, sizeof(*data));
+	data->chipsel = 0 | 4; /* flash0 + undoc bit */
+	data->exec = 1;
+
+	/* READ ID at address 20h answers "ONFI" on ONFI parts */
+	data->cmd = NAND_CMD_FETCH_ID;
+	data->addr0 = ONFI_ID_ADDR;
+	data->cfg0 = ONFI_CFG0_READ_ID;
+	data->cfg1 = ONFI_CFG1_RAW;
+
+	cmd->cmd = CMD_OCB;
+	cmd->src = NAND_SFLASHC_BURST_CFG;
+	cmd->dst = paddr(&data->burst_cfg_orig);
+	cmd->len = 4;
+	cmd++;
+
+	cmd->cmd = 0;
+	cmd->src = paddr(&data->burst_cfg);
+	cmd->dst = NAND_SFLASHC_BURST_CFG;
+	cmd->len = 4;
+	cmd++;
+
+	cmd = onfi_cmd(cmd, data);
+
+	cmd->cmd = 0;
+	cmd->src = NAND_READ_ID;
+	cmd->dst = paddr(&data->id);
+	cmd->len = 4;
+	cmd++;
+
+	cmd->cmd = 0;
+	cmd->src = NAND_DEV_CMD1;
+	cmd->dst = paddr(&data->dev_cmd1_orig);
+	cmd->len = 4;
+	cmd++;
+
+	cmd->cmd = 0;
+	cmd->src = NAND_DEV_CMD_VLD;
+	cmd->dst = paddr(&data->dev_cmd_vld_orig);
+	cmd->len = 4;
+	cmd++;
+
+	cmd->cmd = CMD_OCU | CMD_LC;
+	cmd->src = paddr(&data->burst_cfg_orig);
+	cmd->dst = NAND_SFLASHC_BURST_CFG;
+	cmd->len = 4;
+
+	ptr[0] = (paddr(cmdlist) >> 3) | CMD_PTR_LP;
+	dmov_exec_cmdptr(DMOV_NAND_CHAN, ptr);
+
+	if (data->id != ONFI_SIGNATURE)
+		return 0;
+
+	/* READ PARAMETER PAGE: 00h -> ECh, no 30h */
+	cmd = cmdlist;
+	data->cmd = NAND_CMD_PAGE_READ_ALL;
+	data->addr0 = 0;
+	data->cfg0 = ONFI_CFG0_READ_PARAM;
+	data->dev_cmd1 = (data->dev_cmd1_orig & 0xFFFFFF00) | ONFI_CMD_READ_PARAM;
+	data->dev_cmd_vld = data->dev_cmd_vld_orig & ~1;
+
+	cmd->cmd = CMD_OCB;
+	cmd->src = paddr(&data->dev_cmd_vld);
+	cmd->dst = NAND_DEV_CMD_VLD;
+	cmd->len = 4;
+	cmd++;
+
+	cmd->cmd = 0;
+	cmd->src = paddr(&data->dev_cmd1);
+	cmd->dst = NAND_DEV_CMD1;
+	cmd->len = 4;
+	cmd++;
+
+	cmd = onfi_cmd(cmd, data);
+
+	cmd->cmd = 0;
+	cmd->src = NAND_FLASH_BUFFER;
+	cmd->dst = paddr(param);
+	cmd->len = ONFI_PARAM_LEN * ONFI_PARAM_COPIES;
+	cmd++;
+
+	cmd->cmd = 0;
+	cmd->src = paddr(&data->dev_cmd1_orig);
+	cmd->dst = NAND_DEV_CMD1;
+	cmd->len = 4;
+	cmd++;
+
+	cmd->cmd = CMD_OCU | CMD_LC;
+	cmd->src = paddr(&data->dev_cmd_vld_orig);
+	cmd->dst = NAND_DEV_CMD_VLD;
+	cmd->len = 4;
+
+	ptr[0] = (paddr(cmdlist) >> 3) | CMD_PTR_LP;
+	dmov_exec_cmdptr(DMOV_NAND_CHAN, ptr);
+
+	if (data->flash_status & 0x110) {
+		dprintf(CRITICAL, "onfi: parameter page read failed: %x\n",
+			data->flash_status);
+		return 0;
+	}
+
+	for (copy = 0; copy < ONFI_PARAM_COPIES; copy++) {
+		if (onfi_crc16(param, ONFI_PARAM_LEN - 2) ==
+		    onfi_le16(param + ONFI_PARAM_LEN - 2) &&
+		    onfi_le32(param) == ONFI_SIGNATURE)
+			break;
+		param += ONFI_PARAM_LEN;
+	}
+	if (copy == ONFI_PARAM_COPIES) {
+		dprintf(CRITICAL, "onfi: no parameter page with a good CRC\n");
+		return 0;
+	}
+
+	pagesize = onfi_le32(param + 80);
+	oobsize = onfi_le16(param + 84);
+	pages = onfi_le32(param + 92);
+	blocks = onfi_le32(param + 96);
+	luns = param[100];
+
+	/* the controller handles 2k and 4k pages */
+	if ((pagesize != 2048 && pagesize != 4096) || !pages || !blocks ||
+	    !luns) {
+		dprintf(CRITICAL, "onfi: unsupported geometry %u/%u/%u/%u\n",
+			pagesize, pages, blocks, luns);
+		return 0;
+	}
+
+	density = (unsigned long long) pagesize * pages * blocks * luns;
+	if (density > 0xFFFFFFFFULL) {
+		dprintf(INFO, "onfi: using the first 4GB only\n");
+		density = 0x100000000ULL - pagesize * pages;
+	}
+
+	onfi.valid = 1;
+	onfi.features = onfi_le16(param + 6);
+	onfi.opt_cmds = onfi_le16(param + 8);
+	onfi.ecc_bits = param[112];
+	onfi.planes = 1 << (param[113] & 0xF);
+	onfi.timing_modes = onfi_le16(param + 129) & 0x3F;
+	onfi.t_prog = onfi_le16(param + 133);
+	onfi.t_r = onfi_le16(param + 137);
+
+	row->flash_id = flash_info.id;
+	row->mask = 0xFFFFFFFF;
+	row->density = (unsigned) density;
+	row->widebus = !!(onfi.features & ONFI_FEATURE_16BIT);
+	row->pagesize = pagesize;
+	row->blksize = pagesize * pages;
+	row->oobsize = oobsize;
+	row->onenand = 0;
+
+	memcpy(model, param + 44, 20);
+	model[20] = 0;
+	for (i = 20; i > 0 && model[i - 1] == ' '; i--)
+		model[i - 1] = 0;
+
+	dprintf(INFO, "onfi: %s, %u MB, %u bit ECC, timing modes %x, tR %u us, "
+		"tPROG %u us\n", model, (unsigned) (density >> 20), onfi.ecc_bits,
+		onfi.timing_modes, onfi.t_r, onfi.t_prog);
+	dprintf(INFO, "onfi: cache read %s, cache program %s, %u plane(s)%s\n",
+		(onfi.opt_cmds & ONFI_OPT_CACHE_READ) ? "yes" : "no",
+		(onfi.opt_cmds & ONFI_OPT_CACHE_PROGRAM) ? "yes" : "no",
+		onfi.planes,
+		(onfi.features & (ONFI_FEATURE_MULTIPLANE_PRG |
+				  ONFI_FEATURE_MULTIPLANE_READ)) ?
+			" with multi-plane operations" : "");
+	return 1;
+}
+
 static int flash_nand_block_isbad(dmov_s *cmdlist, unsigned *ptrlist,
 								  unsigned page)
 {
@@ -524,6 +832,7 @@ static int flash_nand_erase_block(dmov_s *cmdlist, unsigned *ptrlist,
 
 	if (isbad) {
 		dprintf(INFO, "skipping @ %d (bad block)\n", page / num_pages_per_blk);
+		nand_stats.bad_skips++;
 		return -1;
 	}
 
@@ -607,6 +916,7 @@ static int flash_nand_erase_block_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 
 	if (isbad) {
 		dprintf(INFO, "skipping @ %d (bad block)\n", page >> 6);
+		nand_stats.bad_skips++;
 		return -1;
 	}
 
@@ -779,48 +1089,92 @@ struct interleave_data_flash_io {
 	} result[16];
 };
 
-static int _flash_nand_read_page(dmov_s *cmdlist, unsigned *ptrlist,
-								 unsigned page, void *_addr, void *_spareaddr)
+/*
+ * The command list of a page read or write only depends on the page
+ * geometry, the ECC mode, interleaving and the partition configuration
+ * (CFG0), so it is built once and reused: per page only the address
+ * registers and the buffer addresses are patched in.  Reads and writes
+ * have their own lists so bad block checks in between do not clobber
+ * them.
+ */
+#define NAND_LIST_MAX_PATCH	17	/* 16 codewords and the spare area */
+
+struct nand_page_list {
+	dmov_s *cmdlist;
+	unsigned *ptrlist;
+	unsigned write;		/* buffers are the source, not the destination */
+
+	/* configuration the list was built for */
+	unsigned valid;
+	unsigned cfg0;
+	unsigned raw_mode;
+	unsigned interleaved;
+
+	unsigned count;
+	struct {
+		dmov_s *cmd;
+		unsigned offset;
+		unsigned spare;
+	} patch[NAND_LIST_MAX_PATCH];
+};
+
+static struct nand_page_list nand_read_list;
+static struct nand_page_list nand_write_list = { .write = 1 };
+
+static int nand_page_list_ready(struct nand_page_list *l, unsigned raw_mode)
 {
-	dmov_s *cmd = cmdlist;
-	unsigned *ptr = ptrlist;
-	struct data_flash_io *data = (void*) (ptrlist + 4);
-	unsigned addr = (unsigned) _addr;
-	unsigned spareaddr = (unsigned) _spareaddr;
+	return l->valid && l->cfg0 == CFG0 && l->raw_mode == raw_mode &&
+	       l->interleaved == interleaved_mode;
+}
+
+static void nand_page_list_begin(struct nand_page_list *l, unsigned raw_mode)
+{
+	l->valid = 1;
+	l->cfg0 = CFG0;
+	l->raw_mode = raw_mode;
+	l->interleaved = interleaved_mode;
+	l->count = 0;
+	l->ptrlist[0] = (paddr(l->cmdlist) >> 3) | CMD_PTR_LP;
+}
+
+/* 'cmd' moves data to or from 'offset' in the page (or spare) buffer */
+static void nand_page_list_buffer(struct nand_page_list *l, dmov_s *cmd,
+				  unsigned offset, unsigned spare)
+{
+	ASSERT(l->count < NAND_LIST_MAX_PATCH);
+	l->patch[l->count].cmd = cmd;
+	l->patch[l->count].offset = offset;
+	l->patch[l->count].spare = spare;
+	l->count++;
+}
+
+static void nand_page_list_exec(struct nand_page_list *l, unsigned addr,
+				unsigned spareaddr)
+{
+	unsigned n, buf;
+
+	for (n = 0; n < l->count; n++) {
+		buf = (l->patch[n].spare ? spareaddr : addr) + l->patch[n].offset;
+		if (l->write)
+			l->patch[n].cmd->src = buf;
+		else
+			l->patch[n].cmd->dst = buf;
+	}
+
+	dmov_exec_cmdptr(DMOV_NAND_CHAN, l->ptrlist);
+}
+
+static void flash_nand_read_page_build(struct nand_page_list *l)
+{
+	dmov_s *cmd = l->cmdlist;
+	struct data_flash_io *data = (void*) (l->ptrlist + 4);
 	unsigned n;
-	int isbad = 0;
 	unsigned cwperpage;
-	unsigned block = 0;
 	cwperpage = (flash_pagesize >> 9);
 
-	/* Find the block no for the page */
-	block = page / num_pages_per_blk;
-
-	/* Check the bad block table for each block
-	 * -1: indicates the block needs to be checked if good or bad
-	 * 1 : The block is bad
-	 * 0 : The block is good
-	 */
-	if(bbtbl[block] == -1) {
-		isbad = flash_nand_block_isbad(cmdlist, ptrlist, page);
-		if(isbad) {
-			/* Found bad , set the bad table entry */
-			bbtbl[block] = 1;
-			return -2;
-		} else {
-			/* Found good block , set the table entry &
-			*  continue reading the data
-			*/
-			bbtbl[block] = 0;
-		}
-	} else if(bbtbl[block] == 1) {
-		/* If the block is already identified as bad, return error*/
-		return -2;
-	}
+	nand_page_list_begin(l, 0);
 
 	data->cmd = NAND_CMD_PAGE_READ_ECC;
-	data->addr0 = page << 16;
-	data->addr1 = (page >> 16) & 0xff;
 	data->chipsel = 0 | 4; /* flash0 + undoc bit */
 
 	/* GO bit for the EXEC register */
@@ -885,7 +1239,7 @@ static int _flash_nand_read_page(dmov_s *cmdlist, unsigned *ptrlist,
 		/* read data block */
 		cmd->cmd = 0;
 		cmd->src = NAND_FLASH_BUFFER;
-		cmd->dst = addr + n * 516;
+		nand_page_list_buffer(l, cmd, n * 516, 0);
 		cmd->len = ((n < (cwperpage -1 )) ? 516 : (512 - ((cwperpage - 1) << 2)));
 		cmd++;
 	}
@@ -893,7 +1247,7 @@ static int _flash_nand_read_page(dmov_s *cmdlist, unsigned *ptrlist,
 	/* read extra data */
 	cmd->cmd = 0;
 	cmd->src = NAND_FLASH_BUFFER + (512 - ((cwperpage - 1) << 2));
-	cmd->dst = spareaddr;
+	nand_page_list_buffer(l, cmd, 0, 1);
 	cmd->len = 16;
 	cmd++;
 
@@ -902,16 +1256,59 @@ static int _flash_nand_read_page(dmov_s *cmdlist, unsigned *ptrlist,
 	cmd->src = paddr(&data->ecc_cfg_save);
 	cmd->dst = NAND_EBI2_ECC_BUF_CFG;
 	cmd->len = 4;
+}
 
-	ptr[0] = (paddr(cmdlist) >> 3) | CMD_PTR_LP;
+static int _flash_nand_read_page(dmov_s *cmdlist, unsigned *ptrlist,
+								 unsigned page, void *_addr, void *_spareaddr)
+{
+	struct nand_page_list *l = &nand_read_list;
+	struct data_flash_io *data = (void*) (l->ptrlist + 4);
+	unsigned addr = (unsigned) _addr;
+	unsigned spareaddr = (unsigned) _spareaddr;
+	unsigned n;
+	int isbad = 0;
+	unsigned cwperpage;
+	unsigned block = 0;
+	cwperpage = (flash_pagesize >> 9);
 
-	dmov_exec_cmdptr(DMOV_NAND_CHAN, ptr);
+	/* Find the block no for the page */
+	block = page / num_pages_per_blk;
+
+	/* Check the bad block table for each block
+	 * -1: indicates the block needs to be checked if good or bad
+	 * 1 : The block is bad
+	 * 0 : The block is good
+	 */
+	if(bbtbl[block] == -1) {
+		isbad = flash_nand_block_isbad(cmdlist, ptrlist, page);
+		if(isbad) {
+			/* Found bad , set the bad table entry */
+			bbtbl[block] = 1;
+			return -2;
+		} else {
+			/* Found good block , set the table entry &
+			*  continue reading the data
+			*/
+			bbtbl[block] = 0;
+		}
+	} else if(bbtbl[block] == 1) {
+		/* If the block is already identified as bad, return error*/
+		return -2;
+	}
+
+	if (!nand_page_list_ready(l, 0))
+		flash_nand_read_page_build(l);
+
+	data->addr0 = page << 16;
+	data->addr1 = (page >> 16) & 0xff;
+
+	nand_page_list_exec(l, addr, spareaddr);
 
 #if VERBOSE
 	dprintf(INFO, "read page %d: status: %x %x %x %x\n",
 		page, data[5], data[6], data[7], data[8]);
 	for(n = 0; n < 4; n++) {
-		ptr = (unsigned*)(addr + 512 * n);
+		unsigned *ptr = (unsigned*)(addr + 512 * n);
 		dprintf(INFO, "data%d:	%x %x %x %x\n", n, ptr[0], ptr[1], ptr[2], ptr[3]);
 		ptr = (unsigned*)(spareaddr + 16 * n);
 		dprintf(INFO, "spare data%d	%x %x %x %x\n", n, ptr[0], ptr[1], ptr[2], ptr[3]);
@@ -927,30 +1324,26 @@ static int _flash_nand_read_page(dmov_s *cmdlist, unsigned *ptrlist,
 		}
 	}
 
+	for(n = 0; n < cwperpage; n++) {
+		if (!(data->result[n].buffer_status & NAND_BUF_STAT_UNCRCTBL))
+			nand_stats.ecc_corrected += data->result[n].buffer_status &
+				NAND_BUF_STAT_NUM_ERR_MASK;
+	}
+
 	return 0;
 }
 
-static int flash_nand_read_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
-								 unsigned page, void *_addr, void *_spareaddr)
+static void flash_nand_read_page_interleave_build(struct nand_page_list *l)
 {
-	dmov_s *cmd = cmdlist;
-	unsigned *ptr = ptrlist;
-	struct interleave_data_flash_io *data = (void*) (ptrlist + 4);
-	unsigned addr = (unsigned) _addr;
-	unsigned spareaddr = (unsigned) _spareaddr;
+	dmov_s *cmd = l->cmdlist;
+	struct interleave_data_flash_io *data = (void*) (l->ptrlist + 4);
 	unsigned n;
-	int isbad = 0;
 	unsigned cwperpage;
 	cwperpage = (flash_pagesize >> 9);
 
-	/* Check for bad block and read only from a good block */
-	isbad = flash_nand_block_isbad(cmdlist, ptrlist, page);
-	if (isbad)
-		return -2;
+	nand_page_list_begin(l, 0);
 
 	data->cmd = NAND_CMD_PAGE_READ_ECC;
-	data->addr0 = page << 16;
-	data->addr1 = (page >> 16) & 0xff;
 	data->chipsel_cs0 = 0 | 4; /* flash0 + undoc bit */
 	data->chipsel_cs1 = 0 | 5; /* flash0 + undoc bit */
 	data->ebi2_chip_select_cfg0 = 0x00000805;
@@ -970,9 +1363,6 @@ static int flash_nand_read_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 	data->ecc_cfg = 0x203;
 
 	for (n = 0; n < cwperpage; n++) {
-		/* flash + buffer status return words */
-		data->result[n].flash_status = 0xeeeeeeee;
-
 		if (n == 0) {
 			/* enable CS1 */
 			cmd->cmd = CMD_OCB;
@@ -1142,7 +1532,7 @@ static int flash_nand_read_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 			/* read data block */
 			cmd->cmd = 0;
 			cmd->src = NC01(NAND_FLASH_BUFFER);
-			cmd->dst = addr + n * 516;
+			nand_page_list_buffer(l, cmd, n * 516, 0);
 			cmd->len = ((n < (cwperpage -1 )) ? 516 : (512 - ((cwperpage - 1) << 2)));
 			cmd++;
 		} else {
@@ -1215,7 +1605,7 @@ static int flash_nand_read_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 			/* read data block */
 			cmd->cmd = 0;
 			cmd->src = NC10(NAND_FLASH_BUFFER);
-			cmd->dst = addr + n * 516;
+			nand_page_list_buffer(l, cmd, n * 516, 0);
 			cmd->len = ((n < (cwperpage -1 )) ? 516 : (512 - ((cwperpage - 1) << 2)));
 			cmd++;
 
@@ -1226,7 +1616,7 @@ static int flash_nand_read_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 				cmd->cmd = 0;
 				cmd->src = NC10(NAND_FLASH_BUFFER) +
 				(512 - ((cwperpage -1) << 2));
-				cmd->dst = spareaddr;
+				nand_page_list_buffer(l, cmd, 0, 1);
 				cmd->len = 16;
 				cmd++;
 			}
@@ -1251,10 +1641,36 @@ static int flash_nand_read_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 	cmd->dst = EBI2_CHIP_SELECT_CFG0;
 	cmd->len = 4;
 	cmd++;
+}
 
-	ptr[0] = (paddr(cmdlist) >> 3) | CMD_PTR_LP;
+static int flash_nand_read_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
+								 unsigned page, void *_addr, void *_spareaddr)
+{
+	struct nand_page_list *l = &nand_read_list;
+	struct interleave_data_flash_io *data = (void*) (l->ptrlist + 4);
+	unsigned addr = (unsigned) _addr;
+	unsigned spareaddr = (unsigned) _spareaddr;
+	unsigned n;
+	int isbad = 0;
+	unsigned cwperpage;
+	cwperpage = (flash_pagesize >> 9);
 
-	dmov_exec_cmdptr(DMOV_NAND_CHAN, ptr);
+	/* Check for bad block and read only from a good block */
+	isbad = flash_nand_block_isbad(cmdlist, ptrlist, page);
+	if (isbad)
+		return -2;
+
+	if (!nand_page_list_ready(l, 0))
+		flash_nand_read_page_interleave_build(l);
+
+	data->addr0 = page << 16;
+	data->addr1 = (page >> 16) & 0xff;
+
+	/* flash + buffer status return words */
+	for (n = 0; n < cwperpage; n++)
+		data->result[n].flash_status = 0xeeeeeeee;
+
+	nand_page_list_exec(l, addr, spareaddr);
 
 #if VERBOSE
 	dprintf(INFO, "read page %d: status: %x %x %x %x %x %x %x %x \
@@ -1277,7 +1693,7 @@ static int flash_nand_read_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 	data->result[15].flash_status[15]);
 
 	for(n = 0; n < 4; n++) {
-		ptr = (unsigned*)(addr + 512 * n);
+		unsigned *ptr = (unsigned*)(addr + 512 * n);
 		dprintf(INFO, "data%d:	%x %x %x %x\n", n, ptr[0], ptr[1], ptr[2], ptr[3]);
 		ptr = (unsigned*)(spareaddr + 16 * n);
 		dprintf(INFO, "spare data%d	%x %x %x %x\n", n, ptr[0], ptr[1], ptr[2], ptr[3]);
@@ -1296,14 +1712,11 @@ static int flash_nand_read_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 	return 0;
 }
 
-static int _flash_nand_write_page(dmov_s *cmdlist, unsigned *ptrlist, unsigned page,
-								  const void *_addr, const void *_spareaddr, unsigned raw_mode)
+static void flash_nand_write_page_build(struct nand_page_list *l,
+					unsigned raw_mode)
 {
-	dmov_s *cmd = cmdlist;
-	unsigned *ptr = ptrlist;
-	struct data_flash_io *data = (void*) (ptrlist + 4);
-	unsigned addr = (unsigned) _addr;
-	unsigned spareaddr = (unsigned) _spareaddr;
+	dmov_s *cmd = l->cmdlist;
+	struct data_flash_io *data = (void*) (l->ptrlist + 4);
 	unsigned n;
 	unsigned cwperpage;
 	cwperpage = (flash_pagesize >> 9);
@@ -1313,9 +1726,9 @@ static int _flash_nand_write_page(dmov_s *cmdlist, unsigned *ptrlist, unsigned p
 		modem_partition = 1;
 	}
 
+	nand_page_list_begin(l, raw_mode);
+
 	data->cmd = NAND_CMD_PRG_PAGE;
-	data->addr0 = page << 16;
-	data->addr1 = (page >> 16) & 0xff;
 	data->chipsel = 0 | 4; /* flash0 + undoc bit */
 	data->clrfstatus = 0x00000020;
 	data->clrrstatus = 0x000000C0;
@@ -1380,14 +1793,14 @@ static int _flash_nand_write_page(dmov_s *cmdlist, unsigned *ptrlist, unsigned p
 		cmd->dst = NAND_FLASH_BUFFER;
 		if (!raw_mode){
 			if(modem_partition){
-				cmd->src = addr + n * 512;
+				nand_page_list_buffer(l, cmd, n * 512, 0);
 				cmd->len = 512;
 			}else{
-				cmd->src = addr + n * 516;
+				nand_page_list_buffer(l, cmd, n * 516, 0);
 				cmd->len = ((n < (cwperpage - 1)) ? 516 : (512 - ((cwperpage - 1) << 2)));
 			}
 		}else{
-			cmd->src = addr;
+			nand_page_list_buffer(l, cmd, 0, 0);
 			cmd->len =  528;
 		}
 		cmd++;
@@ -1395,7 +1808,7 @@ static int _flash_nand_write_page(dmov_s *cmdlist, unsigned *ptrlist, unsigned p
 		if ((n == (cwperpage - 1)) && (!raw_mode) && (!modem_partition)) {
 			/* write extra data */
 			cmd->cmd = 0;
-			cmd->src = spareaddr;
+			nand_page_list_buffer(l, cmd, 0, 1);
 			cmd->dst = NAND_FLASH_BUFFER + (512 - ((cwperpage - 1) << 2));
 			cmd->len = (cwperpage << 2);
 			cmd++;
@@ -1433,10 +1846,26 @@ static int _flash_nand_write_page(dmov_s *cmdlist, unsigned *ptrlist, unsigned p
 	cmd->src = paddr(&data->ecc_cfg_save);
 	cmd->dst = NAND_EBI2_ECC_BUF_CFG;
 	cmd->len = 4;
+}
 
-	ptr[0] = (paddr(cmdlist) >> 3) | CMD_PTR_LP;
+static int _flash_nand_write_page(dmov_s *cmdlist, unsigned *ptrlist, unsigned page,
+								  const void *_addr, const void *_spareaddr, unsigned raw_mode)
+{
+	struct nand_page_list *l = &nand_write_list;
+	struct data_flash_io *data = (void*) (l->ptrlist + 4);
+	unsigned addr = (unsigned) _addr;
+	unsigned spareaddr = (unsigned) _spareaddr;
+	unsigned n;
+	unsigned cwperpage;
+	cwperpage = (flash_pagesize >> 9);
 
-	dmov_exec_cmdptr(DMOV_NAND_CHAN, ptr);
+	if (!nand_page_list_ready(l, raw_mode))
+		flash_nand_write_page_build(l, raw_mode);
+
+	data->addr0 = page << 16;
+	data->addr1 = (page >> 16) & 0xff;
+
+	nand_page_list_exec(l, addr, spareaddr);
 
 #if VERBOSE
 	dprintf(INFO, "write page %d: status: %x %x %x %x\n",
@@ -1466,23 +1895,20 @@ static int _flash_nand_write_page(dmov_s *cmdlist, unsigned *ptrlist, unsigned p
 	return 0;
 }
 
-static int flash_nand_write_page_interleave(dmov_s *cmdlist, unsigned *ptrlist, unsigned page,
-								  const void *_addr, const void *_spareaddr, unsigned raw_mode)
+static void flash_nand_write_page_interleave_build(struct nand_page_list *l,
+						   unsigned raw_mode)
 {
-	dmov_s *cmd = cmdlist;
-	unsigned *ptr = ptrlist;
-	struct interleave_data_flash_io *data = (void*) (ptrlist + 4);
-	unsigned addr = (unsigned) _addr;
-	unsigned spareaddr = (unsigned) _spareaddr;
+	dmov_s *cmd = l->cmdlist;
+	struct interleave_data_flash_io *data = (void*) (l->ptrlist + 4);
 	unsigned n;
 	unsigned cwperpage, cwcount;
 
 	cwperpage = (flash_pagesize >> 9) * 2;  /* double for interleave mode */
 	cwcount = (cwperpage << 1);
 
+	nand_page_list_begin(l, raw_mode);
+
 	data->cmd = NAND_CMD_PRG_PAGE;
-	data->addr0 = page << 16;
-	data->addr1 = (page >> 16) & 0xff;
 	data->chipsel_cs0 = 0 | 4; /* flash0 + undoc bit */
 	data->chipsel_cs1 = 0 | 5; /* flash0 + undoc bit */
 	data->ebi2_chip_select_cfg0 = 0x00000805;
@@ -1506,9 +1932,6 @@ static int flash_nand_write_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 	data->ecc_cfg = 0x203;
 
 	for (n = 0; n < cwperpage; n++) {
-		/* status return words */
-		data->result[n].flash_status = 0xeeeeeeee;
-
 		if (n == 0) {
 			/* enable CS1 */
 			cmd->cmd = CMD_OCB;
@@ -1596,10 +2019,10 @@ static int flash_nand_write_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 
 		cmd->cmd = 0;
 		if (!raw_mode){
-			cmd->src = addr + n * 516;
+			nand_page_list_buffer(l, cmd, n * 516, 0);
 			cmd->len = ((n < (cwperpage - 1)) ? 516 : (512 - ((cwperpage - 1) << 2)));
 		}else{
-			cmd->src = addr;
+			nand_page_list_buffer(l, cmd, 0, 0);
 			cmd->len =  528;
 		}
 
@@ -1612,7 +2035,7 @@ static int flash_nand_write_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 		if ((n == (cwperpage - 1)) && (!raw_mode)) {
 			/* write extra data */
 			cmd->cmd = 0;
-			cmd->src = spareaddr;
+			nand_page_list_buffer(l, cmd, 0, 1);
 			cmd->dst = NC10(NAND_FLASH_BUFFER) + (512 - ((cwperpage - 1) << 2));
 			cmd->len = (cwperpage << 2);
 			cmd++;
@@ -1704,10 +2127,31 @@ static int flash_nand_write_page_interleave(dmov_s *cmdlist, unsigned *ptrlist,
 	cmd->dst = EBI2_CHIP_SELECT_CFG0;
 	cmd->len = 4;
 	cmd++;
+}
 
-	ptr[0] = (paddr(cmdlist) >> 3) | CMD_PTR_LP;
+static int flash_nand_write_page_interleave(dmov_s *cmdlist, unsigned *ptrlist, unsigned page,
+								  const void *_addr, const void *_spareaddr, unsigned raw_mode)
+{
+	struct nand_page_list *l = &nand_write_list;
+	struct interleave_data_flash_io *data = (void*) (l->ptrlist + 4);
+	unsigned addr = (unsigned) _addr;
+	unsigned spareaddr = (unsigned) _spareaddr;
+	unsigned n;
+	unsigned cwperpage;
 
-	dmov_exec_cmdptr(DMOV_NAND_CHAN, ptr);
+	cwperpage = (flash_pagesize >> 9) * 2;  /* double for interleave mode */
+
+	if (!nand_page_list_ready(l, raw_mode))
+		flash_nand_write_page_interleave_build(l, raw_mode);
+
+	data->addr0 = page << 16;
+	data->addr1 = (page >> 16) & 0xff;
+
+	/* status return words */
+	for (n = 0; n < cwperpage; n++)
+		data->result[n].flash_status = 0xeeeeeeee;
+
+	nand_page_list_exec(l, addr, spareaddr);
 
 #if VERBOSE
 dprintf(INFO, "write page %d: status: %x %x %x %x %x %x %x %x \
@@ -3231,8 +3675,8 @@ static void flash_read_id(dmov_s *cmdlist, unsigned *ptrlist)
 
 	// Try to read id
 	flash_nand_read_id(cmdlist, ptrlist);
-	// Check if we support the device
-	for (index=1;
+	// Check if we support the device; an ONFI part describes itself
+	for (index = flash_onfi_probe(cmdlist, ptrlist) ? 0 : 1;
 		 index < (sizeof(supported_flash)/sizeof(struct flash_identification));
 		 index++)
 	{
@@ -3286,9 +3730,15 @@ static void flash_read_id(dmov_s *cmdlist, unsigned *ptrlist)
 		num_pages_per_blk = flash_info.block_size / flash_pagesize;
 		num_pages_per_blk_mask = num_pages_per_blk - 1;
                 //Look for 8bit BCH ECC Nand, TODO: ECC Correctability >= 8
-		if((flash_ctrl_hwinfo(cmdlist,ptrlist) == 0x307) &&  flash_info.id == 0x2600482c) {
+		if((flash_ctrl_hwinfo(cmdlist,ptrlist) == 0x307) &&
+		   (flash_info.id == 0x2600482c || (index == 0 && onfi.ecc_bits > 4))) {
 			enable_bch_ecc = 1;
 		}
+		/* RS ECC corrects 4 bits per codeword, BCH 8 */
+		if (index == 0 && onfi.ecc_bits > (enable_bch_ecc ? 8 : 4))
+			dprintf(CRITICAL, "onfi: part needs %u bit ECC, "
+				"controller has %u\n", onfi.ecc_bits,
+				enable_bch_ecc ? 8 : 4);
 		return;
 	}
 
@@ -3307,10 +3757,15 @@ static void flash_read_id(dmov_s *cmdlist, unsigned *ptrlist)
 
 static int flash_erase_block(dmov_s *cmdlist, unsigned *ptrlist, unsigned page)
 {
+	int r;
+
 	switch(flash_info.type) {
 		case FLASH_8BIT_NAND_DEVICE:
 		case FLASH_16BIT_NAND_DEVICE:
-			return flash_nand_erase_block(cmdlist, ptrlist, page);
+			r = flash_nand_erase_block(cmdlist, ptrlist, page);
+			if (!r)
+				nand_stats.blocks_erased++;
+			return r;
 		case FLASH_ONENAND_DEVICE:
 			return flash_onenand_erase_block(cmdlist, ptrlist, page);
 		default:
@@ -3318,7 +3773,7 @@ static int flash_erase_block(dmov_s *cmdlist, unsigned *ptrlist, unsigned page)
 	}
 }
 
-static int _flash_read_page(dmov_s *cmdlist, unsigned *ptrlist,
+static int __flash_read_page(dmov_s *cmdlist, unsigned *ptrlist,
 							unsigned page, void *_addr, void *_spareaddr)
 {
 	switch(flash_info.type) {
@@ -3348,7 +3803,7 @@ static int _flash_block_isbad(dmov_s *cmdlist, unsigned *ptrlist, unsigned page)
 	}
 }
 
-static int _flash_write_page(dmov_s *cmdlist, unsigned *ptrlist,
+static int __flash_write_page(dmov_s *cmdlist, unsigned *ptrlist,
 							 unsigned page, const void *_addr,
 							 const void *_spareaddr)
 {
@@ -3366,6 +3821,42 @@ static int _flash_write_page(dmov_s *cmdlist, unsigned *ptrlist,
 	}
 }
 
+/* page I/O as the partition code sees it, timed and counted */
+static int _flash_read_page(dmov_s *cmdlist, unsigned *ptrlist,
+							unsigned page, void *_addr, void *_spareaddr)
+{
+	bigtime_t start = current_time_hires();
+	int r;
+
+	r = __flash_read_page(cmdlist, ptrlist, page, _addr, _spareaddr);
+	if (r == -2)
+		nand_stats.bad_skips++;
+	else if (r)
+		nand_stats.read_errors++;
+	else {
+		nand_stats.pages_read++;
+		iostat_hist_add(&nand_stats.read_lat, iostat_since(start));
+	}
+	return r;
+}
+
+static int _flash_write_page(dmov_s *cmdlist, unsigned *ptrlist,
+							 unsigned page, const void *_addr,
+							 const void *_spareaddr)
+{
+	bigtime_t start = current_time_hires();
+	int r;
+
+	r = __flash_write_page(cmdlist, ptrlist, page, _addr, _spareaddr);
+	if (r)
+		nand_stats.write_errors++;
+	else {
+		nand_stats.pages_written++;
+		iostat_hist_add(&nand_stats.write_lat, iostat_since(start));
+	}
+	return r;
+}
+
 static unsigned *flash_ptrlist;
 static dmov_s *flash_cmdlist;
 
@@ -3381,6 +3872,11 @@ void flash_init(void)
 	flash_data = memalign(32, 4096 + 128);
 	flash_spare = memalign(32, 128);
 
+	nand_read_list.cmdlist = memalign(32, 1024);
+	nand_read_list.ptrlist = memalign(32, 1024);
+	nand_write_list.cmdlist = memalign(32, 1024);
+	nand_write_list.ptrlist = memalign(32, 1024);
+
 	flash_read_id(flash_cmdlist, flash_ptrlist);
 	if((FLASH_8BIT_NAND_DEVICE == flash_info.type)
 		||(FLASH_16BIT_NAND_DEVICE == flash_info.type)) {
@@ -3494,16 +3990,10 @@ int flash_read_ext(struct ptentry *ptn, unsigned extra_per_page,
 	return 0xffffffff;
 }
 
-int flash_write(struct ptentry *ptn, unsigned extra_per_page, const void *data,
-		unsigned bytes)
+int flash_write_begin(struct flash_write_state *w, struct ptentry *ptn,
+		      unsigned extra_per_page)
 {
-	unsigned page = ptn->start * num_pages_per_blk;
-	unsigned lastpage = (ptn->start + ptn->length) * num_pages_per_blk;
-	unsigned *spare = (unsigned*) flash_spare;
-	const unsigned char *image = data;
-	unsigned wsize = flash_pagesize + extra_per_page;
 	unsigned n;
-	int r;
 
 	if ((flash_info.type == FLASH_ONENAND_DEVICE) && (ptn->type == TYPE_MODEM_PARTITION))
 	{
@@ -3511,15 +4001,36 @@ int flash_write(struct ptentry *ptn, unsigned extra_per_page, const void *data,
 		return -1;
 	}
 
+	w->ptn = ptn;
+	w->extra = extra_per_page;
+	w->page = ptn->start * num_pages_per_blk;
+	w->lastpage = (ptn->start + ptn->length) * num_pages_per_blk;
+
+	set_nand_configuration(ptn->type);
+	for(n = 0; n < 16; n++) ((unsigned*) flash_spare)[n] = 0xffffffff;
+	return 0;
+}
+
+/* A failed page rewrites its whole block from the start of 'data', so
+ * every call but the last has to hand over whole blocks. */
+int flash_write_next(struct flash_write_state *w, const void *data,
+		     unsigned bytes)
+{
+	struct ptentry *ptn = w->ptn;
+	unsigned page = w->page;
+	unsigned *spare = (unsigned*) flash_spare;
+	const unsigned char *image = data;
+	unsigned wsize = flash_pagesize + w->extra;
+	int r;
+
 	set_nand_configuration(ptn->type);
-	for(n = 0; n < 16; n++) spare[n] = 0xffffffff;
 
 	while(bytes > 0) {
 		if(bytes < wsize) {
 			dprintf(CRITICAL, "flash_write_image: image undersized (%d < %d)\n", bytes, wsize);
 			return -1;
 		}
-		if(page >= lastpage) {
+		if(page >= w->lastpage) {
 			dprintf(CRITICAL, "flash_write_image: out of space\n");
 			return -1;
 		}
@@ -3532,7 +4043,7 @@ int flash_write(struct ptentry *ptn, unsigned extra_per_page, const void *data,
 			}
 		}
 
-		if(extra_per_page) {
+		if(w->extra) {
 			r = _flash_write_page(flash_cmdlist, flash_ptrlist, page, image, image + flash_pagesize);
 		} else {
 			r = _flash_write_page(flash_cmdlist, flash_ptrlist, page, image, spare);
@@ -3557,9 +4068,19 @@ int flash_write(struct ptentry *ptn, unsigned extra_per_page, const void *data,
 		bytes -= wsize;
 	}
 
+	w->page = page;
+	return 0;
+}
+
+int flash_write_end(struct flash_write_state *w)
+{
+	unsigned page = w->page;
+
+	set_nand_configuration(w->ptn->type);
+
 	/* erase any remaining pages in the partition */
 	page = (page + num_pages_per_blk_mask) & (~num_pages_per_blk_mask);
-	while(page < lastpage){
+	while(page < w->lastpage){
 		if(flash_erase_block(flash_cmdlist, flash_ptrlist, page)) {
 			dprintf(INFO, "flash_write_image: bad block @ %d\n", page / num_pages_per_blk);
 		}
@@ -3570,6 +4091,18 @@ int flash_write(struct ptentry *ptn, unsigned extra_per_page, const void *data,
 	return 0;
 }
 
+int flash_write(struct ptentry *ptn, unsigned extra_per_page, const void *data,
+		unsigned bytes)
+{
+	struct flash_write_state w;
+
+	if (flash_write_begin(&w, ptn, extra_per_page))
+		return -1;
+	if (flash_write_next(&w, data, bytes))
+		return -1;
+	return flash_write_end(&w);
+}
+
 #if 0
 static int flash_read_page(unsigned page, void *data, void *extra)
 {
@@ -37,6 +37,9 @@
 #include <kernel/thread.h>
 #include <platform/irqs.h>
 #include <qgic.h>
+#if WITH_LIB_PROFILE
+#include <lib/profile.h>
+#endif
 
 static struct ihandler handler[NR_IRQS];
 
@@ -114,6 +117,11 @@ enum handler_return platform_irq(struct arm_iframe *frame)
 	if (num > NR_IRQS)
 		return 0;
 
+#if WITH_LIB_PROFILE
+	/* the tick is the only interrupt that sees where we were */
+	if (num == INT_DEBUG_TIMER_EXP)
+		profile_sample(frame->pc, frame->spsr & MODE_MASK);
+#endif
 	ret = handler[num].func(handler[num].arg);
 	writel(num, GIC_CPU_EOI);
 
@@ -16,6 +16,7 @@ OBJS += \
 	$(LOCAL_DIR)/jtag.o \
 	$(LOCAL_DIR)/nand.o \
 	$(LOCAL_DIR)/mmc.o \
+	$(LOCAL_DIR)/iostat.o \
 	$(LOCAL_DIR)/partition_parser.o
 
 ifeq ($(PLATFORM),msm8x60)
@@ -137,7 +137,15 @@ void udelay(unsigned usecs)
 }
 
 /* Return current time in micro seconds */
+/* the tick plus how far the DGT count has got into the next one */
 bigtime_t current_time_hires(void)
 {
-	return ticks * 1000ULL;
+	uint32_t t, count;
+
+	do {
+		t = ticks;
+		count = readl(DGT_COUNT_VAL);
+	} while (t != ticks);
+
+	return t * 1000ULL + count * 1000 / (platform_tick_rate() / 1000);
 }
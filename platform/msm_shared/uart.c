@@ -196,6 +196,14 @@ int uart_putc (int port, char c)
 	_uart_putc(0, c);
 }
 
+/* Nothing is buffered here; wait for the shift register to empty */
+void uart_flush_tx(int port)
+{
+	if (!uart_ready)
+		return;
+	while (!(urd(UART_SR) & UART_SR_TX_EMPTY)) ;
+}
+
 int uart_getc(int port, bool wait)
 {
 	if (!uart_ready)
@@ -31,6 +31,7 @@
 #include <debug.h>
 #include <reg.h>
 #include <sys/types.h>
+#include <kernel/thread.h>
 #include <platform/iomap.h>
 #include <platform/irqs.h>
 #include <platform/interrupts.h>
@@ -51,77 +52,46 @@
  *   use of static variables. TX path shouldn't have any problem though. If
  *   multi-threaded support is required, a simple data-structure can
  *   be maintained for each thread.
- * - Right now we are using polling method than interrupt based.
+ * - RX is polled. TX goes through a ring per port that uart_putc appends
+ *   to; the TX FIFO is refilled from it by the TXLEV interrupt once
+ *   uart_init_irq() has run, and by uart_putc itself before that.
  * - We are using legacy UART protocol without Data Mover.
  * - Not all interrupts and error events are handled.
  * - While waiting Watchdog hasn't been taken into consideration.
  */
 
 
-#define PACK_CHARS_INTO_WORDS(a, cnt, word)  {                                 \
-                                               word = 0;                       \
-                                               for(int j=0; j < (int)cnt; j++) \
-                                               {                               \
-                                                   word |= (a[j] & 0xff)       \
-                                                               << (j * 8);     \
-                                               }                               \
-                                              }
-
-
 /* Static Function Prototype Declarations */
 static unsigned int msm_boot_uart_dm_gsbi_init(uint8_t id);
-static unsigned int msm_boot_uart_replace_lr_with_cr(char* data_in,
-                                                     int num_of_chars,
-                                                     char *data_out,
-                                                     int *num_of_chars_out);
 static unsigned int msm_boot_uart_dm_init(uint8_t id);
 static unsigned int msm_boot_uart_dm_read(uint8_t id, unsigned int* data,
                                           int wait);
-static unsigned int msm_boot_uart_dm_write(uint8_t id, char* data,
-                                           unsigned int num_of_chars);
 static unsigned int msm_boot_uart_dm_init_rx_transfer(uint8_t id);
 static unsigned int msm_boot_uart_dm_reset(uint8_t id);
 
 /* Keep track of gsbi vs port mapping.
  */
 static uint8_t gsbi_lookup[4];
+static uint8_t num_ports;
+
+/* Bytes waiting to go out on each port; a power of 2 */
+#define UART_DM_TX_RING     4096
+/* Most characters handed to the UART in one NO_CHARS_FOR_TX transfer */
+#define UART_DM_TX_CHUNK    256
+
+static struct uart_dm_tx {
+    char buf[UART_DM_TX_RING];
+    unsigned head;              /* next free slot */
+    unsigned tail;              /* next byte for the FIFO */
+    unsigned chunk_left;        /* of the transfer under way */
+    int irq;                    /* TXLEV interrupt drains the ring */
+    int armed;                  /* TXLEV is unmasked in IMR */
+} uart_tx[ARRAY_SIZE(gsbi_lookup)];
 
 /* Extern functions */
 void udelay(unsigned usecs);
 
 
-/*
- * Helper function to replace Line Feed char "\n" with
- * Carriage Return "\r\n".
- * Currently keeping it simple than efficient
- */
-static unsigned int msm_boot_uart_replace_lr_with_cr(char* data_in,
-                                                     int num_of_chars,
-                                                     char *data_out,
-                                                     int *num_of_chars_out )
-{
-    int i = 0, j = 0;
-
-    if ((data_in == NULL) || (data_out == NULL) || (num_of_chars < 0))
-    {
-        return MSM_BOOT_UART_DM_E_INVAL;
-    }
-
-    for (i=0, j=0; i < num_of_chars; i++, j++)
-    {
-        if ( data_in[i] == '\n' )
-        {
-            data_out[j++] = '\r';
-        }
-
-        data_out[j] = data_in[i];
-    }
-
-    *num_of_chars_out = j;
-
-    return MSM_BOOT_UART_DM_E_SUCCESS;
-}
-
 /*
  * Initialize and configure GSBI for operation
  */
@@ -181,7 +151,8 @@ static unsigned int msm_boot_uart_dm_init(uint8_t id)
     writel(MSM_BOOT_UART_DM_8_N_1_MODE, MSM_BOOT_UART_DM_MR2(id));
 
     /* Configure Interrupt Mask register IMR */
-    writel(MSM_BOOT_UART_DM_IMR_ENABLED, MSM_BOOT_UART_DM_IMR(id));
+    /* Only TXLEV is ever unmasked, and only while there is data to send */
+    writel(0, MSM_BOOT_UART_DM_IMR(id));
 
     /* Configure Tx and Rx watermarks configuration registers */
     /* TX watermark value is set to 0 - interrupt is generated when
@@ -289,7 +260,7 @@ static unsigned int msm_boot_uart_dm_read(uint8_t id, unsigned int* data, int wa
     if (rx_last_snap_count == 0)
     {
         /* Check if we've received stale event */
-        if (readl(MSM_BOOT_UART_DM_MISR(id)) & MSM_BOOT_UART_DM_RXSTALE)
+        if (readl(MSM_BOOT_UART_DM_ISR(id)) & MSM_BOOT_UART_DM_RXSTALE)
         {
             /* Send command to reset stale interrupt */
             writel(MSM_BOOT_UART_DM_CMD_RES_STALE_INT, MSM_BOOT_UART_DM_CR(id));
@@ -326,77 +297,74 @@ static unsigned int msm_boot_uart_dm_read(uint8_t id, unsigned int* data, int wa
 }
 
 /*
- * UART transmit operation
+ * Move what the TX FIFO takes from the ring of 'port'.  Called with
+ * interrupts disabled; never waits on the UART.
  */
-static unsigned int msm_boot_uart_dm_write(uint8_t id, char* data,
-                                           unsigned int num_of_chars)
+static void msm_boot_uart_dm_tx_drain(int port)
 {
-    unsigned int tx_word_count = 0;
-    unsigned int tx_char_left = 0, tx_char = 0;
-    unsigned int tx_word = 0;
-    int i = 0;
-    char* tx_data = NULL;
-    char new_data[1024];
-
-    if ((data == NULL) || (num_of_chars <= 0))
-    {
-        return MSM_BOOT_UART_DM_E_INVAL;
-    }
-
-    /* Replace line-feed (/n) with carriage-return + line-feed (/r/n) */
-
-    msm_boot_uart_replace_lr_with_cr(data, num_of_chars, new_data, &i);
+    struct uart_dm_tx *tx = &uart_tx[port];
+    uint8_t id = gsbi_lookup[port];
+    unsigned int tx_word;
+    unsigned int n, i;
 
-    tx_data = new_data;
-    num_of_chars = i;
-
-    /* Write to NO_CHARS_FOR_TX register number of characters
-     * to be transmitted. However, before writing TX_FIFO must
-     * be empty as indicated by TX_READY interrupt in IMR register
-     */
-
-    /* Check if transmit FIFO is empty.
-     * If not we'll wait for TX_READY interrupt. */
-    if (!(readl(MSM_BOOT_UART_DM_SR(id)) & MSM_BOOT_UART_DM_SR_TXEMT))
+    for (;;)
     {
-        while (!(readl(MSM_BOOT_UART_DM_ISR(id)) & MSM_BOOT_UART_DM_TX_READY))
+        if (!tx->chunk_left)
         {
-            udelay(1);
-            /* Kick watchdog? */
+            n = tx->head - tx->tail;
+            if (!n)
+                break;
+
+            /* The previous transfer must have gone into the FIFO */
+            if (!(readl(MSM_BOOT_UART_DM_SR(id)) & MSM_BOOT_UART_DM_SR_TXEMT) &&
+                !(readl(MSM_BOOT_UART_DM_ISR(id)) & MSM_BOOT_UART_DM_TX_READY))
+                break;
+
+            tx->chunk_left = (n < UART_DM_TX_CHUNK) ? n : UART_DM_TX_CHUNK;
+            writel(tx->chunk_left, MSM_BOOT_UART_DM_NO_CHARS_FOR_TX(id));
+            writel(MSM_BOOT_UART_DM_GCMD_RES_TX_RDY_INT, MSM_BOOT_UART_DM_CR(id));
         }
-    }
 
-    /* We are here. FIFO is ready to be written. */
-    /* Write number of characters to be written */
-    writel(num_of_chars, MSM_BOOT_UART_DM_NO_CHARS_FOR_TX(id));
-
-    /* Clear TX_READY interrupt */
-    writel(MSM_BOOT_UART_DM_GCMD_RES_TX_RDY_INT, MSM_BOOT_UART_DM_CR(id));
+        /* Four characters per FIFO word, as long as there is room */
+        while (tx->chunk_left &&
+               (readl(MSM_BOOT_UART_DM_SR(id)) & MSM_BOOT_UART_DM_SR_TXRDY))
+        {
+            n = (tx->chunk_left < 4) ? tx->chunk_left : 4;
+            tx_word = 0;
+            for (i = 0; i < n; i++, tx->tail++)
+                tx_word |= (tx->buf[tx->tail & (UART_DM_TX_RING - 1)] & 0xff)
+                           << (i * 8);
+            writel(tx_word, MSM_BOOT_UART_DM_TF(id, 0));
+            tx->chunk_left -= n;
+        }
 
-    /* We use four-character word FIFO. So we need to divide data into
-     * four characters and write in UART_DM_TF register */
-    tx_word_count = (num_of_chars % 4)? ((num_of_chars / 4) + 1) :
-                                        (num_of_chars / 4);
-    tx_char_left = num_of_chars;
+        if (tx->chunk_left)
+            break;
+    }
 
-    for (i = 0; i < (int)tx_word_count; i++)
+    /* TXLEV fires while the FIFO is empty, so only ask for it with work left */
+    if (tx->irq && tx->armed != (tx->head != tx->tail || tx->chunk_left))
     {
-        tx_char = (tx_char_left < 4)? tx_char_left : 4;
-        PACK_CHARS_INTO_WORDS(tx_data, tx_char, tx_word);
+        tx->armed = !tx->armed;
+        writel(tx->armed ? MSM_BOOT_UART_DM_TXLEV : 0, MSM_BOOT_UART_DM_IMR(id));
+    }
+}
 
-        /* Wait till TX FIFO has space */
-        while (!(readl(MSM_BOOT_UART_DM_SR(id)) & MSM_BOOT_UART_DM_SR_TXRDY))
-        {
-            udelay(1);
-        }
+static enum handler_return msm_boot_uart_dm_irq(void *arg)
+{
+    msm_boot_uart_dm_tx_drain((int) arg);
+    return INT_NO_RESCHEDULE;
+}
 
-        /* TX FIFO has space. Write the chars */
-        writel(tx_word, MSM_BOOT_UART_DM_TF(id, 0));
-        tx_char_left = num_of_chars - (i+1)*4;
-        tx_data = tx_data + 4;
-    }
+static void msm_boot_uart_dm_tx_put(int port, char c)
+{
+    struct uart_dm_tx *tx = &uart_tx[port];
 
-    return MSM_BOOT_UART_DM_E_SUCCESS;
+    /* Full: wait for the UART, as every character used to */
+    while (tx->head - tx->tail == UART_DM_TX_RING)
+        msm_boot_uart_dm_tx_drain(port);
+
+    tx->buf[tx->head++ & (UART_DM_TX_RING - 1)] = c;
 }
 
 /* Defining functions that's exposed to outside world and in coformance to
@@ -405,28 +373,87 @@ static unsigned int msm_boot_uart_dm_write(uint8_t id, char* data,
  */
 void uart_init(uint8_t gsbi_id)
 {
-    static uint8_t port = 0;
     char *data = "Android Bootloader - UART_DM Initialized!!!\n";
+    int port = num_ports;
 
     msm_boot_uart_dm_init(gsbi_id);
-    msm_boot_uart_dm_write(gsbi_id, data, 44);
 
     ASSERT(port < ARRAY_SIZE(gsbi_lookup));
-    gsbi_lookup[port++] = gsbi_id;
+    gsbi_lookup[num_ports++] = gsbi_id;
+
+    while (*data)
+        uart_putc(port, *data++);
+}
+
+/*
+ * Let the TXLEV interrupt drain the TX rings.  Needs the interrupt
+ * controller up, which uart_init() runs before.
+ */
+void uart_init_irq(void)
+{
+    int port;
+    int irq;
+
+    for (port = 0; port < num_ports; port++)
+    {
+        irq = GSBI_UART_IRQ(gsbi_lookup[port]);
+        register_int_handler(irq, msm_boot_uart_dm_irq, (void *) port);
+
+        enter_critical_section();
+        uart_tx[port].irq = irq;
+        msm_boot_uart_dm_tx_drain(port);
+        exit_critical_section();
+
+        unmask_interrupt(irq);
+    }
+}
+
+/* Wait until everything queued has left the UART */
+void uart_flush_tx(int port)
+{
+    uint8_t id = gsbi_lookup[port];
+
+    if (port >= num_ports)
+        return;
+
+    enter_critical_section();
+    while (uart_tx[port].head != uart_tx[port].tail || uart_tx[port].chunk_left)
+        msm_boot_uart_dm_tx_drain(port);
+    exit_critical_section();
+
+    while (!(readl(MSM_BOOT_UART_DM_SR(id)) & MSM_BOOT_UART_DM_SR_TXEMT))
+        ;
 }
 
 
 /* UART_DM uses four character word FIFO where as UART core
- * uses a character FIFO. so it's really inefficient to try
- * to write single character. But that's how dprintf has been
- * implemented.
+ * uses a character FIFO, so characters are queued in the ring and
+ * packed into words on their way into the FIFO.
  */
 int uart_putc(int port, char c)
 {
-    uint8_t gsbi_id = gsbi_lookup[port];
+    struct uart_dm_tx *tx = &uart_tx[port];
+    bool inline_drain = in_critical_section();
 
-    msm_boot_uart_dm_write(gsbi_id, &c, 1);
+    enter_critical_section();
+
+    /* Replace line-feed (\n) with carriage-return + line-feed (\r\n) */
+    if (c == '\n')
+        msm_boot_uart_dm_tx_put(port, '\r');
+    msm_boot_uart_dm_tx_put(port, c);
+
+    /* Push what fits now when the interrupt is not up or not armed yet.
+     * A caller with interrupts off may never let TXLEV in (panic, halt,
+     * fault dumps), so it waits for everything to reach the FIFO. */
+    if (inline_drain)
+    {
+        while (tx->head != tx->tail || tx->chunk_left)
+            msm_boot_uart_dm_tx_drain(port);
+    }
+    else if (!tx->irq || !tx->armed)
+        msm_boot_uart_dm_tx_drain(port);
 
+    exit_critical_section();
     return 0;
 }
 
@@ -5,6 +5,7 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 TARGET := apq-touchpad
 
 MODULES += app/aboot
+MODULES += lib/profile
 
 DEBUG := 2
 
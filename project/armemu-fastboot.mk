@@ -0,0 +1,12 @@
+# fastboot over the loopback udc, for protocol and throughput tests
+# with scripts/fbloop on the host
+#
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+TARGET := armemu
+ARMEMU_CONF := target/armemu/armemu-fastboot.conf
+WITH_UDC_LOOPBACK := 1
+
+MODULES += \
+	app/fbloop \
+	lib/profile
@@ -0,0 +1,15 @@
+# storage and Krait clock register models on the emulator, with mmc.c,
+# nand.c, adm.c and acpuclock.c built to run on them; "regmodel_tests"
+# exercises the drivers against images in memory and the clock model,
+# other images are the block0 file of the armemu conf, attached with
+# "regmodel attach" from the shell
+#
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+TARGET := armemu
+
+MODULES += \
+	lib/regmodel \
+	lib/regmodel/msm \
+	app/regmodeltests \
+	app/shell
@@ -39,6 +39,7 @@
 #include <dev/ssbi.h>
 #include <platform/iomap.h>
 #include <lib/ptable.h>
+#include <target.h>
 
 #define LINUX_MACHTYPE_APQ8064_SIM     3572
 
@@ -175,9 +176,3 @@ uint8_t target_uart_gsbi(void)
 {
 	return uart_gsbi_id;
 }
-
-/* Returns type of baseband. APQ for APPs only proc. */
-unsigned target_baseband()
-{
-	return BASEBAND_APQ;
-}
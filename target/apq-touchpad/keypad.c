@@ -42,7 +42,7 @@ static unsigned char qwerty_keys_new[NUM_OF_ROWS];
 
 #define KEYMAP_INDEX(row, col) (row)* BITS_IN_ELEMENT(qwerty_keys_new) + (col)
 
-unsigned int qwerty_keymap[] = {
+unsigned int qwerty_keymap[KEYMAP_INDEX(NUM_OF_ROWS, 0)] = {
     [KEYMAP_INDEX(0, 0)] = KEY_VOLUMEUP,
     [KEYMAP_INDEX(0, 1)] = KEY_VOLUMEDOWN,
 };
@@ -11,14 +11,30 @@ MEMSIZE := 0x00100000 # 1MB
 SCRATCH_ADDR := 0x70000000
 SCRATCH_SIZE := 1024 #size in MB
 
+# RAM for the warm-reset boot image cache (app/aboot/bootcache.c); it
+# must not overlap the memory given to the kernel or the scratch area.
+#BOOT_CACHE_ADDR := 0x88f00000
+#BOOT_CACHE_SIZE := 0x03000000
+
 KEYS_USE_GPIO_KEYPAD := 1
 
+# choose between the boot, linux and recovery partitions at startup;
+# there are only the volume keys to drive it with
+WITH_BOOT_MENU := 1
+DEFINES += BOOT_MENU_VOLUME_KEYS_ONLY=1
+
 MODULES += \
 	dev/keys \
 	dev/ssbi \
 	dev/pmic/pm8921 \
 	lib/ptable
 
+# eMMC only, unsigned images, APQ (no modem): let the compiler drop the
+# code for the other configurations (see include/target.h)
+DEFINES += \
+	TARGET_FIXED_CONFIG=1 \
+	TARGET_BASEBAND=BASEBAND_APQ
+
 DEFINES += \
 	MEMSIZE=$(MEMSIZE) \
 	MEMBASE=$(MEMBASE) \
@@ -29,3 +45,9 @@ OBJS += \
 	$(LOCAL_DIR)/init.o \
 	$(LOCAL_DIR)/atags.o \
 	$(LOCAL_DIR)/keypad.o
+
+ifneq ($(BOOT_CACHE_ADDR),)
+DEFINES += \
+	BOOT_CACHE_ADDR=$(BOOT_CACHE_ADDR) \
+	BOOT_CACHE_SIZE=$(BOOT_CACHE_SIZE)
+endif
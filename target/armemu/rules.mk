@@ -4,7 +4,9 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 
 PLATFORM := armemu
 
-$(BUILDDIR)/armemu.conf: $(LOCAL_DIR)/armemu.conf
+ARMEMU_CONF ?= $(LOCAL_DIR)/armemu.conf
+
+$(BUILDDIR)/armemu.conf: $(ARMEMU_CONF)
 	cp $< $@
 
 EXTRA_BUILDDEPS += $(BUILDDIR)/armemu.conf
@@ -50,6 +50,7 @@ __WEAK unsigned target_get_max_flash_size(void)
     return (120 * 1024 * 1024);
 }
 
+#if !TARGET_FIXED_CONFIG
 __WEAK int target_is_emmc_boot(void)
 {
 #if _EMMC_BOOT
@@ -58,6 +59,7 @@ __WEAK int target_is_emmc_boot(void)
     return 0;
 #endif
 }
+#endif
 
 __WEAK unsigned check_reboot_mode(void)
 {
@@ -73,10 +75,12 @@ __WEAK unsigned target_pause_for_battery_charge(void)
     return 0;
 }
 
+#ifndef TARGET_BASEBAND
 __WEAK unsigned target_baseband()
 {
 	return 0;
 }
+#endif
 
 __WEAK void target_serialno(unsigned char *buf)
 {
@@ -87,11 +91,23 @@ __WEAK void target_fastboot_init()
 {
 }
 
+__WEAK void *target_get_boot_cache(unsigned *size)
+{
+#ifdef BOOT_CACHE_ADDR
+	*size = BOOT_CACHE_SIZE;
+	return (void *)(BOOT_CACHE_ADDR);
+#else
+	*size = 0;
+	return NULL;
+#endif
+}
+
 __WEAK int emmc_recovery_init(void)
 {
 	return 0;
 }
 
+#if !TARGET_FIXED_CONFIG
 __WEAK bool target_use_signed_kernel(void)
 {
 #if _SIGNED_KERNEL
@@ -100,3 +116,4 @@ __WEAK bool target_use_signed_kernel(void)
 	return 0;
 #endif
 }
+#endif